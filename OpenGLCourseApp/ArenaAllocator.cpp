@@ -0,0 +1,131 @@
+#include "ArenaAllocator.h"
+
+ArenaAllocator::ArenaAllocator()
+{
+	capacity = 0;
+	used = 0;
+}
+
+ArenaAllocator::ArenaAllocator(GLsizeiptr startCapacity)
+{
+	capacity = startCapacity;
+	used = 0;
+
+	if (capacity > 0)
+	{
+		freeBlocks[0] = capacity;
+	}
+}
+
+GLsizeiptr ArenaAllocator::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+	if (size <= 0)
+	{
+		return invalidOffset;
+	}
+
+	for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+	{
+		GLsizeiptr blockOffset = it->first;
+		GLsizeiptr blockSize = it->second;
+		GLsizeiptr alignedOffset = (blockOffset + alignment - 1) / alignment * alignment;
+		GLsizeiptr padding = alignedOffset - blockOffset;
+
+		if (padding + size > blockSize)
+		{
+			continue;
+		}
+
+		freeBlocks.erase(it);
+
+		if (padding > 0)
+		{
+			freeBlocks[blockOffset] = padding;
+		}
+
+		GLsizeiptr remaining = blockSize - padding - size;
+		if (remaining > 0)
+		{
+			freeBlocks[alignedOffset + size] = remaining;
+		}
+
+		used += size;
+		return alignedOffset;
+	}
+
+	return invalidOffset;
+}
+
+void ArenaAllocator::release(GLsizeiptr offset, GLsizeiptr size)
+{
+	if (offset == invalidOffset || size <= 0)
+	{
+		return;
+	}
+
+	used -= size;
+	insertFreeBlock(offset, size);
+}
+
+void ArenaAllocator::grow(GLsizeiptr newCapacity)
+{
+	if (newCapacity <= capacity)
+	{
+		return;
+	}
+
+	GLsizeiptr oldCapacity = capacity;
+	capacity = newCapacity;
+	insertFreeBlock(oldCapacity, newCapacity - oldCapacity);
+}
+
+GLsizeiptr ArenaAllocator::getLargestFreeBlock()
+{
+	GLsizeiptr largest = 0;
+	for (auto& block : freeBlocks)
+	{
+		if (block.second > largest)
+		{
+			largest = block.second;
+		}
+	}
+	return largest;
+}
+
+GLfloat ArenaAllocator::getFragmentation()
+{
+	GLsizeiptr freeSpace = capacity - used;
+	if (freeSpace <= 0)
+	{
+		return 0.f;
+	}
+	return 1.f - (GLfloat)getLargestFreeBlock() / (GLfloat)freeSpace;
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+}
+
+void ArenaAllocator::insertFreeBlock(GLsizeiptr offset, GLsizeiptr size)
+{
+	auto next = freeBlocks.lower_bound(offset);
+
+	if (next != freeBlocks.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			freeBlocks.erase(prev);
+		}
+	}
+
+	if (next != freeBlocks.end() && offset + size == next->first)
+	{
+		size += next->second;
+		freeBlocks.erase(next);
+	}
+
+	freeBlocks[offset] = size;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <map>
+
+#include <GL\glew.h>
+
+class ArenaAllocator
+{
+public:
+	static const GLsizeiptr invalidOffset = -1;
+
+	ArenaAllocator();
+	ArenaAllocator(GLsizeiptr startCapacity);
+
+	GLsizeiptr allocate(GLsizeiptr size, GLsizeiptr alignment = 1);
+	void release(GLsizeiptr offset, GLsizeiptr size);
+	void grow(GLsizeiptr newCapacity);
+
+	GLsizeiptr getCapacity() { return capacity; }
+	GLsizeiptr getUsed() { return used; }
+	GLsizeiptr getLargestFreeBlock();
+	size_t getFreeBlockCount() { return freeBlocks.size(); }
+
+	// 0 when all free space is one block, approaching 1 as it splinters.
+	GLfloat getFragmentation();
+
+	~ArenaAllocator();
+
+private:
+	std::map<GLsizeiptr, GLsizeiptr> freeBlocks;
+	GLsizeiptr capacity;
+	GLsizeiptr used;
+
+	void insertFreeBlock(GLsizeiptr offset, GLsizeiptr size);
+};
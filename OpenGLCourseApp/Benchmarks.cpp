@@ -0,0 +1,658 @@
+#include "Benchmarks.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <filesystem>
+
+#include <glm\gtc\matrix_transform.hpp>
+
+#include "MeshCache.h"
+#include "MeshImporter.h"
+#include "MeshNormals.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "MeshTangents.h"
+#include "MeshWelder.h"
+#include "MipGenerator.h"
+#include "Texture.h"
+#include "TextureCompressor.h"
+
+namespace
+{
+	template<typename Function>
+	double timeMilliseconds(Function function)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+void Benchmarks::runAll()
+{
+	benchAverageNormals();
+	benchTangents();
+	benchWelding();
+	benchMeshCache();
+	benchImport();
+	benchSimplify();
+	benchMeshlets();
+	benchMeshUpdates();
+	benchMipGeneration();
+	benchTextureLoading();
+}
+
+void Benchmarks::generateGrid(unsigned int gridSize, std::vector<GLfloat>& vertices, std::vector<unsigned int>& indices)
+{
+	unsigned int side = gridSize + 1;
+	vertices.assign((size_t)side * side * 8, 0.f);
+	indices.clear();
+	indices.reserve((size_t)gridSize * gridSize * 6);
+
+	for (unsigned int z = 0; z < side; z++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			GLfloat* vertex = &vertices[((size_t)z * side + x) * 8];
+			vertex[0] = (GLfloat)x / gridSize * 2.f - 1.f;
+			vertex[1] = 0.05f * sinf(x * 0.37f) * cosf(z * 0.23f);
+			vertex[2] = (GLfloat)z / gridSize * 2.f - 1.f;
+			vertex[3] = (GLfloat)x / gridSize;
+			vertex[4] = (GLfloat)z / gridSize;
+		}
+	}
+
+	for (unsigned int z = 0; z < gridSize; z++)
+	{
+		for (unsigned int x = 0; x < gridSize; x++)
+		{
+			unsigned int i0 = z * side + x;
+			unsigned int i1 = i0 + 1;
+			unsigned int i2 = i0 + side;
+			unsigned int i3 = i2 + 1;
+			indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+		}
+	}
+}
+
+void Benchmarks::benchAverageNormals()
+{
+	std::vector<GLfloat> source;
+	std::vector<unsigned int> indices;
+	generateGrid(1024, source, indices);
+
+	unsigned int verticeCount = (unsigned int)source.size();
+	unsigned int indiceCount = (unsigned int)indices.size();
+	printf("calcAverageNormals: %u vertices, %u triangles, %u threads%s\n",
+		verticeCount / 8, indiceCount / 3, ThreadPool::getShared().getParallelThreadCount() + 1,
+		ThreadPool::getShared().getParallelThreadCount() == 0 ? ", uniform falls back to the reference" : "");
+
+	std::vector<GLfloat> reference = source;
+	double referenceTime = timeMilliseconds([&]()
+	{
+		MeshNormals::calcAverageNormalsReference(indices.data(), indiceCount, reference.data(), verticeCount, 8, 5);
+	});
+	printf("  reference:        %8.2f ms\n", referenceTime);
+
+	const char* modeNames[] = { "uniform", "area", "angle" };
+	NormalWeighting modes[] = { NormalWeighting::Uniform, NormalWeighting::Area, NormalWeighting::Angle };
+
+	for (int m = 0; m < 3; m++)
+	{
+		std::vector<GLfloat> vertices = source;
+		double time = timeMilliseconds([&]()
+		{
+			MeshNormals::calcAverageNormals(indices.data(), indiceCount, vertices.data(), verticeCount, 8, 5, modes[m]);
+		});
+
+		GLfloat maxError = 0.f;
+		for (size_t i = 5; i < vertices.size(); i += 8)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				maxError = fmaxf(maxError, fabsf(vertices[i + c] - reference[i + c]));
+			}
+		}
+
+		printf("  parallel %-8s %8.2f ms (%.1fx), max difference from reference %.5f\n",
+			modeNames[m], time, referenceTime / time, maxError);
+	}
+}
+
+void Benchmarks::benchTangents()
+{
+	std::vector<GLfloat> source;
+	std::vector<unsigned int> indices;
+	generateGrid(1024, source, indices);
+
+	unsigned int vertexCount = (unsigned int)source.size() / 8;
+	unsigned int indiceCount = (unsigned int)indices.size();
+	MeshNormals::calcAverageNormals(indices.data(), indiceCount, source.data(), (unsigned int)source.size(), 8, 5);
+
+	std::vector<GLfloat> vertices;
+	MeshTangents::expandToTangentLayout(source.data(), vertexCount, vertices);
+
+	double time = timeMilliseconds([&]()
+	{
+		MeshTangents::calcTangents(indices.data(), indiceCount, vertices.data(), vertexCount, MeshTangents::tangentVertexStream);
+	});
+
+	const GLfloat* centre = &vertices[(size_t)(vertexCount / 2) * 12];
+	printf("calcTangents: %u vertices, %u triangles, %.2f ms, centre tangent (%.2f, %.2f, %.2f) w %.0f\n",
+		vertexCount, indiceCount / 3, time, centre[8], centre[9], centre[10], centre[11]);
+}
+
+void Benchmarks::benchWelding()
+{
+	std::vector<GLfloat> grid;
+	std::vector<unsigned int> indices;
+	generateGrid(1024, grid, indices);
+
+	std::vector<GLfloat> soup(indices.size() * 8);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		memcpy(&soup[i * 8], &grid[(size_t)indices[i] * 8], 8 * sizeof(GLfloat));
+	}
+
+	std::vector<GLfloat> welded;
+	std::vector<unsigned int> weldedIndices;
+
+	WeldReport exact = MeshWelder::weldVertices(soup.data(), (unsigned int)indices.size(), 8, nullptr, 0, 0.f, welded, weldedIndices);
+	MeshWelder::printReport("soup exact", exact);
+
+	WeldReport epsilon = MeshWelder::weldVertices(soup.data(), (unsigned int)indices.size(), 8, nullptr, 0, 1e-5f, welded, weldedIndices);
+	MeshWelder::printReport("soup epsilon 1e-5", epsilon);
+}
+
+void Benchmarks::benchMeshCache()
+{
+	const char* cacheFile = "Cache/benchmark.meshcache";
+
+	std::vector<GLfloat> source;
+	std::vector<unsigned int> indices;
+	generateGrid(1024, source, indices);
+
+	unsigned int vertexCount = (unsigned int)source.size() / 8;
+	unsigned int indiceCount = (unsigned int)indices.size();
+	std::vector<PackedVertex> packed(vertexCount);
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+
+	std::unique_ptr<Mesh> mesh;
+	double buildTime = timeMilliseconds([&]()
+	{
+		MeshNormals::calcAverageNormals(indices.data(), indiceCount, source.data(), (unsigned int)source.size(), 8, 5);
+		VertexPacking::packStandardVertices(source.data(), vertexCount, 8, packed.data(), &positionScale.x, &positionOffset.x);
+		mesh = std::make_unique<Mesh>(packed.data(), vertexCount, PackedVertexLayout::desc, indices.data(), indiceCount);
+		glFinish();
+	});
+	mesh.reset();
+
+	MeshCacheSource grid = { "grid", PackedVertexLayout::desc, packed.data(), vertexCount,
+		indices.data(), indiceCount, GL_UNSIGNED_INT, positionScale, positionOffset, 0 };
+	std::filesystem::create_directories("Cache");
+	if (!MeshCache::write(cacheFile, { grid }))
+	{
+		return;
+	}
+
+	MeshCache cache;
+	double loadTime = timeMilliseconds([&]()
+	{
+		if (cache.open(cacheFile))
+		{
+			mesh = cache.createMesh(0);
+			glFinish();
+		}
+	});
+
+	printf("MeshCache: %u vertices, build from source %.2f ms, load from cache %.2f ms (%.1fx, file in OS cache)\n",
+		vertexCount, buildTime, loadTime, buildTime / loadTime);
+}
+
+bool Benchmarks::writeObj(const char* fileLocation, const std::vector<GLfloat>& vertices, const std::vector<unsigned int>& indices, unsigned int objectCount)
+{
+	FILE* file = fopen(fileLocation, "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	size_t vertexCount = vertices.size() / 8;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		const GLfloat* vertex = &vertices[v * 8];
+		fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+			vertex[0], vertex[1], vertex[2], vertex[3], 1.f - vertex[4], vertex[5], vertex[6], vertex[7]);
+	}
+
+	size_t triangleCount = indices.size() / 3;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (t % ((triangleCount + objectCount - 1) / objectCount) == 0)
+		{
+			fprintf(file, "o part%zu\n", t);
+		}
+
+		unsigned int a = indices[t * 3] + 1, b = indices[t * 3 + 1] + 1, c = indices[t * 3 + 2] + 1;
+		fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+	}
+
+	fclose(file);
+	return true;
+}
+
+bool Benchmarks::writeGlb(const char* fileLocation, const std::vector<GLfloat>& vertices, const std::vector<unsigned int>& indices)
+{
+	size_t vertexCount = vertices.size() / 8;
+	size_t vertexBytes = vertices.size() * sizeof(GLfloat);
+	size_t indexBytes = indices.size() * sizeof(GLuint);
+
+	char json[2048];
+	int jsonLength = snprintf(json, sizeof(json),
+		"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":%zu}],"
+		"\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu,\"byteStride\":32},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+		"\"accessors\":[{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+		"{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC2\"},"
+		"{\"bufferView\":0,\"byteOffset\":20,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+		"{\"bufferView\":1,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],"
+		"\"meshes\":[{\"name\":\"grid\",\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1,\"NORMAL\":2},\"indices\":3}]}]}",
+		vertexBytes + indexBytes, vertexBytes, vertexBytes, indexBytes, vertexCount, vertexCount, vertexCount, indices.size());
+
+	while (jsonLength % 4 != 0)
+	{
+		json[jsonLength++] = ' ';
+	}
+
+	GLuint binaryLength = (GLuint)(vertexBytes + indexBytes);
+	GLuint header[5] = { 0x46546c67, 2, (GLuint)(12 + 8 + jsonLength + 8 + binaryLength), (GLuint)jsonLength, 0x4e4f534a };
+	GLuint binaryHeader[2] = { binaryLength, 0x004e4942 };
+
+	FILE* file = fopen(fileLocation, "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	fwrite(header, sizeof(header), 1, file);
+	fwrite(json, 1, jsonLength, file);
+	fwrite(binaryHeader, sizeof(binaryHeader), 1, file);
+	fwrite(vertices.data(), 1, vertexBytes, file);
+	fwrite(indices.data(), 1, indexBytes, file);
+	fclose(file);
+	return true;
+}
+
+void Benchmarks::benchImport()
+{
+	const char* objFile = "Cache/benchmark.obj";
+	const char* glbFile = "Cache/benchmark.glb";
+
+	std::vector<GLfloat> vertices;
+	std::vector<unsigned int> indices;
+	generateGrid(1024, vertices, indices);
+	MeshNormals::calcAverageNormals(indices.data(), (unsigned int)indices.size(), vertices.data(), (unsigned int)vertices.size(), 8, 5);
+
+	std::filesystem::create_directories("Cache");
+	if (!writeObj(objFile, vertices, indices, 16) || !writeGlb(glbFile, vertices, indices))
+	{
+		printf("ERROR::Benchmarks::benchImport failed to write the test files\n");
+		return;
+	}
+
+	printf("MeshImporter: %u threads\n", ThreadPool::getShared().getParallelThreadCount() + 1);
+
+	const char* files[] = { objFile, glbFile };
+	for (const char* file : files)
+	{
+		size_t largestMesh = 0;
+		ImportStats stats;
+		MeshImporter::importFile(file, [&](ImportedMesh& mesh)
+		{
+			largestMesh = std::max(largestMesh, mesh.vertices.size() * sizeof(GLfloat) + mesh.indices.size() * sizeof(GLuint));
+		}, &stats);
+
+		MeshImporter::printStats(file, stats);
+		printf("  largest mesh handed out %.1f MB\n", largestMesh / (1024.0 * 1024.0));
+	}
+
+	std::error_code error;
+	std::filesystem::remove(objFile, error);
+	std::filesystem::remove(glbFile, error);
+}
+
+void Benchmarks::benchSimplify()
+{
+	std::vector<GLfloat> vertices;
+	std::vector<unsigned int> indices;
+	generateGrid(1024, vertices, indices);
+
+	std::vector<unsigned int> lodIndices;
+	std::vector<MeshLod> lods;
+	LodChainReport report = MeshSimplifier::buildLodChain(vertices.data(), (unsigned int)vertices.size() / 8, sizeof(GLfloat) * 8,
+		indices.data(), (unsigned int)indices.size(), 6, 0.5f, 1.f, lodIndices, lods);
+	MeshSimplifier::printReport("grid 1024", report);
+}
+
+void Benchmarks::benchMeshlets()
+{
+	std::vector<GLfloat> vertices;
+	std::vector<unsigned int> indices;
+	generateGrid(1024, vertices, indices);
+
+	// Bend the grid into a half cylinder so part of it faces away from the camera.
+	for (size_t i = 0; i < vertices.size(); i += 8)
+	{
+		GLfloat angle = vertices[i] * 1.5f;
+		vertices[i] = sinf(angle);
+		vertices[i + 1] = -cosf(angle);
+	}
+
+	std::vector<Meshlet> meshlets;
+	double buildTime = timeMilliseconds([&]()
+	{
+		MeshletBuilder::buildMeshlets(indices.data(), (unsigned int)indices.size(), vertices.data(), (unsigned int)vertices.size() / 8,
+			sizeof(GLfloat) * 8, meshlets);
+	});
+
+	GLuint totalTriangles = (GLuint)indices.size() / 3;
+	printf("MeshletBuilder: %zu meshlets (%.1f triangles each) in %.2f ms\n",
+		meshlets.size(), (double)totalTriangles / meshlets.size(), buildTime);
+
+	glm::mat4 projection = glm::perspective(45.0f, 16.f / 9.f, 0.1f, 100.f);
+	glm::vec3 cameraPositions[] = { glm::vec3(0.f, -3.f, 0.f), glm::vec3(0.5f, -1.5f, 0.5f), glm::vec3(0.f, 2.f, 0.f) };
+
+	for (const glm::vec3& cameraPosition : cameraPositions)
+	{
+		glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.f, 0.f, cameraPosition.z), glm::vec3(0.f, 0.f, 1.f));
+		Frustum frustum(projection * view);
+		std::vector<IndexRange> ranges;
+
+		GLuint visible = 0;
+		double cullTime = timeMilliseconds([&]()
+		{
+			visible = MeshletBuilder::cullMeshlets(meshlets, frustum, cameraPosition, ranges);
+		});
+
+		printf("  camera (%.1f, %.1f, %.1f): %u of %u triangles submitted (%.0f%% culled) in %zu ranges, %.3f ms\n",
+			cameraPosition.x, cameraPosition.y, cameraPosition.z, visible, totalTriangles,
+			100.0 * (1.0 - (double)visible / totalTriangles), ranges.size(), cullTime);
+	}
+}
+
+void Benchmarks::benchMeshUpdates()
+{
+	const unsigned int gridSize = 512;
+	const int iterations = 20;
+
+	std::vector<GLfloat> vertices;
+	std::vector<unsigned int> indices;
+	generateGrid(gridSize, vertices, indices);
+
+	unsigned int vertexCount = (unsigned int)vertices.size() / 8;
+	unsigned int indiceCount = (unsigned int)indices.size();
+	unsigned int rowLength = gridSize + 1;
+
+	printf("Mesh updates: %u vertices, %d edits each\n", vertexCount, iterations);
+
+	// A small edit raises one row of the terrain, a large one a quarter of it.
+	unsigned int editRows[] = { 1, rowLength / 4 };
+	for (unsigned int rows : editRows)
+	{
+		unsigned int editVertices = rows * rowLength;
+
+		auto deform = [&](int iteration)
+		{
+			unsigned int firstRow = (iteration * 37) % (rowLength - rows);
+			for (unsigned int v = firstRow * rowLength; v < (firstRow + rows) * rowLength; v++)
+			{
+				vertices[(size_t)v * 8 + 1] += 0.01f;
+			}
+			return firstRow * rowLength;
+		};
+
+		std::unique_ptr<Mesh> mesh;
+		double rebuildTime = timeMilliseconds([&]()
+		{
+			for (int i = 0; i < iterations; i++)
+			{
+				deform(i);
+				mesh = std::make_unique<Mesh>(vertices.data(), vertexCount, StandardVertexLayout::desc, indices.data(), indiceCount);
+				glFinish();
+			}
+		});
+
+		double updateTime = timeMilliseconds([&]()
+		{
+			for (int i = 0; i < iterations; i++)
+			{
+				unsigned int firstVertex = deform(i);
+				mesh->updateVertices(firstVertex, &vertices[(size_t)firstVertex * 8], editVertices);
+				mesh->flushUpdates();
+				glFinish();
+			}
+		});
+
+		double replaceTime = timeMilliseconds([&]()
+		{
+			for (int i = 0; i < iterations; i++)
+			{
+				deform(i);
+				mesh->replaceVertices(vertices.data());
+				glFinish();
+			}
+		});
+
+		printf("  %6u vertices edited: rebuild %7.3f ms, partial update %7.3f ms (%.1fx), orphan and replace %7.3f ms\n",
+			editVertices, rebuildTime / iterations, updateTime / iterations, rebuildTime / updateTime, replaceTime / iterations);
+	}
+
+	// Scattered single vertex edits to one area coalesce into a single upload.
+	std::unique_ptr<Mesh> mesh = std::make_unique<Mesh>(vertices.data(), vertexCount, StandardVertexLayout::desc, indices.data(), indiceCount);
+	GLuint callsBefore = mesh->getUpdateUploadCalls();
+	for (unsigned int v = 0; v < rowLength * 4; v++)
+	{
+		unsigned int vertex = (v * 7) % (rowLength * 4);
+		mesh->updateVertices(vertex, &vertices[(size_t)vertex * 8], 1);
+	}
+	mesh->flushUpdates();
+	printf("  %u single vertex writes coalesced into %u uploads\n", rowLength * 4, mesh->getUpdateUploadCalls() - callsBefore);
+}
+
+void Benchmarks::benchMipGeneration()
+{
+	const int size = 4096;
+	const int iterations = 3;
+
+	// Smooth gradients with fine noise on top, so the sharper filters have detail to keep.
+	std::vector<unsigned char> pixels((size_t)size * size * 4);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			unsigned char* texel = &pixels[((size_t)y * size + x) * 4];
+			unsigned int noise = ((unsigned int)(x * 73856093) ^ (unsigned int)(y * 19349663)) >> 24;
+			texel[0] = (unsigned char)((x * 255 / size + noise / 4) & 255);
+			texel[1] = (unsigned char)((y * 255 / size + noise / 4) & 255);
+			texel[2] = (unsigned char)noise;
+			texel[3] = 255;
+		}
+	}
+
+	double megatexels = (double)size * size / 1000000.0;
+	printf("Mip generation: %dx%d RGBA8, sRGB correct, %u threads\n", size, size, ThreadPool::getShared().getParallelThreadCount() + 1);
+
+	Ktx2Image chain;
+	MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos };
+	for (MipFilter filter : filters)
+	{
+		double buildTime = timeMilliseconds([&]()
+		{
+			for (int i = 0; i < iterations; i++)
+			{
+				MipGenerator::buildMipChain(pixels.data(), size, size, 4, chain, filter, true);
+			}
+		}) / iterations;
+		printf("  CPU %-7s %8.2f ms, %7.1f Mtexels/s\n", MipGenerator::getFilterName(filter), buildTime, megatexels * 1000.0 / buildTime);
+	}
+
+	// The driver path Texture used before: upload level 0 and let glGenerateMipmap build the rest.
+	// An sRGB format makes the driver filter in linear light too.
+	GLsizei levelCount = (GLsizei)chain.getLevelCount();
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_SRGB8_ALPHA8, size, size);
+	}
+	else
+	{
+		for (GLsizei level = 0; level < levelCount; level++)
+		{
+			GLsizei levelSize = std::max(1, size >> level);
+			glTexImage2D(GL_TEXTURE_2D, level, GL_SRGB8_ALPHA8, levelSize, levelSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+	}
+	glFinish();
+
+	double uploadTime = 0.0;
+	double generateTime = 0.0;
+	double chainUploadTime = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		uploadTime += timeMilliseconds([&]()
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			glFinish();
+		});
+		generateTime += timeMilliseconds([&]()
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glFinish();
+		});
+		chainUploadTime += timeMilliseconds([&]()
+		{
+			for (GLsizei level = 0; level < levelCount; level++)
+			{
+				GLsizei levelSize = std::max(1, size >> level);
+				glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelSize, levelSize, GL_RGBA, GL_UNSIGNED_BYTE, chain.getLevelData(level));
+			}
+			glFinish();
+		});
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDeleteTextures(1, &texture);
+
+	printf("  driver  %8.2f ms, %7.1f Mtexels/s (glGenerateMipmap only)\n", generateTime / iterations, megatexels * 1000.0 * iterations / generateTime);
+	printf("  loading from the cache uploads the whole chain in %.2f ms, against %.2f ms for level 0 then glGenerateMipmap\n",
+		chainUploadTime / iterations, (uploadTime + generateTime) / iterations);
+}
+
+void Benchmarks::benchTextureLoading()
+{
+	const char* cookedDirectory = "Cache/Cooked";
+	const int iterations = 10;
+
+	std::error_code error;
+	std::filesystem::create_directories(cookedDirectory, error);
+
+	printf("Texture loading: PNG against cooked KTX2, every file already in the OS cache\n");
+	printf("  hashed cache: hash the PNG to find its cache entry and map that\n");
+	printf("  cooked read: read the KTX2, unchecked; cooked load: map it and hash the PNG to check it is current\n");
+
+	double decodeTotal = 0.0;
+	double lookupTotal = 0.0;
+	double readTotal = 0.0;
+	double mapTotal = 0.0;
+	for (const auto& entry : std::filesystem::directory_iterator("Textures", error))
+	{
+		if (entry.path().extension() != ".png")
+		{
+			continue;
+		}
+
+		// Cooked beside a copy, so the real textures are left alone.
+		std::string source = (std::filesystem::path(cookedDirectory) / entry.path().filename()).string();
+		std::filesystem::copy_file(entry.path(), source, std::filesystem::copy_options::overwrite_existing, error);
+
+		Ktx2Image image;
+		if (!TextureCompressor::cook(source.c_str(), cookedDirectory, Texture::getMipFilter(), Texture::getMipsInLinearLight(), image))
+		{
+			printf("ERROR::Benchmarks::benchTextureLoading failed to cook %s\n", source.c_str());
+			continue;
+		}
+		std::string cooked = TextureCompressor::getCookedLocation(source.c_str());
+		GLuint vkFormat = image.vkFormat;
+		size_t byteSize = image.getByteSize();
+
+		// Decode only: building the mips on top of this is benchMipGeneration.
+		double decodeTime = timeMilliseconds([&]()
+		{
+			for (int i = 0; i < iterations; i++)
+			{
+				int width, height, channels;
+				unsigned char* pixels = stbi_load(source.c_str(), &width, &height, &channels, 0);
+				stbi_image_free(pixels);
+			}
+		}) / iterations;
+
+		// What an uncooked load costs at best: hashing the source to find its cache entry.
+		double lookupTime = timeMilliseconds([&]()
+		{
+			for (int i = 0; i < iterations; i++)
+			{
+				bool fromCache = false;
+				if (!TextureCompressor::loadOrCompress(source.c_str(), cookedDirectory, Texture::getMipFilter(), Texture::getMipsInLinearLight(), image, fromCache))
+				{
+					TextureCompressor::loadOrBuildMips(source.c_str(), cookedDirectory, Texture::getMipFilter(), Texture::getMipsInLinearLight(), image, fromCache);
+				}
+			}
+		}) / iterations;
+
+		double readTime = timeMilliseconds([&]()
+		{
+			for (int i = 0; i < iterations; i++)
+			{
+				Ktx2File::read(cooked.c_str(), image);
+			}
+		}) / iterations;
+
+		// Touches every page, so the map is charged for the faults a read would have paid up front.
+		volatile unsigned char touched = 0;
+		double mapTime = timeMilliseconds([&]()
+		{
+			for (int i = 0; i < iterations; i++)
+			{
+				bool fromCache = false;
+				TextureCompressor::loadCooked(source.c_str(), Texture::getMipFilter(), Texture::getMipsInLinearLight(), true, image, fromCache);
+				for (size_t level = 0; level < image.getLevelCount(); level++)
+				{
+					const unsigned char* data = image.getLevelData(level);
+					for (size_t offset = 0; offset < image.getLevelBytes(level); offset += 4096)
+					{
+						touched = data[offset];
+					}
+				}
+			}
+		}) / iterations;
+		image = Ktx2Image();
+
+		printf("  %-16s %s, %6zu KB: PNG decode %7.2f ms, hashed cache %6.2f ms, cooked read %5.2f ms, cooked load %5.2f ms\n",
+			entry.path().filename().string().c_str(), TextureCompressor::getName(vkFormat), byteSize / 1024,
+			decodeTime, lookupTime, readTime, mapTime);
+
+		decodeTotal += decodeTime;
+		lookupTotal += lookupTime;
+		readTotal += readTime;
+		mapTotal += mapTime;
+	}
+
+	printf("  total: PNG decode %.2f ms, hashed cache %.2f ms, cooked read %.2f ms, cooked load %.2f ms (%.1fx faster than decoding)\n",
+		decodeTotal, lookupTotal, readTotal, mapTotal, mapTotal > 0.0 ? decodeTotal / mapTotal : 0.0);
+
+	std::filesystem::remove_all(cookedDirectory, error);
+}
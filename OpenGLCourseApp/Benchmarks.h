@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+// Run with "--bench" on the command line; results are printed to stdout.
+namespace Benchmarks
+{
+	void runAll();
+
+	void benchAverageNormals();
+	void benchTangents();
+	void benchWelding();
+	void benchMeshCache();
+	void benchImport();
+	void benchSimplify();
+	void benchMeshlets();
+	void benchMeshUpdates();
+	void benchMipGeneration();
+	void benchTextureLoading();
+
+	bool writeObj(const char* fileLocation, const std::vector<GLfloat>& vertices, const std::vector<unsigned int>& indices, unsigned int objectCount);
+	bool writeGlb(const char* fileLocation, const std::vector<GLfloat>& vertices, const std::vector<unsigned int>& indices);
+	// Flat grid of gridSize x gridSize quads in StandardVertexLayout with a little height noise.
+	void generateGrid(unsigned int gridSize, std::vector<GLfloat>& vertices, std::vector<unsigned int>& indices);
+}
@@ -0,0 +1,149 @@
+#include "BindlessTextureTable.h"
+
+BindlessTextureTable::BindlessTextureTable()
+{
+	handleBuffer = 0;
+	handleCapacity = 0;
+	dirty = false;
+}
+
+bool BindlessTextureTable::isSupported()
+{
+	return GLEW_ARB_bindless_texture && GLEW_ARB_shader_storage_buffer_object;
+}
+
+GLuint BindlessTextureTable::findOrAdd(Texture* texture)
+{
+	auto found = indices.find(texture);
+	if (found != indices.end())
+	{
+		return found->second;
+	}
+
+	GLuint index = (GLuint)entries.size();
+	entries.push_back({ texture, 0 });
+	handles.push_back(0);
+	indices[texture] = index;
+	dirty = true;
+	return index;
+}
+
+void BindlessTextureTable::update()
+{
+	std::vector<GLuint> textureIDs(entries.size());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		entries[i].texture->updateLoad();
+		textureIDs[i] = entries[i].texture->getTextureID();
+	}
+
+	// Texture deletes a texture it replaces, which also ends that handle's residency, and GL can
+	// hand the freed name straight to another entry's new texture. So every replaced name is dropped
+	// before any handle is looked up. The only ones kept are those an unchanged entry still holds,
+	// such as the placeholder.
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		GLuint oldID = entries[i].textureID;
+		if (oldID == 0 || oldID == textureIDs[i])
+		{
+			continue;
+		}
+
+		bool stillHeld = false;
+		for (size_t j = 0; j < entries.size() && !stillHeld; j++)
+		{
+			stillHeld = entries[j].textureID == oldID && textureIDs[j] == oldID;
+		}
+		if (!stillHeld)
+		{
+			residentHandles.erase(oldID);
+		}
+	}
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (textureIDs[i] != entries[i].textureID)
+		{
+			entries[i].textureID = textureIDs[i];
+			handles[i] = getResidentHandle(textureIDs[i]);
+			dirty = true;
+		}
+	}
+
+	if (!dirty || handles.empty())
+	{
+		return;
+	}
+
+	GLsizeiptr size = handles.size() * sizeof(GLuint64);
+	if (handleBuffer == 0)
+	{
+		glGenBuffers(1, &handleBuffer);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, handleBuffer);
+	if (size > handleCapacity)
+	{
+		handleCapacity = size * 2;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, handleCapacity, NULL, GL_DYNAMIC_DRAW);
+	}
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, handles.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	dirty = false;
+}
+
+void BindlessTextureTable::bind()
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, handleBinding, handleBuffer);
+}
+
+void BindlessTextureTable::clearBindlessTextureTable()
+{
+	for (auto& resident : residentHandles)
+	{
+		if (glIsTexture(resident.first))
+		{
+			glMakeTextureHandleNonResidentARB(resident.second);
+		}
+	}
+
+	if (handleBuffer != 0)
+	{
+		glDeleteBuffers(1, &handleBuffer);
+		handleBuffer = 0;
+	}
+
+	handleCapacity = 0;
+	entries.clear();
+	indices.clear();
+	residentHandles.clear();
+	handles.clear();
+	dirty = false;
+}
+
+BindlessTextureTable::~BindlessTextureTable()
+{
+	clearBindlessTextureTable();
+}
+
+GLuint64 BindlessTextureTable::getResidentHandle(GLuint textureID)
+{
+	auto found = residentHandles.find(textureID);
+	if (found != residentHandles.end())
+	{
+		return found->second;
+	}
+
+	// The texture's sampling state is frozen from here on.
+	GLuint64 handle = glGetTextureHandleARB(textureID);
+	if (handle == 0)
+	{
+		printf("ERROR::BindlessTextureTable::getResidentHandle no handle for texture %u\n", textureID);
+		return 0;
+	}
+
+	glMakeTextureHandleResidentARB(handle);
+	residentHandles[textureID] = handle;
+	return handle;
+}
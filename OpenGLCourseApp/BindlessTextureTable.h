@@ -0,0 +1,54 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "Texture.h"
+
+// Gives each Texture a resident ARB_bindless_texture handle and keeps them in a shader storage
+// buffer that Shaders/bindless.frag indexes with the per draw texture index, so drawing needs no
+// texture binds at all. Textures still loading use the placeholder's handle until they finish.
+class BindlessTextureTable
+{
+public:
+	static const GLuint handleBinding = 2;
+	static const GLuint invalidIndex = 0xFFFFFFFF;
+
+	BindlessTextureTable();
+
+	static bool isSupported();
+
+	// Returns texture's index, adding it the first time.
+	GLuint findOrAdd(Texture* texture);
+	// Picks up finished loads and re-uploads the table if any handle changed. Call once a frame
+	// before drawing.
+	void update();
+	void bind();
+
+	GLuint getTextureCount() { return (GLuint)entries.size(); }
+	GLuint getResidentCount() { return (GLuint)residentHandles.size(); }
+
+	void clearBindlessTextureTable();
+
+	~BindlessTextureTable();
+
+private:
+	struct Entry
+	{
+		Texture* texture;
+		GLuint textureID;
+	};
+
+	std::vector<Entry> entries;
+	std::unordered_map<Texture*, GLuint> indices;
+	// A texture's handle can only be made resident once, however many entries use it.
+	std::unordered_map<GLuint, GLuint64> residentHandles;
+	std::vector<GLuint64> handles;
+	GLuint handleBuffer;
+	GLsizeiptr handleCapacity;
+	bool dirty;
+
+	GLuint64 getResidentHandle(GLuint textureID);
+};
@@ -0,0 +1,356 @@
+#include "DrawList.h"
+
+#include <algorithm>
+
+#include <glm\gtc\type_ptr.hpp>
+
+DrawList::DrawList()
+{
+	indirectSupported = false;
+	textureManager = nullptr;
+	bindlessTable = nullptr;
+
+	drawIdBuffer = 0;
+	drawIdCapacity = 0;
+	uploadBuffer = 0;
+
+	visibleCount = 0;
+	culledCount = 0;
+	batchCount = 0;
+	submittedTriangles = 0;
+	clusterCulledTriangles = 0;
+}
+
+bool DrawList::init(GLuint startCapacity)
+{
+	// Shaders/indirect.vert is GLSL 4.30, so the extensions alone aren't enough under the 3.3 context
+	// Window asks for.
+	indirectSupported = GLEW_VERSION_4_3 && GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_base_instance;
+	if (!indirectSupported)
+	{
+		printf("DrawList::init GL 4.3 multi draw indirect unavailable, using per object draws\n");
+		return false;
+	}
+
+	// Room for startCapacity objects that each submit a few meshlet ranges.
+	streamBuffer.init(startCapacity * (sizeof(DrawData) + 4 * sizeof(DrawElementsIndirectCommand)));
+	glGenBuffers(1, &drawIdBuffer);
+
+	drawData.reserve(startCapacity);
+	reserveDrawIds(startCapacity);
+
+	return true;
+}
+
+void DrawList::begin(const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+{
+	frustum = Frustum(viewProjection);
+	this->viewProjection = viewProjection;
+	this->cameraPosition = cameraPosition;
+
+	if (indirectSupported)
+	{
+		streamBuffer.beginFrame();
+	}
+
+	drawData.clear();
+	fallbackDraws.clear();
+	meshletRanges.clear();
+	for (auto& batch : batches)
+	{
+		batch.commands.clear();
+	}
+
+	visibleCount = 0;
+	culledCount = 0;
+	batchCount = 0;
+	submittedTriangles = 0;
+	clusterCulledTriangles = 0;
+}
+
+bool DrawList::addDraw(Mesh* mesh, const glm::mat4& model, Texture* texture, Material* material)
+{
+	return addDraw(mesh, model, texture, TextureManager::invalidTexture, material);
+}
+
+bool DrawList::addDraw(Mesh* mesh, const glm::mat4& model, GLuint textureIndex, Material* material)
+{
+	return addDraw(mesh, model, nullptr, textureIndex, material);
+}
+
+bool DrawList::addDraw(Mesh* mesh, const glm::mat4& model, Texture* texture, GLuint textureIndex, Material* material)
+{
+	glm::vec3 centre = glm::vec3(model * glm::vec4(mesh->getBoundsCentre(), 1.f));
+	GLfloat maxScale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+	if (!frustum.containsSphere(centre, mesh->getBoundsRadius() * maxScale))
+	{
+		culledCount++;
+		return false;
+	}
+
+	size_t firstRange = meshletRanges.size();
+	if (mesh->hasMeshlets() && mesh->getCurrentLod() == 0)
+	{
+		// Cull clusters in model space, where the cone test is exact even under non-uniform scale.
+		Frustum modelFrustum(viewProjection * model);
+		glm::vec3 modelCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.f));
+		GLuint visibleTriangles = MeshletBuilder::cullMeshlets(mesh->getMeshlets(), modelFrustum, modelCamera, meshletRanges);
+
+		clusterCulledTriangles += (GLuint)mesh->getDrawIndexCount() / 3 - visibleTriangles;
+		if (visibleTriangles == 0)
+		{
+			culledCount++;
+			return false;
+		}
+		submittedTriangles += visibleTriangles;
+	}
+	else
+	{
+		meshletRanges.push_back({ mesh->getDrawFirstIndex(), mesh->getDrawIndexCount() });
+		submittedTriangles += (GLuint)mesh->getDrawIndexCount() / 3;
+	}
+	size_t rangeCount = meshletRanges.size() - firstRange;
+
+	visibleCount++;
+	mesh->flushUpdates();
+
+	if (bindlessTable && texture)
+	{
+		textureIndex = bindlessTable->findOrAdd(texture);
+		texture = nullptr;
+	}
+
+	if (!indirectSupported)
+	{
+		fallbackDraws.push_back({ mesh, texture, textureIndex, material, model, firstRange, rangeCount, invalidDrawId });
+		return true;
+	}
+
+	GLuint drawId = (GLuint)drawData.size();
+
+	DrawData data;
+	data.model = model;
+	data.positionScale = glm::vec4(mesh->getPositionScale(), material ? material->getSpecularIntensity() : 0.f);
+	data.positionOffset = glm::vec4(mesh->getPositionOffset(), material ? material->getShininess() : 0.f);
+	data.textureIndex = texture ? TextureManager::invalidTexture : textureIndex;
+	drawData.push_back(data);
+
+	// Meshes outside an arena are drawn one at a time, but still read their DrawData.
+	GeometryArena* arena = mesh->getArena();
+	if (!arena)
+	{
+		fallbackDraws.push_back({ mesh, texture, textureIndex, material, model, firstRange, rangeCount, drawId });
+		return true;
+	}
+
+	const ArenaAllocation& allocation = mesh->getAllocation();
+	GLuint textureArray = texture == nullptr && textureManager && !bindlessTable ? textureManager->getArrayTexture(textureIndex) : 0;
+	Batch& batch = findBatch(arena, texture, textureArray, allocation.indexType);
+
+	for (size_t i = firstRange; i < meshletRanges.size(); i++)
+	{
+		DrawElementsIndirectCommand command;
+		command.count = (GLuint)meshletRanges[i].indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = (GLuint)(allocation.indexByteOffset / Mesh::getIndexSize(allocation.indexType)) + meshletRanges[i].firstIndex;
+		command.baseVertex = allocation.baseVertex;
+		command.baseInstance = drawId;
+		batch.commands.push_back(command);
+	}
+	return true;
+}
+
+void DrawList::submit(Shader* shader)
+{
+	if (bindlessTable)
+	{
+		bindlessTable->update();
+		bindlessTable->bind();
+	}
+
+	if (!drawData.empty())
+	{
+		reserveDrawIds((GLuint)drawData.size());
+
+		commandUpload.clear();
+		for (auto& batch : batches)
+		{
+			commandUpload.insert(commandUpload.end(), batch.commands.begin(), batch.commands.end());
+		}
+
+		GLsizeiptr drawDataBytes = drawData.size() * sizeof(DrawData);
+		GLsizeiptr commandBytes = commandUpload.size() * sizeof(DrawElementsIndirectCommand);
+		GLsizeiptr commandStart = (drawDataBytes + streamBuffer.getAlignment() - 1) / streamBuffer.getAlignment() * streamBuffer.getAlignment();
+
+		GLuint buffer = 0;
+		GLintptr drawDataOffset = -1;
+		GLintptr commandBase = -1;
+		if (streamBuffer.reserve(commandStart + commandBytes))
+		{
+			buffer = streamBuffer.getBuffer();
+			drawDataOffset = streamBuffer.write(drawData.data(), drawDataBytes);
+			commandBase = streamBuffer.write(commandUpload.data(), commandBytes);
+		}
+
+		if (drawDataOffset < 0 || commandBase < 0)
+		{
+			// The ring couldn't take this frame, so orphan a plain buffer instead.
+			if (uploadBuffer == 0)
+			{
+				printf("ERROR::DrawList::submit stream buffer unavailable, uploading draw data per frame\n");
+				glGenBuffers(1, &uploadBuffer);
+			}
+			glBindBuffer(GL_COPY_WRITE_BUFFER, uploadBuffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, commandStart + commandBytes, nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, 0, drawDataBytes, drawData.data());
+			glBufferSubData(GL_COPY_WRITE_BUFFER, commandStart, commandBytes, commandUpload.data());
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+			buffer = uploadBuffer;
+			drawDataOffset = 0;
+			commandBase = commandStart;
+		}
+
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, drawDataBinding, buffer, drawDataOffset, drawDataBytes);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+
+		size_t commandOffset = 0;
+		for (auto& batch : batches)
+		{
+			if (batch.commands.empty())
+			{
+				continue;
+			}
+
+			attachArena(batch.arena);
+			batch.arena->bind();
+			if (batch.texture)
+			{
+				batch.texture->useTexture();
+			}
+			else if (!bindlessTable)
+			{
+				TextureManager::bindArrayTexture(batch.textureArray);
+			}
+
+			glMultiDrawElementsIndirect(GL_TRIANGLES, batch.indexType,
+				(void*)(commandBase + commandOffset * sizeof(DrawElementsIndirectCommand)), (GLsizei)batch.commands.size(), 0);
+
+			commandOffset += batch.commands.size();
+			batchCount++;
+		}
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	for (auto& draw : fallbackDraws)
+	{
+		if (draw.texture)
+		{
+			draw.texture->useTexture();
+		}
+		else if (!bindlessTable)
+		{
+			TextureManager::bindArrayTexture(textureManager ? textureManager->getArrayTexture(draw.textureIndex) : 0);
+		}
+
+		if (draw.drawId != invalidDrawId)
+		{
+			// The mesh's vertex array has no drawId array, so the attribute's current value is used.
+			glVertexAttribI1ui(drawIdLocation, draw.drawId);
+		}
+		else
+		{
+			glUniformMatrix4fv(shader->getModelLocation(), 1, GL_FALSE, glm::value_ptr(draw.model));
+			glUniform1i(shader->getTextureIndexLocation(), draw.texture ? -1 : (GLint)draw.textureIndex);
+			if (draw.material)
+			{
+				draw.material->useMaterial(shader->getSpecularIntensityLocation(), shader->getShininessLocation());
+			}
+			draw.mesh->usePositionQuantisation(shader->getPositionScaleLocation(), shader->getPositionOffsetLocation());
+		}
+		draw.mesh->renderRanges(meshletRanges.data() + draw.firstRange, draw.rangeCount);
+		batchCount++;
+	}
+
+	if (indirectSupported)
+	{
+		streamBuffer.endFrame();
+	}
+}
+
+void DrawList::clearDrawList()
+{
+	streamBuffer.clearStreamRingBuffer();
+
+	if (drawIdBuffer != 0)
+	{
+		glDeleteBuffers(1, &drawIdBuffer);
+		drawIdBuffer = 0;
+	}
+
+	if (uploadBuffer != 0)
+	{
+		glDeleteBuffers(1, &uploadBuffer);
+		uploadBuffer = 0;
+	}
+
+	drawIdCapacity = 0;
+	drawData.clear();
+	batches.clear();
+	fallbackDraws.clear();
+	meshletRanges.clear();
+	attachedArenas.clear();
+}
+
+DrawList::~DrawList()
+{
+	clearDrawList();
+}
+
+DrawList::Batch& DrawList::findBatch(GeometryArena* arena, Texture* texture, GLuint textureArray, GLenum indexType)
+{
+	for (auto& batch : batches)
+	{
+		if (batch.arena == arena && batch.texture == texture && batch.textureArray == textureArray && batch.indexType == indexType)
+		{
+			return batch;
+		}
+	}
+
+	batches.push_back({ arena, texture, textureArray, indexType, {} });
+	return batches.back();
+}
+
+void DrawList::reserveDrawIds(GLuint count)
+{
+	if (count <= drawIdCapacity)
+	{
+		return;
+	}
+
+	GLuint newCapacity = std::max(count, drawIdCapacity * 2);
+	std::vector<GLuint> ids(newCapacity);
+	for (GLuint i = 0; i < newCapacity; i++)
+	{
+		ids[i] = i;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+	glBufferData(GL_ARRAY_BUFFER, newCapacity * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	drawIdCapacity = newCapacity;
+}
+
+void DrawList::attachArena(GeometryArena* arena)
+{
+	if (std::find(attachedArenas.begin(), attachedArenas.end(), arena) != attachedArenas.end())
+	{
+		return;
+	}
+
+	arena->attachInstanceAttribute(drawIdLocation, drawIdBuffer);
+	attachedArenas.push_back(arena);
+}
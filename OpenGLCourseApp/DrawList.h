@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "Frustum.h"
+#include "BindlessTextureTable.h"
+#include "GeometryArena.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "StreamRingBuffer.h"
+#include "Texture.h"
+#include "TextureManager.h"
+
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Matches DrawData in Shaders/indirect.vert (std430).
+struct DrawData
+{
+	glm::mat4 model;
+	glm::vec4 positionScale;
+	glm::vec4 positionOffset;
+	GLuint textureIndex;
+	GLuint padding[3];
+};
+
+// Gathers visible objects each frame and submits them with one glMultiDrawElementsIndirect per
+// arena/texture pair, streaming draw data and commands through a StreamRingBuffer. Draws that
+// use a TextureManager slot only split batches when their slots live in different arrays. Meshes with
+// meshlets drawn at LOD 0 only submit their visible clusters. Meshes outside a GeometryArena get a
+// draw call each but keep their DrawData; drivers without GL 4.3 indirect drawing fall back to per
+// object uniforms and draws through the shader passed to submit().
+class DrawList
+{
+public:
+	static const GLuint drawIdLocation = 15;
+	static const GLuint drawDataBinding = 0;
+	static const GLuint invalidDrawId = 0xFFFFFFFF;
+
+	DrawList();
+
+	bool init(GLuint startCapacity);
+	bool isIndirectSupported() { return indirectSupported; }
+
+	void begin(const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+	// Both return false if the draw was culled.
+	bool addDraw(Mesh* mesh, const glm::mat4& model, Texture* texture, Material* material);
+	// Samples slot textureIndex of the manager given to setTextureManager().
+	bool addDraw(Mesh* mesh, const glm::mat4& model, GLuint textureIndex, Material* material);
+	void setTextureManager(TextureManager* manager) { textureManager = manager; }
+	// Texture* draws then select their texture through table instead of binding it, which needs
+	// Shaders/bindless.frag. TextureManager slots can't be mixed with it.
+	void setBindlessTable(BindlessTextureTable* table) { bindlessTable = table; }
+	void submit(Shader* shader);
+
+	GLuint getVisibleCount() { return visibleCount; }
+	GLuint getCulledCount() { return culledCount; }
+	GLuint getBatchCount() { return batchCount; }
+	GLuint getSubmittedTriangles() { return submittedTriangles; }
+	GLuint getClusterCulledTriangles() { return clusterCulledTriangles; }
+	StreamRingBuffer& getStreamBuffer() { return streamBuffer; }
+
+	void clearDrawList();
+
+	~DrawList();
+
+private:
+	struct Batch
+	{
+		GeometryArena* arena;
+		Texture* texture;
+		GLuint textureArray;
+		GLenum indexType;
+		std::vector<DrawElementsIndirectCommand> commands;
+	};
+
+	struct FallbackDraw
+	{
+		Mesh* mesh;
+		Texture* texture;
+		GLuint textureIndex;
+		Material* material;
+		glm::mat4 model;
+		size_t firstRange;
+		size_t rangeCount;
+		// Index into drawData when drawn through the indirect shader, which takes no per object uniforms.
+		GLuint drawId;
+	};
+
+	bool indirectSupported;
+	TextureManager* textureManager;
+	BindlessTextureTable* bindlessTable;
+
+	StreamRingBuffer streamBuffer;
+	GLuint drawIdBuffer;
+	GLuint drawIdCapacity;
+	// Only created if streamBuffer fails.
+	GLuint uploadBuffer;
+
+	Frustum frustum;
+	glm::mat4 viewProjection;
+	glm::vec3 cameraPosition;
+	std::vector<IndexRange> meshletRanges;
+	std::vector<DrawData> drawData;
+	std::vector<Batch> batches;
+	std::vector<FallbackDraw> fallbackDraws;
+	std::vector<DrawElementsIndirectCommand> commandUpload;
+	std::vector<GeometryArena*> attachedArenas;
+
+	GLuint visibleCount;
+	GLuint culledCount;
+	GLuint batchCount;
+	GLuint submittedTriangles;
+	GLuint clusterCulledTriangles;
+
+	bool addDraw(Mesh* mesh, const glm::mat4& model, Texture* texture, GLuint textureIndex, Material* material);
+	Batch& findBatch(GeometryArena* arena, Texture* texture, GLuint textureArray, GLenum indexType);
+	void reserveDrawIds(GLuint count);
+	void attachArena(GeometryArena* arena);
+};
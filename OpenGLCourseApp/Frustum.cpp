@@ -0,0 +1,62 @@
+#include "Frustum.h"
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] = glm::vec4(0.f, 0.f, 0.f, 1.f);
+	}
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;
+	planes[5] = row3 - row2;
+
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+bool Frustum::containsSphere(const glm::vec3& centre, GLfloat radius)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (glm::dot(glm::vec3(planes[i]), centre) + planes[i].w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::containsBox(const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		glm::vec3 positive(
+			planes[i].x >= 0.f ? boxMax.x : boxMin.x,
+			planes[i].y >= 0.f ? boxMax.y : boxMin.y,
+			planes[i].z >= 0.f ? boxMax.z : boxMin.z);
+
+		if (glm::dot(glm::vec3(planes[i]), positive) + planes[i].w < 0.f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+Frustum::~Frustum()
+{
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+class Frustum
+{
+public:
+	Frustum();
+	Frustum(const glm::mat4& viewProjection);
+
+	bool containsSphere(const glm::vec3& centre, GLfloat radius);
+	bool containsBox(const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+	~Frustum();
+
+private:
+	glm::vec4 planes[6];
+};
@@ -0,0 +1,338 @@
+#include "GeometryArena.h"
+
+#include <memory>
+
+GLuint GeometryArena::boundVAO = 0;
+
+namespace
+{
+	GLsizeiptr getIndexBytes(unsigned int numOfIndices, GLenum indexType)
+	{
+		return (GLsizeiptr)numOfIndices * (indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+	}
+}
+
+GeometryArena::GeometryArena(const VertexLayoutDesc& vertexLayout, GLsizeiptr vertexCapacityBytes, GLsizeiptr indexCapacityBytes)
+{
+	layout = vertexLayout;
+	vertexAllocator = ArenaAllocator(vertexCapacityBytes / layout.stride);
+	indexAllocator = ArenaAllocator(indexCapacityBytes);
+	allocationCount = 0;
+	pendingAsync = 0;
+
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	glGenBuffers(1, &IBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexAllocator.getCapacity(), NULL, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertexAllocator.getCapacity() * layout.stride, NULL, GL_STATIC_DRAW);
+
+	layout.apply();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	boundVAO = 0;
+
+	copyVBO = VBO;
+	copyIBO = IBO;
+}
+
+bool GeometryArena::allocate(const void* vertices, unsigned int vertexCount, const void* indices, unsigned int numOfIndices, GLenum indexType, ArenaAllocation* allocation)
+{
+	// Writes from here are not ordered against what is queued on the upload context, so a queued
+	// growth could copy the buffer before this lands in it.
+	if (pendingAsync > 0)
+	{
+		return false;
+	}
+
+	if (!allocateRanges(vertexCount, numOfIndices, indexType, allocation, true))
+	{
+		return false;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferSubData(GL_ARRAY_BUFFER, (GLsizeiptr)allocation->baseVertex * layout.stride, (GLsizeiptr)vertexCount * layout.stride, vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, IBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, allocation->indexByteOffset, getIndexBytes(numOfIndices, indexType), indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return true;
+}
+
+bool GeometryArena::allocateAsync(UploadThread& uploader, GLuint vertexBuffer, unsigned int vertexCount, GLuint indexBuffer, unsigned int numOfIndices, GLenum indexType,
+	ArenaAllocation* allocation, UploadThread::ReadyFunction onReady)
+{
+	GLsizeiptr oldVertexCapacity = vertexAllocator.getCapacity();
+	GLsizeiptr oldIndexCapacity = indexAllocator.getCapacity();
+	bool allocated = allocateRanges(vertexCount, numOfIndices, indexType, allocation, false);
+
+	// Queued ahead of the copy, so the copy already lands in the grown buffer. Needed even if the
+	// other range failed, as later allocations can use what the allocator grew into.
+	if (vertexAllocator.getCapacity() != oldVertexCapacity)
+	{
+		queueGrowth(uploader, GL_ARRAY_BUFFER, oldVertexCapacity * layout.stride, vertexAllocator.getCapacity() * layout.stride);
+	}
+	if (indexAllocator.getCapacity() != oldIndexCapacity)
+	{
+		queueGrowth(uploader, GL_ELEMENT_ARRAY_BUFFER, oldIndexCapacity, indexAllocator.getCapacity());
+	}
+
+	if (!allocated)
+	{
+		return false;
+	}
+
+	GLsizeiptr vertexOffset = (GLsizeiptr)allocation->baseVertex * layout.stride;
+	GLsizeiptr vertexBytes = (GLsizeiptr)vertexCount * layout.stride;
+	GLsizeiptr indexOffset = allocation->indexByteOffset;
+	GLsizeiptr indexBytes = getIndexBytes(numOfIndices, indexType);
+
+	pendingAsync++;
+	uploader.submit([this, vertexBuffer, indexBuffer, vertexOffset, vertexBytes, indexOffset, indexBytes]() -> size_t
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, copyVBO);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, vertexOffset, vertexBytes);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, indexBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, copyIBO);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, indexOffset, indexBytes);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		GLuint sources[] = { vertexBuffer, indexBuffer };
+		glDeleteBuffers(2, sources);
+		return (size_t)(vertexBytes + indexBytes);
+	},
+	[this, onReady]()
+	{
+		pendingAsync--;
+		onReady();
+	});
+	return true;
+}
+
+void GeometryArena::queueGrowth(UploadThread& uploader, GLenum target, GLsizeiptr oldSize, GLsizeiptr newSize)
+{
+	std::shared_ptr<GLuint> grown = std::make_shared<GLuint>(0);
+
+	pendingAsync++;
+	uploader.submit([this, target, grown, oldSize, newSize]() -> size_t
+	{
+		// The old buffer stays, as the render thread keeps drawing from it until this is published.
+		GLuint& copyBuffer = target == GL_ARRAY_BUFFER ? copyVBO : copyIBO;
+		copyBuffer = copyToNewBuffer(copyBuffer, oldSize, newSize);
+		*grown = copyBuffer;
+		return (size_t)oldSize;
+	},
+	[this, target, grown]()
+	{
+		pendingAsync--;
+		GLuint& buffer = target == GL_ARRAY_BUFFER ? VBO : IBO;
+		glDeleteBuffers(1, &buffer);
+		buffer = *grown;
+		attachBuffer(target, buffer);
+	});
+}
+
+bool GeometryArena::allocateRanges(unsigned int vertexCount, unsigned int numOfIndices, GLenum indexType, ArenaAllocation* allocation, bool growBuffers)
+{
+	GLsizeiptr indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	GLsizeiptr indexBytes = getIndexBytes(numOfIndices, indexType);
+
+	GLsizeiptr vertexOffset = vertexAllocator.allocate(vertexCount);
+	if (vertexOffset == ArenaAllocator::invalidOffset)
+	{
+		growVertices(vertexCount, growBuffers);
+		vertexOffset = vertexAllocator.allocate(vertexCount);
+	}
+
+	GLsizeiptr indexOffset = indexAllocator.allocate(indexBytes, indexSize);
+	if (indexOffset == ArenaAllocator::invalidOffset)
+	{
+		growIndices(indexBytes, growBuffers);
+		indexOffset = indexAllocator.allocate(indexBytes, indexSize);
+	}
+
+	if (vertexOffset == ArenaAllocator::invalidOffset || indexOffset == ArenaAllocator::invalidOffset)
+	{
+		printf("ERROR::GeometryArena::allocate failed to allocate %u vertices and %u indices\n", vertexCount, numOfIndices);
+		vertexAllocator.release(vertexOffset, vertexCount);
+		indexAllocator.release(indexOffset, indexBytes);
+		return false;
+	}
+
+	allocation->baseVertex = (GLint)vertexOffset;
+	allocation->vertexCount = vertexCount;
+	allocation->indexByteOffset = indexOffset;
+	allocation->indexCount = numOfIndices;
+	allocation->indexType = indexType;
+
+	allocationCount++;
+	return true;
+}
+
+void GeometryArena::release(const ArenaAllocation& allocation)
+{
+	vertexAllocator.release(allocation.baseVertex, allocation.vertexCount);
+	GLsizeiptr indexSize = allocation.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	indexAllocator.release(allocation.indexByteOffset, (GLsizeiptr)allocation.indexCount * indexSize);
+	allocationCount--;
+}
+
+void GeometryArena::bind()
+{
+	if (boundVAO != VAO)
+	{
+		glBindVertexArray(VAO);
+		boundVAO = VAO;
+	}
+}
+
+void GeometryArena::attachInstanceAttribute(GLuint location, GLuint buffer)
+{
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, 0, 0);
+	glVertexAttribDivisor(location, 1);
+	glEnableVertexAttribArray(location);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	boundVAO = 0;
+}
+
+void GeometryArena::invalidateBinding()
+{
+	boundVAO = 0;
+}
+
+GeometryArenaStats GeometryArena::getStats()
+{
+	GeometryArenaStats stats;
+	stats.vertexBytesUsed = vertexAllocator.getUsed() * layout.stride;
+	stats.vertexBytesCapacity = vertexAllocator.getCapacity() * layout.stride;
+	stats.indexBytesUsed = indexAllocator.getUsed();
+	stats.indexBytesCapacity = indexAllocator.getCapacity();
+	stats.allocationCount = allocationCount;
+	stats.vertexFreeBlocks = vertexAllocator.getFreeBlockCount();
+	stats.indexFreeBlocks = indexAllocator.getFreeBlockCount();
+	stats.vertexFragmentation = vertexAllocator.getFragmentation();
+	stats.indexFragmentation = indexAllocator.getFragmentation();
+	return stats;
+}
+
+void GeometryArena::printStats()
+{
+	GeometryArenaStats stats = getStats();
+	printf("GeometryArena: %zu allocations\n", stats.allocationCount);
+	printf("  vertices: %lld / %lld bytes, %zu free blocks, %.1f%% fragmented\n",
+		(long long)stats.vertexBytesUsed, (long long)stats.vertexBytesCapacity, stats.vertexFreeBlocks, stats.vertexFragmentation * 100.f);
+	printf("  indices:  %lld / %lld bytes, %zu free blocks, %.1f%% fragmented\n",
+		(long long)stats.indexBytesUsed, (long long)stats.indexBytesCapacity, stats.indexFreeBlocks, stats.indexFragmentation * 100.f);
+}
+
+void GeometryArena::clearArena()
+{
+	if (IBO != 0)
+	{
+		glDeleteBuffers(1, &IBO);
+		IBO = 0;
+	}
+
+	if (VBO != 0)
+	{
+		glDeleteBuffers(1, &VBO);
+		VBO = 0;
+	}
+
+	copyVBO = 0;
+	copyIBO = 0;
+
+	if (VAO != 0)
+	{
+		if (boundVAO == VAO)
+		{
+			boundVAO = 0;
+		}
+		glDeleteVertexArrays(1, &VAO);
+		VAO = 0;
+	}
+}
+
+GeometryArena::~GeometryArena()
+{
+	clearArena();
+}
+
+GLuint GeometryArena::growBuffer(GLenum target, GLuint buffer, GLsizeiptr oldSize, GLsizeiptr newSize)
+{
+	GLuint newBuffer = copyToNewBuffer(buffer, oldSize, newSize);
+	glDeleteBuffers(1, &buffer);
+	attachBuffer(target, newBuffer);
+	return newBuffer;
+}
+
+GLuint GeometryArena::copyToNewBuffer(GLuint buffer, GLsizeiptr oldSize, GLsizeiptr newSize)
+{
+	GLuint newBuffer = 0;
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newSize, NULL, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return newBuffer;
+}
+
+void GeometryArena::attachBuffer(GLenum target, GLuint buffer)
+{
+	glBindVertexArray(VAO);
+	if (target == GL_ARRAY_BUFFER)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		layout.apply();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	else
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+	}
+	glBindVertexArray(0);
+	boundVAO = 0;
+}
+
+void GeometryArena::growVertices(GLsizeiptr minVertices, bool growBuffers)
+{
+	GLsizeiptr oldCapacity = vertexAllocator.getCapacity();
+	GLsizeiptr newCapacity = oldCapacity * 2 > oldCapacity + minVertices ? oldCapacity * 2 : oldCapacity + minVertices;
+
+	if (growBuffers)
+	{
+		VBO = growBuffer(GL_ARRAY_BUFFER, VBO, oldCapacity * layout.stride, newCapacity * layout.stride);
+		copyVBO = VBO;
+	}
+	vertexAllocator.grow(newCapacity);
+}
+
+void GeometryArena::growIndices(GLsizeiptr minBytes, bool growBuffers)
+{
+	GLsizeiptr oldCapacity = indexAllocator.getCapacity();
+	GLsizeiptr newCapacity = oldCapacity * 2 > oldCapacity + minBytes ? oldCapacity * 2 : oldCapacity + minBytes;
+
+	if (growBuffers)
+	{
+		IBO = growBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO, oldCapacity, newCapacity);
+		copyIBO = IBO;
+	}
+	indexAllocator.grow(newCapacity);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <GL\glew.h>
+
+#include "ArenaAllocator.h"
+#include "UploadThread.h"
+#include "VertexLayout.h"
+
+struct ArenaAllocation
+{
+	GLint baseVertex;
+	GLsizei vertexCount;
+	GLsizeiptr indexByteOffset;
+	GLsizei indexCount;
+	GLenum indexType;
+};
+
+struct GeometryArenaStats
+{
+	GLsizeiptr vertexBytesUsed;
+	GLsizeiptr vertexBytesCapacity;
+	GLsizeiptr indexBytesUsed;
+	GLsizeiptr indexBytesCapacity;
+	size_t allocationCount;
+	size_t vertexFreeBlocks;
+	size_t indexFreeBlocks;
+	GLfloat vertexFragmentation;
+	GLfloat indexFragmentation;
+};
+
+class GeometryArena
+{
+public:
+	GeometryArena(const VertexLayoutDesc& vertexLayout, GLsizeiptr vertexCapacityBytes, GLsizeiptr indexCapacityBytes);
+
+	// Fails while anything allocateAsync queued is still unpublished.
+	bool allocate(const void* vertices, unsigned int vertexCount, const void* indices, unsigned int numOfIndices, GLenum indexType, ArenaAllocation* allocation);
+	// Render thread. Reserves the ranges here, then queues the copy from buffers already filled on
+	// the GPU, and any growth that needs, on uploader. The buffers are deleted there once copied and
+	// onReady runs on the render thread when the data is in the arena. On failure the buffers are left as they are.
+	bool allocateAsync(UploadThread& uploader, GLuint vertexBuffer, unsigned int vertexCount, GLuint indexBuffer, unsigned int numOfIndices, GLenum indexType,
+		ArenaAllocation* allocation, UploadThread::ReadyFunction onReady);
+	void release(const ArenaAllocation& allocation);
+
+	void bind();
+	void attachInstanceAttribute(GLuint location, GLuint buffer);
+	static void invalidateBinding();
+
+	const VertexLayoutDesc& getLayout() { return layout; }
+	GLuint getVertexBuffer() { return VBO; }
+	GLuint getIndexBuffer() { return IBO; }
+
+	GeometryArenaStats getStats();
+	void printStats();
+
+	void clearArena();
+
+	~GeometryArena();
+
+private:
+	GLuint VAO;
+	GLuint VBO;
+	GLuint IBO;
+	// What queued copies write to. Only jobs on the upload context change these, one at a time, so
+	// they are ahead of VBO and IBO while a growth is queued.
+	GLuint copyVBO;
+	GLuint copyIBO;
+	// Copies and growths queued but not yet published; render thread only.
+	size_t pendingAsync;
+
+	VertexLayoutDesc layout;
+	ArenaAllocator vertexAllocator;
+	ArenaAllocator indexAllocator;
+	size_t allocationCount;
+
+	static GLuint boundVAO;
+
+	bool allocateRanges(unsigned int vertexCount, unsigned int numOfIndices, GLenum indexType, ArenaAllocation* allocation, bool growBuffers);
+	GLuint growBuffer(GLenum target, GLuint buffer, GLsizeiptr oldSize, GLsizeiptr newSize);
+	GLuint copyToNewBuffer(GLuint buffer, GLsizeiptr oldSize, GLsizeiptr newSize);
+	void attachBuffer(GLenum target, GLuint buffer);
+	void queueGrowth(UploadThread& uploader, GLenum target, GLsizeiptr oldSize, GLsizeiptr newSize);
+	// Without growBuffers only the allocator grows and the caller queues the buffer growth itself.
+	void growVertices(GLsizeiptr minVertices, bool growBuffers);
+	void growIndices(GLsizeiptr minBytes, bool growBuffers);
+};
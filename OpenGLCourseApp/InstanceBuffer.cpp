@@ -0,0 +1,171 @@
+#include "InstanceBuffer.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <algorithm>
+
+namespace
+{
+	// Instances between two dirty ranges are re-sent rather than paying for another call.
+	const GLuint mergeGap = 64;
+}
+
+InstanceBuffer::InstanceBuffer()
+{
+	instanceBuffer = 0;
+	capacity = 0;
+	lastUploadBytes = 0;
+}
+
+GLuint InstanceBuffer::addInstance(const InstanceData& instance)
+{
+	instances.push_back(instance);
+	GLuint index = (GLuint)instances.size() - 1;
+	markDirty(index, index + 1);
+	return index;
+}
+
+void InstanceBuffer::setInstance(GLuint index, const InstanceData& instance)
+{
+	instances[index] = instance;
+	markDirty(index, index + 1);
+}
+
+void InstanceBuffer::setModel(GLuint index, const glm::mat4& model)
+{
+	instances[index].model = model;
+	markDirty(index, index + 1);
+}
+
+void InstanceBuffer::removeInstance(GLuint index)
+{
+	if (index >= instances.size())
+	{
+		printf("ERROR::InstanceBuffer::removeInstance index %u out of range (%zu instances)\n", index, instances.size());
+		return;
+	}
+
+	GLuint last = (GLuint)instances.size() - 1;
+	if (index != last)
+	{
+		instances[index] = instances[last];
+		markDirty(index, index + 1);
+	}
+	instances.pop_back();
+}
+
+void InstanceBuffer::markDirty(GLuint begin, GLuint end)
+{
+	if (!dirtyRanges.empty() && begin <= dirtyRanges.back().end + mergeGap && end + mergeGap >= dirtyRanges.back().begin)
+	{
+		dirtyRanges.back().begin = std::min(dirtyRanges.back().begin, begin);
+		dirtyRanges.back().end = std::max(dirtyRanges.back().end, end);
+		return;
+	}
+	dirtyRanges.push_back({ begin, end });
+}
+
+void InstanceBuffer::upload()
+{
+	lastUploadBytes = 0;
+
+	if (instanceBuffer == 0)
+	{
+		glGenBuffers(1, &instanceBuffer);
+	}
+
+	GLuint count = (GLuint)instances.size();
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	if (count > capacity)
+	{
+		capacity = std::max(count, capacity * 2);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+		dirtyRanges.assign(1, { 0, count });
+	}
+
+	if (dirtyRanges.empty())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+
+	std::sort(dirtyRanges.begin(), dirtyRanges.end(), [](const DirtyRange& a, const DirtyRange& b) { return a.begin < b.begin; });
+
+	size_t merged = 0;
+	for (size_t i = 1; i < dirtyRanges.size(); i++)
+	{
+		if (dirtyRanges[i].begin <= dirtyRanges[merged].end + mergeGap)
+		{
+			dirtyRanges[merged].end = std::max(dirtyRanges[merged].end, dirtyRanges[i].end);
+		}
+		else
+		{
+			dirtyRanges[++merged] = dirtyRanges[i];
+		}
+	}
+	dirtyRanges.resize(merged + 1);
+
+	for (const DirtyRange& range : dirtyRanges)
+	{
+		GLuint end = std::min(range.end, count);
+		if (range.begin >= end)
+		{
+			continue;
+		}
+
+		GLsizeiptr bytes = (GLsizeiptr)(end - range.begin) * sizeof(InstanceData);
+		glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)range.begin * sizeof(InstanceData), bytes, &instances[range.begin]);
+		lastUploadBytes += bytes;
+	}
+
+	dirtyRanges.clear();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::bindAttributes()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(modelLocation + column);
+		glVertexAttribPointer(modelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(modelLocation + column, 1);
+	}
+
+	glEnableVertexAttribArray(infoLocation);
+	glVertexAttribIPointer(infoLocation, 2, GL_UNSIGNED_INT, sizeof(InstanceData), (void*)offsetof(InstanceData, materialIndex));
+	glVertexAttribDivisor(infoLocation, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::unbindAttributes()
+{
+	for (GLuint location = modelLocation; location <= infoLocation; location++)
+	{
+		glDisableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 0);
+	}
+}
+
+void InstanceBuffer::clearInstanceBuffer()
+{
+	if (instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &instanceBuffer);
+		instanceBuffer = 0;
+	}
+
+	capacity = 0;
+	instances.clear();
+	dirtyRanges.clear();
+	lastUploadBytes = 0;
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+	clearInstanceBuffer();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+// Matches the per instance attributes in Shaders/instanced.vert.
+struct InstanceData
+{
+	glm::mat4 model;
+	GLuint materialIndex;
+	// A TextureManager slot.
+	GLuint textureIndex;
+};
+
+// CPU copy of per instance data plus the GL buffer it streams to. Edits mark ranges dirty and
+// upload() only sends those, coalescing ranges that are close together.
+class InstanceBuffer
+{
+public:
+	static const GLuint modelLocation = 4;
+	static const GLuint infoLocation = 8;
+
+	InstanceBuffer();
+
+	GLuint addInstance(const InstanceData& instance);
+	void setInstance(GLuint index, const InstanceData& instance);
+	void setModel(GLuint index, const glm::mat4& model);
+	// Moves the last instance into index, so indices above it are not stable.
+	void removeInstance(GLuint index);
+
+	const InstanceData& getInstance(GLuint index) { return instances[index]; }
+	GLuint getCount() { return (GLuint)instances.size(); }
+
+	void upload();
+	// Points the instance attribute locations of the bound VAO at this buffer. Instanced draws share
+	// the mesh or arena VAO, so unbindAttributes() must follow them.
+	void bindAttributes();
+	// Disables the instance attributes of the bound VAO and resets their divisors.
+	void unbindAttributes();
+
+	GLsizeiptr getLastUploadBytes() { return lastUploadBytes; }
+
+	void clearInstanceBuffer();
+
+	~InstanceBuffer();
+
+private:
+	struct DirtyRange
+	{
+		GLuint begin;
+		GLuint end;
+	};
+
+	GLuint instanceBuffer;
+	GLuint capacity;
+	std::vector<InstanceData> instances;
+	std::vector<DirtyRange> dirtyRanges;
+	GLsizeiptr lastUploadBytes;
+
+	void markDirty(GLuint begin, GLuint end);
+};
@@ -0,0 +1,332 @@
+#include "JsonValue.h"
+
+#include <stdio.h>
+#include <charconv>
+
+class JsonReader
+{
+public:
+	JsonReader(const char* text, size_t length)
+	{
+		current = text;
+		end = text + length;
+		depth = 0;
+	}
+
+	bool readDocument(JsonValue& root)
+	{
+		if (!readValue(root))
+		{
+			return false;
+		}
+		skipWhitespace();
+		return current == end;
+	}
+
+	const char* getPosition() { return current; }
+
+private:
+	const char* current;
+	const char* end;
+	int depth;
+
+	void skipWhitespace()
+	{
+		while (current < end && (*current == ' ' || *current == '\t' || *current == '\n' || *current == '\r'))
+		{
+			current++;
+		}
+	}
+
+	bool match(const char* literal)
+	{
+		const char* position = current;
+		while (*literal)
+		{
+			if (position == end || *position != *literal)
+			{
+				return false;
+			}
+			position++;
+			literal++;
+		}
+		current = position;
+		return true;
+	}
+
+	static void appendUtf8(std::string& out, unsigned int codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			out += (char)codePoint;
+		}
+		else if (codePoint < 0x800)
+		{
+			out += (char)(0xc0 | (codePoint >> 6));
+			out += (char)(0x80 | (codePoint & 0x3f));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += (char)(0xe0 | (codePoint >> 12));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+			out += (char)(0x80 | (codePoint & 0x3f));
+		}
+		else
+		{
+			out += (char)(0xf0 | (codePoint >> 18));
+			out += (char)(0x80 | ((codePoint >> 12) & 0x3f));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+			out += (char)(0x80 | (codePoint & 0x3f));
+		}
+	}
+
+	bool readHex4(unsigned int& value)
+	{
+		if (end - current < 4)
+		{
+			return false;
+		}
+		auto result = std::from_chars(current, current + 4, value, 16);
+		if (result.ptr != current + 4)
+		{
+			return false;
+		}
+		current += 4;
+		return true;
+	}
+
+	bool readString(std::string& out)
+	{
+		if (current == end || *current != '"')
+		{
+			return false;
+		}
+		current++;
+
+		out.clear();
+		while (current < end && *current != '"')
+		{
+			char c = *current++;
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+
+			if (current == end)
+			{
+				return false;
+			}
+
+			char escape = *current++;
+			switch (escape)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				unsigned int codePoint = 0;
+				if (!readHex4(codePoint))
+				{
+					return false;
+				}
+				if (codePoint >= 0xd800 && codePoint < 0xdc00 && match("\\u"))
+				{
+					unsigned int low = 0;
+					if (!readHex4(low))
+					{
+						return false;
+					}
+					codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+				}
+				appendUtf8(out, codePoint);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+
+		if (current == end)
+		{
+			return false;
+		}
+		current++;
+		return true;
+	}
+
+	bool readValue(JsonValue& value)
+	{
+		skipWhitespace();
+		if (current == end || depth > 256)
+		{
+			return false;
+		}
+
+		switch (*current)
+		{
+		case '{':
+		{
+			current++;
+			depth++;
+			value.type = JsonValue::Type::Object;
+			skipWhitespace();
+			if (current < end && *current == '}')
+			{
+				current++;
+				depth--;
+				return true;
+			}
+
+			while (true)
+			{
+				skipWhitespace();
+				value.members.emplace_back();
+				if (!readString(value.members.back().first))
+				{
+					return false;
+				}
+				skipWhitespace();
+				if (current == end || *current++ != ':')
+				{
+					return false;
+				}
+				if (!readValue(value.members.back().second))
+				{
+					return false;
+				}
+				skipWhitespace();
+				if (current == end)
+				{
+					return false;
+				}
+				if (*current == ',')
+				{
+					current++;
+					continue;
+				}
+				if (*current++ != '}')
+				{
+					return false;
+				}
+				depth--;
+				return true;
+			}
+		}
+		case '[':
+		{
+			current++;
+			depth++;
+			value.type = JsonValue::Type::Array;
+			skipWhitespace();
+			if (current < end && *current == ']')
+			{
+				current++;
+				depth--;
+				return true;
+			}
+
+			while (true)
+			{
+				value.items.emplace_back();
+				if (!readValue(value.items.back()))
+				{
+					return false;
+				}
+				skipWhitespace();
+				if (current == end)
+				{
+					return false;
+				}
+				if (*current == ',')
+				{
+					current++;
+					continue;
+				}
+				if (*current++ != ']')
+				{
+					return false;
+				}
+				depth--;
+				return true;
+			}
+		}
+		case '"':
+			value.type = JsonValue::Type::String;
+			return readString(value.string);
+		case 't':
+			value.type = JsonValue::Type::Bool;
+			value.boolean = true;
+			return match("true");
+		case 'f':
+			value.type = JsonValue::Type::Bool;
+			value.boolean = false;
+			return match("false");
+		case 'n':
+			value.type = JsonValue::Type::Null;
+			return match("null");
+		default:
+		{
+			value.type = JsonValue::Type::Number;
+			auto result = std::from_chars(current, end, value.number);
+			if (result.ec != std::errc())
+			{
+				return false;
+			}
+			current = result.ptr;
+			return true;
+		}
+		}
+	}
+};
+
+JsonValue::JsonValue()
+{
+	type = Type::Null;
+	boolean = false;
+	number = 0.0;
+}
+
+bool JsonValue::parse(const char* text, size_t length, JsonValue& root)
+{
+	root = JsonValue();
+
+	JsonReader reader(text, length);
+	if (!reader.readDocument(root))
+	{
+		printf("ERROR::JsonValue::parse syntax error at byte %lld\n", (long long)(reader.getPosition() - text));
+		root = JsonValue();
+		return false;
+	}
+	return true;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	static const JsonValue null;
+	return type == Type::Array && index < items.size() ? items[index] : null;
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+	static const JsonValue null;
+	if (type != Type::Object)
+	{
+		return null;
+	}
+
+	for (const auto& member : members)
+	{
+		if (member.first == key)
+		{
+			return member.second;
+		}
+	}
+	return null;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Just enough JSON for glTF: a small DOM, numbers as doubles, lookups return a shared null on a miss.
+class JsonValue
+{
+public:
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	JsonValue();
+
+	static bool parse(const char* text, size_t length, JsonValue& root);
+
+	Type getType() const { return type; }
+	bool isNull() const { return type == Type::Null; }
+	bool isArray() const { return type == Type::Array; }
+	bool isObject() const { return type == Type::Object; }
+
+	bool getBool(bool fallback = false) const { return type == Type::Bool ? boolean : fallback; }
+	double getNumber(double fallback = 0.0) const { return type == Type::Number ? number : fallback; }
+	int getInt(int fallback = -1) const { return type == Type::Number ? (int)number : fallback; }
+	const std::string& getString() const { return string; }
+
+	size_t size() const { return type == Type::Array ? items.size() : members.size(); }
+	bool has(const char* key) const { return !(*this)[key].isNull(); }
+
+	const JsonValue& operator[](size_t index) const;
+	const JsonValue& operator[](const char* key) const;
+
+private:
+	Type type;
+	bool boolean;
+	double number;
+	std::string string;
+	std::vector<JsonValue> items;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	friend class JsonReader;
+};
@@ -0,0 +1,417 @@
+#include "Ktx2File.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <numeric>
+
+#include "MappedFile.h"
+
+namespace
+{
+	const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	struct Ktx2Header
+	{
+		unsigned char identifier[12];
+		GLuint vkFormat;
+		GLuint typeSize;
+		GLuint pixelWidth;
+		GLuint pixelHeight;
+		GLuint pixelDepth;
+		GLuint layerCount;
+		GLuint faceCount;
+		GLuint levelCount;
+		GLuint supercompressionScheme;
+		GLuint dfdByteOffset;
+		GLuint dfdByteLength;
+		GLuint kvdByteOffset;
+		GLuint kvdByteLength;
+		GLuint64 sgdByteOffset;
+		GLuint64 sgdByteLength;
+	};
+
+	struct Ktx2LevelIndex
+	{
+		GLuint64 byteOffset;
+		GLuint64 byteLength;
+		GLuint64 uncompressedByteLength;
+	};
+
+	// Data format descriptor sample: which channel lives at which bits of a block.
+	struct DfdSample
+	{
+		GLuint channelType;
+		GLuint bitOffset;
+		GLuint bitLength;
+	};
+
+	struct FormatInfo
+	{
+		GLuint vkFormat;
+		GLuint colourModel;
+		GLuint blockBytes;
+		GLuint blockDimension;
+		GLuint sampleCount;
+		DfdSample samples[4];
+	};
+
+	// Colour models and channel ids from the Khronos Data Format specification.
+	const FormatInfo formats[] =
+	{
+		{ Ktx2File::vkFormatBC1, 128, 8, 4, 1, { { 0, 0, 64 } } },
+		{ Ktx2File::vkFormatBC3, 130, 16, 4, 2, { { 15, 0, 64 }, { 0, 64, 64 } } },
+		{ Ktx2File::vkFormatBC4, 131, 8, 4, 1, { { 0, 0, 64 } } },
+		{ Ktx2File::vkFormatBC5, 132, 16, 4, 2, { { 0, 0, 64 }, { 1, 64, 64 } } },
+		{ Ktx2File::vkFormatBC7, 134, 16, 4, 1, { { 0, 0, 128 } } },
+		{ Ktx2File::vkFormatR8, 1, 1, 1, 1, { { 0, 0, 8 } } },
+		{ Ktx2File::vkFormatRG8, 1, 2, 1, 2, { { 0, 0, 8 }, { 1, 8, 8 } } },
+		{ Ktx2File::vkFormatRGB8, 1, 3, 1, 3, { { 0, 0, 8 }, { 1, 8, 8 }, { 2, 16, 8 } } },
+		{ Ktx2File::vkFormatRGBA8, 1, 4, 1, 4, { { 0, 0, 8 }, { 1, 8, 8 }, { 2, 16, 8 }, { 15, 24, 8 } } },
+	};
+
+	const FormatInfo* findFormat(GLuint vkFormat)
+	{
+		for (const FormatInfo& format : formats)
+		{
+			if (format.vkFormat == vkFormat)
+			{
+				return &format;
+			}
+		}
+		return nullptr;
+	}
+
+	void buildDfd(const FormatInfo& format, std::vector<GLuint>& dfd)
+	{
+		GLuint blockSize = 24 + 16 * format.sampleCount;
+		dfd.clear();
+		dfd.push_back(4 + blockSize);
+		// vendorId 0 (Khronos), descriptorType 0 (basic), versionNumber 2.
+		dfd.push_back(0);
+		dfd.push_back(2 | (blockSize << 16));
+		// Linear transfer, BT.709 primaries.
+		dfd.push_back(format.colourModel | (1 << 8) | (1 << 16));
+		// Texel block dimensions minus one.
+		dfd.push_back((format.blockDimension - 1) | ((format.blockDimension - 1) << 8));
+		dfd.push_back(format.blockBytes);
+		dfd.push_back(0);
+
+		for (GLuint i = 0; i < format.sampleCount; i++)
+		{
+			const DfdSample& sample = format.samples[i];
+			dfd.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channelType << 24));
+			dfd.push_back(0);
+			dfd.push_back(0);
+			dfd.push_back(0xFFFFFFFF);
+		}
+	}
+
+	GLuint64 alignUp(GLuint64 value, GLuint64 alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Each entry is its length, then key, NUL, value and NUL, padded to 4 bytes. std::map keeps the
+	// keys sorted as the specification asks.
+	void buildKvd(const std::map<std::string, std::string>& keyValues, std::vector<unsigned char>& kvd)
+	{
+		kvd.clear();
+		for (const auto& keyValue : keyValues)
+		{
+			GLuint length = (GLuint)(keyValue.first.size() + keyValue.second.size() + 2);
+			kvd.insert(kvd.end(), (const unsigned char*)&length, (const unsigned char*)&length + sizeof(length));
+			kvd.insert(kvd.end(), keyValue.first.begin(), keyValue.first.end());
+			kvd.push_back(0);
+			kvd.insert(kvd.end(), keyValue.second.begin(), keyValue.second.end());
+			kvd.push_back(0);
+			kvd.resize(alignUp(kvd.size(), 4), 0);
+		}
+	}
+
+	// Checks the header and level index of the file in data, filling everything in image but the
+	// texels and returning where each level lives.
+	bool parse(const char* caller, const char* fileLocation, const unsigned char* data, size_t size, Ktx2Image& image,
+		std::vector<Ktx2LevelIndex>& levelIndex)
+	{
+		if (size < sizeof(Ktx2Header) || memcmp(data, identifier, sizeof(identifier)) != 0)
+		{
+			printf("ERROR::Ktx2File::%s %s is not a KTX2 file\n", caller, fileLocation);
+			return false;
+		}
+
+		Ktx2Header header;
+		memcpy(&header, data, sizeof(header));
+
+		const FormatInfo* format = findFormat(header.vkFormat);
+		if (!format || header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 ||
+			header.levelCount == 0 || header.pixelWidth == 0 || header.pixelHeight == 0)
+		{
+			printf("ERROR::Ktx2File::%s %s uses a layout this reader does not support\n", caller, fileLocation);
+			return false;
+		}
+
+		if (sizeof(Ktx2Header) + (GLuint64)header.levelCount * sizeof(Ktx2LevelIndex) > size)
+		{
+			printf("ERROR::Ktx2File::%s %s is truncated\n", caller, fileLocation);
+			return false;
+		}
+
+		if ((GLuint64)header.kvdByteOffset + header.kvdByteLength > size)
+		{
+			printf("ERROR::Ktx2File::%s %s is truncated\n", caller, fileLocation);
+			return false;
+		}
+
+		image.vkFormat = header.vkFormat;
+		image.width = header.pixelWidth;
+		image.height = header.pixelHeight;
+		levelIndex.resize(header.levelCount);
+
+		// Entries that don't hold a NUL terminated key are skipped rather than failing the file.
+		image.keyValues.clear();
+		const unsigned char* kvd = data + header.kvdByteOffset;
+		for (GLuint64 offset = 0; offset + sizeof(GLuint) <= header.kvdByteLength;)
+		{
+			GLuint length = 0;
+			memcpy(&length, kvd + offset, sizeof(length));
+			offset += sizeof(length);
+			if (length > header.kvdByteLength - offset)
+			{
+				break;
+			}
+
+			const char* entry = (const char*)kvd + offset;
+			const char* keyEnd = (const char*)memchr(entry, 0, length);
+			if (keyEnd)
+			{
+				size_t valueLength = length - (keyEnd + 1 - entry);
+				if (valueLength > 0 && keyEnd[valueLength] == 0)
+				{
+					valueLength--;
+				}
+				image.keyValues[std::string(entry, keyEnd)] = std::string(keyEnd + 1, valueLength);
+			}
+			offset = alignUp(offset + length, 4);
+		}
+
+		for (GLuint i = 0; i < header.levelCount; i++)
+		{
+			Ktx2LevelIndex& level = levelIndex[i];
+			memcpy(&level, data + sizeof(Ktx2Header) + i * sizeof(Ktx2LevelIndex), sizeof(level));
+
+			GLuint levelWidth = header.pixelWidth >> i ? header.pixelWidth >> i : 1;
+			GLuint levelHeight = header.pixelHeight >> i ? header.pixelHeight >> i : 1;
+			GLuint64 expected = Ktx2File::getLevelSize(header.vkFormat, levelWidth, levelHeight);
+
+			if (level.byteLength != expected || level.byteOffset > size || level.byteLength > size - level.byteOffset)
+			{
+				printf("ERROR::Ktx2File::%s level %u of %s is out of range\n", caller, i, fileLocation);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+GLuint Ktx2Image::getLevelCount() const
+{
+	return (GLuint)(mapping ? mappedLevels.size() : levels.size());
+}
+
+const unsigned char* Ktx2Image::getLevelData(GLuint level) const
+{
+	return mapping ? mappedLevels[level] : levels[level].data();
+}
+
+size_t Ktx2Image::getLevelBytes(GLuint level) const
+{
+	return mapping ? mappedLevelBytes[level] : levels[level].size();
+}
+
+size_t Ktx2Image::getByteSize() const
+{
+	size_t size = 0;
+	for (GLuint level = 0; level < getLevelCount(); level++)
+	{
+		size += getLevelBytes(level);
+	}
+	return size;
+}
+
+GLuint Ktx2File::getBlockBytes(GLuint vkFormat)
+{
+	const FormatInfo* format = findFormat(vkFormat);
+	return format ? format->blockBytes : 0;
+}
+
+GLuint Ktx2File::getBlockDimension(GLuint vkFormat)
+{
+	const FormatInfo* format = findFormat(vkFormat);
+	return format ? format->blockDimension : 0;
+}
+
+GLuint Ktx2File::getChannelCount(GLuint vkFormat)
+{
+	const FormatInfo* format = findFormat(vkFormat);
+	return format && format->blockDimension == 1 ? format->sampleCount : 0;
+}
+
+GLuint Ktx2File::getSourceChannelCount(GLuint vkFormat)
+{
+	switch (vkFormat)
+	{
+	case vkFormatBC4:
+		return 1;
+	case vkFormatBC5:
+		return 2;
+	}
+	GLuint channels = getChannelCount(vkFormat);
+	return channels > 0 ? channels : 4;
+}
+
+GLuint Ktx2File::getRawFormat(int channels)
+{
+	switch (channels)
+	{
+	case 1:
+		return vkFormatR8;
+	case 2:
+		return vkFormatRG8;
+	case 3:
+		return vkFormatRGB8;
+	}
+	return vkFormatRGBA8;
+}
+
+size_t Ktx2File::getLevelSize(GLuint vkFormat, GLuint width, GLuint height)
+{
+	const FormatInfo* format = findFormat(vkFormat);
+	if (!format)
+	{
+		return 0;
+	}
+
+	GLuint dimension = format->blockDimension;
+	return (size_t)((width + dimension - 1) / dimension) * ((height + dimension - 1) / dimension) * format->blockBytes;
+}
+
+bool Ktx2File::write(const char* fileLocation, const Ktx2Image& image)
+{
+	const FormatInfo* format = findFormat(image.vkFormat);
+	if (!format || image.getLevelCount() == 0)
+	{
+		printf("ERROR::Ktx2File::write unsupported format %u for %s\n", image.vkFormat, fileLocation);
+		return false;
+	}
+
+	std::vector<GLuint> dfd;
+	buildDfd(*format, dfd);
+	std::vector<unsigned char> kvd;
+	buildKvd(image.keyValues, kvd);
+
+	GLuint levelCount = image.getLevelCount();
+	Ktx2Header header = {};
+	memcpy(header.identifier, identifier, sizeof(identifier));
+	header.vkFormat = image.vkFormat;
+	header.typeSize = 1;
+	header.pixelWidth = image.width;
+	header.pixelHeight = image.height;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = (GLuint)(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex));
+	header.dfdByteLength = (GLuint)(dfd.size() * sizeof(GLuint));
+	header.kvdByteOffset = kvd.empty() ? 0 : header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = (GLuint)kvd.size();
+
+	// Levels are aligned to lcm(block size, 4) as the specification asks, and stored smallest first
+	// so a reader streaming the file gets usable mips early.
+	std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+	GLuint64 offset = header.dfdByteOffset + header.dfdByteLength + header.kvdByteLength;
+	for (GLuint i = levelCount; i-- > 0;)
+	{
+		offset = alignUp(offset, std::lcm(format->blockBytes, 4u));
+		levelIndex[i].byteOffset = offset;
+		levelIndex[i].byteLength = image.getLevelBytes(i);
+		levelIndex[i].uncompressedByteLength = image.getLevelBytes(i);
+		offset += image.getLevelBytes(i);
+	}
+
+	std::ofstream out(fileLocation, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		printf("ERROR::Ktx2File::write failed to create %s\n", fileLocation);
+		return false;
+	}
+
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)levelIndex.data(), levelCount * sizeof(Ktx2LevelIndex));
+	out.write((const char*)dfd.data(), header.dfdByteLength);
+	out.write((const char*)kvd.data(), header.kvdByteLength);
+
+	GLuint64 written = header.dfdByteOffset + header.dfdByteLength + header.kvdByteLength;
+	for (GLuint i = levelCount; i-- > 0;)
+	{
+		static const char zeros[16] = {};
+		out.write(zeros, (std::streamsize)(levelIndex[i].byteOffset - written));
+		out.write((const char*)image.getLevelData(i), (std::streamsize)image.getLevelBytes(i));
+		written = levelIndex[i].byteOffset + levelIndex[i].byteLength;
+	}
+
+	return (bool)out;
+}
+
+bool Ktx2File::read(const char* fileLocation, Ktx2Image& image)
+{
+	MappedFile file;
+	if (!file.open(fileLocation))
+	{
+		return false;
+	}
+
+	std::vector<Ktx2LevelIndex> levelIndex;
+	if (!parse("read", fileLocation, file.getData(), file.getSize(), image, levelIndex))
+	{
+		return false;
+	}
+
+	const unsigned char* data = file.getData();
+	image.mapping.reset();
+	image.mappedLevels.clear();
+	image.mappedLevelBytes.clear();
+	image.levels.assign(levelIndex.size(), {});
+	for (size_t i = 0; i < levelIndex.size(); i++)
+	{
+		image.levels[i].assign(data + levelIndex[i].byteOffset, data + levelIndex[i].byteOffset + levelIndex[i].byteLength);
+	}
+
+	return true;
+}
+
+bool Ktx2File::map(const char* fileLocation, Ktx2Image& image)
+{
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->open(fileLocation))
+	{
+		return false;
+	}
+
+	std::vector<Ktx2LevelIndex> levelIndex;
+	if (!parse("map", fileLocation, file->getData(), file->getSize(), image, levelIndex))
+	{
+		return false;
+	}
+	file->prefetch();
+
+	image.levels.clear();
+	image.mappedLevels.resize(levelIndex.size());
+	image.mappedLevelBytes.resize(levelIndex.size());
+	for (size_t i = 0; i < levelIndex.size(); i++)
+	{
+		image.mappedLevels[i] = file->getData() + levelIndex[i].byteOffset;
+		image.mappedLevelBytes[i] = (size_t)levelIndex[i].byteLength;
+	}
+	image.mapping = file;
+
+	return true;
+}
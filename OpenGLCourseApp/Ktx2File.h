@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GL\glew.h>
+
+class MappedFile;
+
+// A single 2D texture, no array layers or faces, with level 0 first. vkFormat is the Vulkan format
+// enum KTX2 uses to name the texel format.
+struct Ktx2Image
+{
+	GLuint vkFormat;
+	GLuint width;
+	GLuint height;
+	std::vector<std::vector<unsigned char>> levels;
+	// Filled by Ktx2File::map in place of levels: each level points into the file, which stays
+	// mapped while any copy of the image holds it.
+	std::shared_ptr<MappedFile> mapping;
+	std::vector<const unsigned char*> mappedLevels;
+	std::vector<size_t> mappedLevelBytes;
+	// The file's key/value data. Values are strings, stored with their terminating NUL.
+	std::map<std::string, std::string> keyValues;
+
+	// These read either kind of image.
+	GLuint getLevelCount() const;
+	const unsigned char* getLevelData(GLuint level) const;
+	size_t getLevelBytes(GLuint level) const;
+	size_t getByteSize() const;
+};
+
+// Reads and writes the subset of KTX 2.0 this project produces: 2D, one layer, no supercompression,
+// BCn or 8 bit per channel unorm texels.
+namespace Ktx2File
+{
+	const GLuint vkFormatBC1 = 131;
+	const GLuint vkFormatBC3 = 137;
+	const GLuint vkFormatBC4 = 139;
+	const GLuint vkFormatBC5 = 141;
+	const GLuint vkFormatBC7 = 145;
+	// Uncompressed 8 bit formats, one texel per block.
+	const GLuint vkFormatR8 = 9;
+	const GLuint vkFormatRG8 = 16;
+	const GLuint vkFormatRGB8 = 23;
+	const GLuint vkFormatRGBA8 = 37;
+
+	// Bytes per block, or 0 for a format this file does not know.
+	GLuint getBlockBytes(GLuint vkFormat);
+	// 4 for the BCn formats, 1 for uncompressed ones.
+	GLuint getBlockDimension(GLuint vkFormat);
+	// Channels of an uncompressed format, 0 for block compressed ones.
+	GLuint getChannelCount(GLuint vkFormat);
+	// Channels of the image a format was made from, which is what sampling should present: BC4 and
+	// BC5 hold one and two channel images.
+	GLuint getSourceChannelCount(GLuint vkFormat);
+	GLuint getRawFormat(int channels);
+	size_t getLevelSize(GLuint vkFormat, GLuint width, GLuint height);
+
+	bool write(const char* fileLocation, const Ktx2Image& image);
+	bool read(const char* fileLocation, Ktx2Image& image);
+	// Like read(), but leaves the texels in the mapped file instead of copying them out, and asks
+	// the OS to start reading it in the background.
+	bool map(const char* fileLocation, Ktx2Image& image);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+
+// Bounded multi producer, multi consumer queue (Vyukov's sequence per cell design). Each cell's
+// sequence says whether it is free for the producer at that position or holds data for the
+// consumer at that position, so producers and consumers only contend on their own counter.
+template<typename T>
+class LockFreeQueue
+{
+public:
+	// capacity is rounded up to a power of two.
+	explicit LockFreeQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+		{
+			size *= 2;
+		}
+
+		cells.reset(new Cell[size]);
+		mask = size - 1;
+		for (size_t i = 0; i < size; i++)
+		{
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		enqueuePosition.store(0, std::memory_order_relaxed);
+		dequeuePosition.store(0, std::memory_order_relaxed);
+	}
+
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+	bool tryPush(T&& value)
+	{
+		Cell* cell;
+		size_t position = enqueuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &cells[position & mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+
+			if (difference == 0)
+			{
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->value = std::move(value);
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool tryPop(T& value)
+	{
+		Cell* cell;
+		size_t position = dequeuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &cells[position & mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)(position + 1);
+
+			if (difference == 0)
+			{
+				if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = dequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		value = std::move(cell->value);
+		cell->sequence.store(position + mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	size_t mask;
+	alignas(64) std::atomic<size_t> enqueuePosition;
+	alignas(64) std::atomic<size_t> dequeuePosition;
+};
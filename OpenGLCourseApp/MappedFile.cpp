@@ -0,0 +1,147 @@
+#include "MappedFile.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = nullptr;
+#else
+	fileDescriptor = -1;
+#endif
+}
+
+bool MappedFile::open(const char* fileLocation)
+{
+	close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(fileLocation, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mappingHandle)
+	{
+		printf("ERROR::MappedFile::open CreateFileMapping failed for %s (%lu)\n", fileLocation, GetLastError());
+		close();
+		return false;
+	}
+
+	data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		printf("ERROR::MappedFile::open MapViewOfFile failed for %s (%lu)\n", fileLocation, GetLastError());
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+#else
+	fileDescriptor = ::open(fileLocation, O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close();
+		return false;
+	}
+
+	void* mapped = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapped == MAP_FAILED)
+	{
+		printf("ERROR::MappedFile::open mmap failed for %s\n", fileLocation);
+		close();
+		return false;
+	}
+	madvise(mapped, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+
+	data = (const unsigned char*)mapped;
+	size = (size_t)fileStat.st_size;
+#endif
+
+	return true;
+}
+
+void MappedFile::prefetch()
+{
+	if (!data)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range = { (void*)data, size };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+	madvise((void*)data, size, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(fileHandle);
+		fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (data)
+	{
+		munmap((void*)data, size);
+	}
+	if (fileDescriptor >= 0)
+	{
+		::close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+#endif
+
+	data = nullptr;
+	size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+
+// Read only view of a whole file. The pages are mapped, not copied, so opening a large file is
+// cheap and only the parts that get touched are read from disk.
+class MappedFile
+{
+public:
+	MappedFile();
+
+	bool open(const char* fileLocation);
+	void close();
+
+	// Starts reading the whole file in the background, so pages are in memory by the time they are
+	// touched instead of each faulting in on its own.
+	void prefetch();
+
+	bool isOpen() { return data != nullptr; }
+	const unsigned char* getData() { return data; }
+	size_t getSize() { return size; }
+
+	~MappedFile();
+
+private:
+	const unsigned char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+};
@@ -10,6 +10,9 @@ public:
 
 	void useMaterial(GLuint specularIntensityLocation, GLuint shininessLocation);
 
+	GLfloat getSpecularIntensity() { return specularIntensity; }
+	GLfloat getShininess() { return shininess; }
+
 	~Material();
 
 private:
@@ -1,50 +1,785 @@
 #include "Mesh.h"
 
-Mesh::Mesh(GLfloat* vertices, unsigned int* indices, unsigned int numOfVertices, unsigned int numOfIndices)
+#include <cfloat>
+#include <string.h>
+#include <algorithm>
+
+GLsizeiptr Mesh::indexBytesUploaded = 0;
+GLsizeiptr Mesh::indexBytesSaved = 0;
+
+Mesh::Mesh(GLfloat* vertices, unsigned int* indices, unsigned int numOfVertices, unsigned int numOfIndices, bool optimise)
+{
+	arena = nullptr;
+	layout = StandardVertexLayout::desc;
+	positionScale = glm::vec3(1.f, 1.f, 1.f);
+	positionOffset = glm::vec3(0.f, 0.f, 0.f);
+
+	const void* vertexData = vertices;
+	unsigned int vertexCount = numOfVertices * sizeof(vertices[0]) / layout.stride;
+	std::vector<unsigned char> vertexCopy;
+	std::vector<unsigned int> indexCopy;
+
+	optimised = false;
+	currentLod = 0;
+	if (optimise)
+	{
+		optimiseGeometry(vertexData, vertexCount, indices, numOfIndices, vertexCopy, indexCopy);
+	}
+
+	createMesh(vertexData, vertexCount, indices, numOfIndices);
+}
+
+Mesh::Mesh(const void* vertices, unsigned int vertexCount, const VertexLayoutDesc& vertexLayout, unsigned int* indices, unsigned int numOfIndices, bool optimise)
+{
+	arena = nullptr;
+	layout = vertexLayout;
+	positionScale = glm::vec3(1.f, 1.f, 1.f);
+	positionOffset = glm::vec3(0.f, 0.f, 0.f);
+
+	std::vector<unsigned char> vertexCopy;
+	std::vector<unsigned int> indexCopy;
+
+	optimised = false;
+	currentLod = 0;
+	if (optimise)
+	{
+		optimiseGeometry(vertices, vertexCount, indices, numOfIndices, vertexCopy, indexCopy);
+	}
+
+	createMesh(vertices, vertexCount, indices, numOfIndices);
+}
+
+Mesh::Mesh(GeometryArena* geometryArena, const void* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int numOfIndices, bool optimise)
 {
 	VAO = 0;
 	VBO = 0;
 	IBO = 0;
+	indexCount = 0;
+	indexType = GL_UNSIGNED_INT;
 
+	layout = geometryArena->getLayout();
+	positionScale = glm::vec3(1.f, 1.f, 1.f);
+	positionOffset = glm::vec3(0.f, 0.f, 0.f);
+
+	std::vector<unsigned char> vertexCopy;
+	std::vector<unsigned int> indexCopy;
+
+	optimised = false;
+	currentLod = 0;
+	if (optimise)
+	{
+		optimiseGeometry(vertices, vertexCount, indices, numOfIndices, vertexCopy, indexCopy);
+	}
+
+	computeBounds(layout, vertices, vertexCount, boundsMin, boundsMax);
+
+	std::vector<GLushort> shortIndices;
+	const void* indexData = prepareIndices(indices, numOfIndices, vertexCount, shortIndices);
+
+	uploadToArena(geometryArena, vertices, vertexCount, indexData, numOfIndices);
+}
+
+Mesh::Mesh(const void* vertices, unsigned int vertexCount, const VertexLayoutDesc& vertexLayout, const void* indices, unsigned int numOfIndices,
+	GLenum indexType, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+	arena = nullptr;
+	layout = vertexLayout;
+	positionScale = glm::vec3(1.f, 1.f, 1.f);
+	positionOffset = glm::vec3(0.f, 0.f, 0.f);
+	optimised = false;
+	currentLod = 0;
+
+	this->indexType = indexType;
+	this->boundsMin = boundsMin;
+	this->boundsMax = boundsMax;
+
+	uploadMesh(vertices, vertexCount, indices, numOfIndices);
+}
+
+Mesh::Mesh(GeometryArena* geometryArena, const void* vertices, unsigned int vertexCount, const void* indices, unsigned int numOfIndices,
+	GLenum indexType, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+	VAO = 0;
+	VBO = 0;
+	IBO = 0;
+	indexCount = 0;
+
+	layout = geometryArena->getLayout();
+	positionScale = glm::vec3(1.f, 1.f, 1.f);
+	positionOffset = glm::vec3(0.f, 0.f, 0.f);
+	optimised = false;
+	currentLod = 0;
+
+	this->indexType = indexType;
+	this->boundsMin = boundsMin;
+	this->boundsMax = boundsMax;
+
+	uploadToArena(geometryArena, vertices, vertexCount, indices, numOfIndices);
+}
+
+Mesh::Mesh(GLuint vertexBuffer, GLuint indexBuffer, unsigned int vertexCount, const VertexLayoutDesc& vertexLayout, unsigned int numOfIndices,
+	GLenum indexType, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+	arena = nullptr;
+	layout = vertexLayout;
+	positionScale = glm::vec3(1.f, 1.f, 1.f);
+	positionOffset = glm::vec3(0.f, 0.f, 0.f);
+	optimised = false;
+	currentLod = 0;
+
+	this->indexType = indexType;
+	this->boundsMin = boundsMin;
+	this->boundsMax = boundsMax;
+	this->vertexCount = vertexCount;
 	indexCount = numOfIndices;
+	updateBytesUploaded = 0;
+	updateUploadCalls = 0;
+	indexBytesUploaded += numOfIndices * getIndexSize(indexType);
+	indexBytesSaved += numOfIndices * (sizeof(GLuint) - getIndexSize(indexType));
 
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
+	VAO = 0;
+	VBO = vertexBuffer;
+	IBO = indexBuffer;
+	createVertexArray();
+}
+
+Mesh::Mesh(GeometryArena* geometryArena, const ArenaAllocation& arenaAllocation, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+	arena = geometryArena;
+	allocation = arenaAllocation;
+	layout = geometryArena->getLayout();
+	positionScale = glm::vec3(1.f, 1.f, 1.f);
+	positionOffset = glm::vec3(0.f, 0.f, 0.f);
+	optimised = false;
+	currentLod = 0;
+
+	indexType = arenaAllocation.indexType;
+	this->boundsMin = boundsMin;
+	this->boundsMax = boundsMax;
+	vertexCount = arenaAllocation.vertexCount;
+	indexCount = arenaAllocation.indexCount;
+	updateBytesUploaded = 0;
+	updateUploadCalls = 0;
+	indexBytesUploaded += indexCount * getIndexSize(indexType);
+	indexBytesSaved += indexCount * (sizeof(GLuint) - getIndexSize(indexType));
+
+	VAO = 0;
+	VBO = 0;
+	IBO = 0;
+}
+
+void Mesh::createAsync(UploadThread& uploader, GeometryArena* geometryArena, std::vector<unsigned char> vertices, unsigned int vertexCount, const VertexLayoutDesc& vertexLayout,
+	std::vector<unsigned int> indices, MeshReadyFunction onReady)
+{
+	struct Upload
+	{
+		std::vector<unsigned char> vertices;
+		std::vector<unsigned int> indices;
+		unsigned int vertexCount;
+		VertexLayoutDesc layout;
+		GLuint vertexBuffer;
+		GLuint indexBuffer;
+		GLenum indexType;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		ArenaAllocation allocation;
+	};
+
+	std::shared_ptr<Upload> upload = std::make_shared<Upload>();
+	upload->vertices = std::move(vertices);
+	upload->indices = std::move(indices);
+	upload->vertexCount = vertexCount;
+	upload->layout = vertexLayout;
+
+	uploader.submit([upload]() -> size_t
+	{
+		computeBounds(upload->layout, upload->vertices.data(), upload->vertexCount, upload->boundsMin, upload->boundsMax);
+
+		unsigned int numOfIndices = (unsigned int)upload->indices.size();
+		std::vector<GLushort> shortIndices;
+		const void* indexData = upload->indices.data();
+		upload->indexType = GL_UNSIGNED_INT;
+		if (upload->vertexCount <= 65536)
+		{
+			shortIndices.assign(upload->indices.begin(), upload->indices.end());
+			indexData = shortIndices.data();
+			upload->indexType = GL_UNSIGNED_SHORT;
+		}
+
+		GLsizeiptr vertexBytes = (GLsizeiptr)upload->layout.stride * upload->vertexCount;
+		GLsizeiptr indexBytes = getIndexSize(upload->indexType) * numOfIndices;
+
+		glGenBuffers(1, &upload->vertexBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, upload->vertexBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, vertexBytes, upload->vertices.data(), GL_STATIC_DRAW);
+
+		glGenBuffers(1, &upload->indexBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, upload->indexBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, indexBytes, indexData, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		// Nothing reads the CPU copies once they are in the buffers.
+		upload->vertices = std::vector<unsigned char>();
+		return (size_t)(vertexBytes + indexBytes);
+	},
+	[upload, geometryArena, onReady, &uploader]()
+	{
+		if (geometryArena && geometryArena->getLayout() == upload->layout)
+		{
+			UploadThread::ReadyFunction onCopied = [upload, geometryArena, onReady]()
+			{
+				onReady(std::unique_ptr<Mesh>(new Mesh(geometryArena, upload->allocation, upload->boundsMin, upload->boundsMax)));
+			};
+
+			if (geometryArena->allocateAsync(uploader, upload->vertexBuffer, upload->vertexCount, upload->indexBuffer, (unsigned int)upload->indices.size(),
+				upload->indexType, &upload->allocation, onCopied))
+			{
+				return;
+			}
+		}
+
+		onReady(std::unique_ptr<Mesh>(new Mesh(upload->vertexBuffer, upload->indexBuffer, upload->vertexCount, upload->layout,
+			(unsigned int)upload->indices.size(), upload->indexType, upload->boundsMin, upload->boundsMax)));
+	});
+}
+
+void Mesh::uploadToArena(GeometryArena* geometryArena, const void* vertices, unsigned int vertexCount, const void* indexData, unsigned int numOfIndices)
+{
+	arena = nullptr;
+	this->vertexCount = 0;
+	updateBytesUploaded = 0;
+	updateUploadCalls = 0;
+
+	if (geometryArena->allocate(vertices, vertexCount, indexData, numOfIndices, indexType, &allocation))
+	{
+		arena = geometryArena;
+		this->vertexCount = vertexCount;
+		indexCount = numOfIndices;
+		indexBytesUploaded += numOfIndices * getIndexSize(indexType);
+		indexBytesSaved += numOfIndices * (sizeof(GLuint) - getIndexSize(indexType));
+		return;
+	}
+
+	uploadMesh(vertices, vertexCount, indexData, numOfIndices);
+}
+
+void Mesh::createMesh(const void* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int numOfIndices)
+{
+	computeBounds(layout, vertices, vertexCount, boundsMin, boundsMax);
+
+	std::vector<GLushort> shortIndices;
+	const void* indexData = prepareIndices(indices, numOfIndices, vertexCount, shortIndices);
+
+	uploadMesh(vertices, vertexCount, indexData, numOfIndices);
+}
+
+void Mesh::uploadMesh(const void* vertices, unsigned int vertexCount, const void* indexData, unsigned int numOfIndices)
+{
+	VAO = 0;
+	VBO = 0;
+	IBO = 0;
+
+	this->vertexCount = vertexCount;
+	indexCount = numOfIndices;
+	updateBytesUploaded = 0;
+	updateUploadCalls = 0;
+	indexBytesUploaded += numOfIndices * getIndexSize(indexType);
+	indexBytesSaved += numOfIndices * (sizeof(GLuint) - getIndexSize(indexType));
 
 	glGenBuffers(1, &IBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * numOfIndices, indices, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, IBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, getIndexSize(indexType) * numOfIndices, indexData, GL_STATIC_DRAW);
 
 	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * numOfVertices, vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)layout.stride * vertexCount, vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertices[0]) * 8, 0);
-	glEnableVertexAttribArray(0);
-	
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertices[0]) * 8, (void*)(sizeof(vertices[0]) * 3));
-	glEnableVertexAttribArray(1);
+	createVertexArray();
+}
+
+void Mesh::createVertexArray()
+{
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(vertices[0]) * 8, (void*)(sizeof(vertices[0]) * 5));
-	glEnableVertexAttribArray(2);
+	layout.apply();
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	GeometryArena::invalidateBinding();
+}
+
+void Mesh::setPositionQuantisation(glm::vec3 scale, glm::vec3 offset)
+{
+	positionScale = scale;
+	positionOffset = offset;
+}
+
+void Mesh::usePositionQuantisation(GLuint positionScaleLocation, GLuint positionOffsetLocation)
+{
+	glUniform3f(positionScaleLocation, positionScale.x, positionScale.y, positionScale.z);
+	glUniform3f(positionOffsetLocation, positionOffset.x, positionOffset.y, positionOffset.z);
+}
+
+glm::vec3 Mesh::getBoundsCentre()
+{
+	return (boundsMin + boundsMax) * 0.5f * positionScale + positionOffset;
+}
+
+GLfloat Mesh::getBoundsRadius()
+{
+	return glm::length((boundsMax - boundsMin) * 0.5f * positionScale);
+}
+
+void Mesh::optimiseGeometry(const void*& vertices, unsigned int& vertexCount, unsigned int*& indices, unsigned int numOfIndices,
+	std::vector<unsigned char>& vertexCopy, std::vector<unsigned int>& indexCopy)
+{
+	const VertexAttribDesc& position = layout.attributes[0];
+	if (position.type != GL_FLOAT || position.components < 3 || position.offset != 0)
+	{
+		printf("Mesh::optimiseGeometry skipped, positions must be floats at the start of the vertex\n");
+		return;
+	}
+
+	vertexCopy.assign((const unsigned char*)vertices, (const unsigned char*)vertices + (size_t)vertexCount * layout.stride);
+	indexCopy.assign(indices, indices + numOfIndices);
+
+	optimizerReport = MeshOptimizer::optimizeMesh((GLfloat*)vertexCopy.data(), vertexCount, layout.stride, indexCopy.data(), numOfIndices);
+	optimised = true;
+
+	vertices = vertexCopy.data();
+	vertexCount = optimizerReport.vertexCountAfter;
+	indices = indexCopy.data();
+}
+
+const void* Mesh::prepareIndices(unsigned int* indices, unsigned int numOfIndices, unsigned int vertexCount, std::vector<GLushort>& shortIndices)
+{
+	if (vertexCount > 65536)
+	{
+		indexType = GL_UNSIGNED_INT;
+		return indices;
+	}
+
+	indexType = GL_UNSIGNED_SHORT;
+	shortIndices.resize(numOfIndices);
+	for (unsigned int i = 0; i < numOfIndices; i++)
+	{
+		shortIndices[i] = (GLushort)indices[i];
+	}
+	return shortIndices.data();
+}
+
+void Mesh::computeBounds(const VertexLayoutDesc& vertexLayout, const void* vertices, unsigned int vertexCount, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	boundsMin = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+	boundsMax = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	const VertexAttribDesc& position = vertexLayout.attributes[0];
+	const unsigned char* bytes = (const unsigned char*)vertices;
+
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		const unsigned char* vertex = bytes + (size_t)i * vertexLayout.stride + position.offset;
+		glm::vec3 pos(0.f, 0.f, 0.f);
+
+		for (int c = 0; c < 3 && c < position.components; c++)
+		{
+			switch (position.type)
+			{
+			case GL_FLOAT:
+				pos[c] = ((const GLfloat*)vertex)[c];
+				break;
+			case GL_HALF_FLOAT:
+				pos[c] = VertexPacking::unpackHalf(((const GLushort*)vertex)[c]);
+				break;
+			case GL_UNSIGNED_SHORT:
+				pos[c] = ((const GLushort*)vertex)[c] / (position.normalized ? 65535.f : 1.f);
+				break;
+			case GL_SHORT:
+				pos[c] = ((const GLshort*)vertex)[c] / (position.normalized ? 32767.f : 1.f);
+				break;
+			}
+		}
+
+		boundsMin = glm::min(boundsMin, pos);
+		boundsMax = glm::max(boundsMax, pos);
+	}
+
+	if (vertexCount == 0)
+	{
+		boundsMin = glm::vec3(0.f, 0.f, 0.f);
+		boundsMax = glm::vec3(0.f, 0.f, 0.f);
+	}
+}
+
+bool Mesh::setLods(const std::vector<MeshLod>& levels)
+{
+	for (const MeshLod& lod : levels)
+	{
+		if (lod.indexCount < 0 || (GLsizeiptr)lod.firstIndex + lod.indexCount > indexCount)
+		{
+			printf("ERROR::Mesh::setLods LOD range is outside the mesh's %d indices\n", indexCount);
+			return false;
+		}
+	}
+
+	lods = levels;
+	currentLod = 0;
+	return true;
+}
+
+bool Mesh::setMeshlets(const std::vector<Meshlet>& clusters)
+{
+	GLsizei lodIndexCount = lods.empty() ? indexCount : lods[0].indexCount;
+	GLuint lodFirstIndex = lods.empty() ? 0 : lods[0].firstIndex;
+
+	for (const Meshlet& meshlet : clusters)
+	{
+		if (meshlet.firstIndex < lodFirstIndex || (GLsizeiptr)meshlet.firstIndex + meshlet.triangleCount * 3 > (GLsizeiptr)lodFirstIndex + lodIndexCount)
+		{
+			printf("ERROR::Mesh::setMeshlets meshlet range is outside LOD 0\n");
+			return false;
+		}
+	}
+
+	meshlets = clusters;
+	return true;
+}
+
+unsigned int Mesh::selectLod(const glm::mat4& model, const glm::vec3& cameraPosition, GLfloat projectionScale, GLfloat pixelError)
+{
+	if (lods.size() < 2)
+	{
+		currentLod = 0;
+		return currentLod;
+	}
+
+	GLfloat pixelsPerUnit = getPixelsPerUnit(model, cameraPosition, projectionScale);
+
+	currentLod = 0;
+	while (currentLod + 1 < lods.size() && lods[currentLod + 1].error * pixelsPerUnit <= pixelError)
+	{
+		currentLod++;
+	}
+	return currentLod;
+}
+
+GLfloat Mesh::getPixelsPerUnit(const glm::mat4& model, const glm::vec3& cameraPosition, GLfloat projectionScale)
+{
+	GLfloat scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	glm::vec3 centre = glm::vec3(model * glm::vec4(getBoundsCentre(), 1.f));
+	GLfloat distance = glm::max(glm::length(centre - cameraPosition) - getBoundsRadius() * scale, 1e-3f);
+	return scale * projectionScale / distance;
+}
+
+GLfloat Mesh::getScreenSize(const glm::mat4& model, const glm::vec3& cameraPosition, GLfloat projectionScale)
+{
+	return 2.f * getBoundsRadius() * getPixelsPerUnit(model, cameraPosition, projectionScale);
+}
+
+bool Mesh::updateVertices(unsigned int firstVertex, const void* vertices, unsigned int count)
+{
+	if ((GLsizeiptr)firstVertex + count > vertexCount)
+	{
+		printf("ERROR::Mesh::updateVertices range is outside the mesh's %d vertices\n", vertexCount);
+		return false;
+	}
+
+	queueWrite(false, (GLsizeiptr)firstVertex * layout.stride, vertices, (GLsizeiptr)count * layout.stride);
+
+	glm::vec3 updateMin;
+	glm::vec3 updateMax;
+	computeBounds(layout, vertices, count, updateMin, updateMax);
+	if (count > 0)
+	{
+		boundsMin = glm::min(boundsMin, updateMin);
+		boundsMax = glm::max(boundsMax, updateMax);
+	}
+	return true;
+}
+
+bool Mesh::updateIndices(unsigned int firstIndex, const unsigned int* indices, unsigned int count)
+{
+	if ((GLsizeiptr)firstIndex + count > indexCount)
+	{
+		printf("ERROR::Mesh::updateIndices range is outside the mesh's %d indices\n", indexCount);
+		return false;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (indices[i] >= (unsigned int)vertexCount)
+		{
+			printf("ERROR::Mesh::updateIndices index %u is past the mesh's %d vertices\n", indices[i], vertexCount);
+			return false;
+		}
+	}
+
+	if (indexType == GL_UNSIGNED_SHORT)
+	{
+		std::vector<GLushort> shortIndices(indices, indices + count);
+		queueWrite(true, (GLsizeiptr)firstIndex * sizeof(GLushort), shortIndices.data(), (GLsizeiptr)count * sizeof(GLushort));
+	}
+	else
+	{
+		queueWrite(true, (GLsizeiptr)firstIndex * sizeof(GLuint), indices, (GLsizeiptr)count * sizeof(GLuint));
+	}
+	return true;
+}
+
+bool Mesh::replaceVertices(const void* vertices)
+{
+	if (!arena && VBO == 0)
+	{
+		return false;
+	}
+
+	// Anything already queued would land on top of the new data.
+	pendingWrites.erase(std::remove_if(pendingWrites.begin(), pendingWrites.end(),
+		[](const PendingWrite& write) { return !write.indexData; }), pendingWrites.end());
+
+	GLsizeiptr size = (GLsizeiptr)vertexCount * layout.stride;
+	if (arena)
+	{
+		// The arena's buffer is shared with other meshes, so it cannot be orphaned.
+		glBindBuffer(GL_COPY_WRITE_BUFFER, arena->getVertexBuffer());
+		glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)allocation.baseVertex * layout.stride, size, vertices);
+	}
+	else
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+		glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, vertices);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	updateBytesUploaded += size;
+	updateUploadCalls++;
+
+	computeBounds(layout, vertices, vertexCount, boundsMin, boundsMax);
+	return true;
+}
+
+void Mesh::queueWrite(bool indexData, GLsizeiptr byteOffset, const void* data, GLsizeiptr size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	size_t stagingOffset = updateStaging.size();
+	updateStaging.resize(stagingOffset + size);
+	memcpy(updateStaging.data() + stagingOffset, data, size);
+
+	pendingWrites.push_back({ indexData, byteOffset, size, stagingOffset });
+}
+
+void Mesh::flushUpdates()
+{
+	if (pendingWrites.empty())
+	{
+		return;
+	}
+
+	if (arena || VBO != 0)
+	{
+		flushWrites(false);
+		flushWrites(true);
+	}
+
+	pendingWrites.clear();
+	updateStaging.clear();
+}
+
+void Mesh::flushWrites(bool indexData)
+{
+	// Queue position doubles as write order, so a stable sort keeps later writes after earlier ones.
+	std::vector<size_t> order;
+	for (size_t i = 0; i < pendingWrites.size(); i++)
+	{
+		if (pendingWrites[i].indexData == indexData)
+		{
+			order.push_back(i);
+		}
+	}
+
+	if (order.empty())
+	{
+		return;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return pendingWrites[a].byteOffset < pendingWrites[b].byteOffset; });
+
+	GLuint buffer;
+	GLsizeiptr baseOffset;
+	if (arena)
+	{
+		buffer = indexData ? arena->getIndexBuffer() : arena->getVertexBuffer();
+		baseOffset = indexData ? allocation.indexByteOffset : (GLsizeiptr)allocation.baseVertex * layout.stride;
+	}
+	else
+	{
+		buffer = indexData ? IBO : VBO;
+		baseOffset = 0;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+	size_t begin = 0;
+	while (begin < order.size())
+	{
+		GLsizeiptr rangeBegin = pendingWrites[order[begin]].byteOffset;
+		GLsizeiptr rangeEnd = rangeBegin + pendingWrites[order[begin]].size;
+
+		size_t end = begin + 1;
+		while (end < order.size() && pendingWrites[order[end]].byteOffset <= rangeEnd)
+		{
+			rangeEnd = std::max(rangeEnd, pendingWrites[order[end]].byteOffset + pendingWrites[order[end]].size);
+			end++;
+		}
+
+		const unsigned char* data;
+		if (end - begin == 1)
+		{
+			data = updateStaging.data() + pendingWrites[order[begin]].stagingOffset;
+		}
+		else
+		{
+			std::sort(order.begin() + begin, order.begin() + end);
+			mergeStaging.resize(rangeEnd - rangeBegin);
+			for (size_t i = begin; i < end; i++)
+			{
+				const PendingWrite& write = pendingWrites[order[i]];
+				memcpy(mergeStaging.data() + (write.byteOffset - rangeBegin), updateStaging.data() + write.stagingOffset, write.size);
+			}
+			data = mergeStaging.data();
+		}
+
+		glBufferSubData(GL_COPY_WRITE_BUFFER, baseOffset + rangeBegin, rangeEnd - rangeBegin, data);
+		updateBytesUploaded += rangeEnd - rangeBegin;
+		updateUploadCalls++;
+
+		begin = end;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void Mesh::renderMesh()
+{
+	flushUpdates();
+	GLsizeiptr firstIndexOffset = getDrawFirstIndex() * getIndexSize(indexType);
+
+	if (arena)
+	{
+		arena->bind();
+		glDrawElementsBaseVertex(GL_TRIANGLES, getDrawIndexCount(), indexType, (void*)(allocation.indexByteOffset + firstIndexOffset), allocation.baseVertex);
+		return;
+	}
+
+	if (VAO == 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glDrawElements(GL_TRIANGLES, getDrawIndexCount(), indexType, (void*)firstIndexOffset);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	GeometryArena::invalidateBinding();
+}
+
+void Mesh::renderRanges(const IndexRange* ranges, size_t rangeCount)
+{
+	if (rangeCount == 0 || (!arena && VAO == 0))
+	{
+		return;
+	}
+
+	flushUpdates();
 
+	std::vector<GLsizei> counts(rangeCount);
+	std::vector<void*> offsets(rangeCount);
+	std::vector<GLint> baseVertices(rangeCount, arena ? allocation.baseVertex : 0);
+	GLsizeiptr baseOffset = arena ? allocation.indexByteOffset : 0;
+
+	for (size_t i = 0; i < rangeCount; i++)
+	{
+		counts[i] = ranges[i].indexCount;
+		offsets[i] = (void*)(baseOffset + ranges[i].firstIndex * getIndexSize(indexType));
+	}
+
+	if (arena)
+	{
+		arena->bind();
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), indexType, offsets.data(), (GLsizei)rangeCount, baseVertices.data());
+		return;
+	}
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glMultiDrawElements(GL_TRIANGLES, counts.data(), indexType, offsets.data(), (GLsizei)rangeCount);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
+	GeometryArena::invalidateBinding();
 }
 
-void Mesh::renderMesh()
+void Mesh::renderInstanced(InstanceBuffer& instances, GLsizei count)
 {
+	if (count <= 0 || (!arena && VAO == 0))
+	{
+		return;
+	}
+
+	flushUpdates();
+	instances.upload();
+	GLsizeiptr firstIndexOffset = getDrawFirstIndex() * getIndexSize(indexType);
+
+	if (arena)
+	{
+		arena->bind();
+		instances.bindAttributes();
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, getDrawIndexCount(), indexType, (void*)(allocation.indexByteOffset + firstIndexOffset),
+			count, allocation.baseVertex);
+		instances.unbindAttributes();
+		return;
+	}
+
 	glBindVertexArray(VAO);
+	instances.bindAttributes();
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+	glDrawElementsInstanced(GL_TRIANGLES, getDrawIndexCount(), indexType, (void*)firstIndexOffset, count);
+	instances.unbindAttributes();
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
+	GeometryArena::invalidateBinding();
+}
+
+void Mesh::printIndexStats()
+{
+	printf("Mesh: %lld index bytes uploaded, %lld bytes saved by 16 bit indices\n",
+		(long long)indexBytesUploaded, (long long)indexBytesSaved);
 }
 
 void Mesh::clearMesh()
 {
+	if (indexCount > 0 && (arena || IBO != 0))
+	{
+		indexBytesUploaded -= indexCount * getIndexSize(indexType);
+		indexBytesSaved -= indexCount * (sizeof(GLuint) - getIndexSize(indexType));
+	}
+
+	if (arena)
+	{
+		arena->release(allocation);
+		arena = nullptr;
+	}
+
 	if (IBO != 0)
 	{
 		glDeleteBuffers(1, &IBO);
@@ -59,11 +794,17 @@ void Mesh::clearMesh()
 	
 	if (VAO != 0)
 	{
-		glDeleteBuffers(1, &VAO);
+		glDeleteVertexArrays(1, &VAO);
 		VAO = 0;
 	}
 
+	vertexCount = 0;
 	indexCount = 0;
+	pendingWrites.clear();
+	updateStaging.clear();
+	lods.clear();
+	currentLod = 0;
+	meshlets.clear();
 }
 
 Mesh::~Mesh()
@@ -1,13 +1,113 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 #include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "GeometryArena.h"
+#include "InstanceBuffer.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "UploadThread.h"
+#include "VertexLayout.h"
 
 class Mesh
 {
 public:
-	Mesh(GLfloat* vertices, unsigned int* indices, unsigned int numOfVertices, unsigned int numOfIndices);
+	Mesh(GLfloat* vertices, unsigned int* indices, unsigned int numOfVertices, unsigned int numOfIndices, bool optimise = false);
+	Mesh(const void* vertices, unsigned int vertexCount, const VertexLayoutDesc& vertexLayout, unsigned int* indices, unsigned int numOfIndices, bool optimise = false);
+	Mesh(GeometryArena* geometryArena, const void* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int numOfIndices, bool optimise = false);
+
+	// Already processed data, e.g. straight from a MeshCache: indices are uploaded as indexType and bounds are not recomputed.
+	Mesh(const void* vertices, unsigned int vertexCount, const VertexLayoutDesc& vertexLayout, const void* indices, unsigned int numOfIndices,
+		GLenum indexType, glm::vec3 boundsMin, glm::vec3 boundsMax);
+	Mesh(GeometryArena* geometryArena, const void* vertices, unsigned int vertexCount, const void* indices, unsigned int numOfIndices,
+		GLenum indexType, glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+	// Takes ownership of buffers that were already filled, e.g. on an UploadThread, and only builds the vertex array.
+	Mesh(GLuint vertexBuffer, GLuint indexBuffer, unsigned int vertexCount, const VertexLayoutDesc& vertexLayout, unsigned int numOfIndices,
+		GLenum indexType, glm::vec3 boundsMin, glm::vec3 boundsMax);
+	// Takes a range GeometryArena::allocateAsync has already filled.
+	Mesh(GeometryArena* geometryArena, const ArenaAllocation& arenaAllocation, glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+	typedef std::function<void(std::unique_ptr<Mesh>)> MeshReadyFunction;
+	// Narrows indices, computes bounds and fills the buffers on uploader's thread, then hands the
+	// finished Mesh to onReady on the render thread. With geometryArena the buffers are then copied
+	// into it on uploader's thread too, so the mesh still joins DrawList's indirect batches, and kept
+	// as the mesh's own if the arena is full.
+	static void createAsync(UploadThread& uploader, GeometryArena* geometryArena, std::vector<unsigned char> vertices, unsigned int vertexCount, const VertexLayoutDesc& vertexLayout,
+		std::vector<unsigned int> indices, MeshReadyFunction onReady);
+
+	void setPositionQuantisation(glm::vec3 scale, glm::vec3 offset);
+	void usePositionQuantisation(GLuint positionScaleLocation, GLuint positionOffsetLocation);
+
+	glm::vec3 getPositionScale() { return positionScale; }
+	glm::vec3 getPositionOffset() { return positionOffset; }
+
+	glm::vec3 getBoundsCentre();
+	GLfloat getBoundsRadius();
+
+	// Bounds of the stored positions, before quantisation is undone.
+	static void computeBounds(const VertexLayoutDesc& vertexLayout, const void* vertices, unsigned int vertexCount, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+	GeometryArena* getArena() { return arena; }
+	const ArenaAllocation& getAllocation() { return allocation; }
+	GLsizei getIndexCount() { return indexCount; }
+	GLenum getIndexType() { return indexType; }
+	static GLsizeiptr getIndexSize(GLenum type) { return type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint); }
+
+	static GLsizeiptr getIndexBytesUploaded() { return indexBytesUploaded; }
+	static GLsizeiptr getIndexBytesSaved() { return indexBytesSaved; }
+	static void printIndexStats();
+
+	// Ranges of the uploaded indices, LOD 0 first, as built by MeshSimplifier::buildLodChain.
+	bool setLods(const std::vector<MeshLod>& levels);
+	unsigned int getLodCount() { return lods.empty() ? 1 : (unsigned int)lods.size(); }
+	unsigned int getCurrentLod() { return currentLod; }
+	void setCurrentLod(unsigned int lod) { currentLod = lod < getLodCount() ? lod : getLodCount() - 1; }
+
+	// Picks the coarsest level whose error, projected at the nearest point of the bounds, stays under
+	// pixelError. projectionScale is projection[1][1] * viewport height / 2.
+	unsigned int selectLod(const glm::mat4& model, const glm::vec3& cameraPosition, GLfloat projectionScale, GLfloat pixelError = 1.f);
+	// Screen pixels per model space unit at the nearest point of the bounds.
+	GLfloat getPixelsPerUnit(const glm::mat4& model, const glm::vec3& cameraPosition, GLfloat projectionScale);
+	// Projected diameter of the bounds in pixels, at most.
+	GLfloat getScreenSize(const glm::mat4& model, const glm::vec3& cameraPosition, GLfloat projectionScale);
+
+	// The index range renderMesh draws for the current LOD, relative to the mesh's own indices.
+	GLuint getDrawFirstIndex() { return lods.empty() ? 0 : lods[currentLod].firstIndex; }
+	GLsizei getDrawIndexCount() { return lods.empty() ? indexCount : lods[currentLod].indexCount; }
+
+	// Clusters of LOD 0, built by MeshletBuilder::buildMeshlets on the indices this mesh was created with.
+	bool setMeshlets(const std::vector<Meshlet>& clusters);
+	const std::vector<Meshlet>& getMeshlets() { return meshlets; }
+	bool hasMeshlets() { return !meshlets.empty(); }
+
+	// Partial updates, queued and sent by flushUpdates(), which every draw path calls first. Writes that
+	// touch or overlap are merged into one upload, later writes winning. Bounds only ever grow, and
+	// meshlet cones and LOD errors are not rebuilt, so keep edits small relative to the mesh.
+	bool updateVertices(unsigned int firstVertex, const void* vertices, unsigned int count);
+	bool updateIndices(unsigned int firstIndex, const unsigned int* indices, unsigned int count);
+	// Replaces every vertex at once. A mesh with its own buffers orphans the old storage so draws still
+	// queued on the GPU keep theirs instead of stalling the upload.
+	bool replaceVertices(const void* vertices);
+	void flushUpdates();
+
+	GLsizei getVertexCount() { return vertexCount; }
+	GLsizeiptr getUpdateBytesUploaded() { return updateBytesUploaded; }
+	GLuint getUpdateUploadCalls() { return updateUploadCalls; }
+
+	bool wasOptimised() { return optimised; }
+	const MeshOptimizerReport& getOptimizerReport() { return optimizerReport; }
 
 	void renderMesh();
+	void renderRanges(const IndexRange* ranges, size_t rangeCount);
+	// Draws the current LOD once for each of the first count instances, uploading any dirty instances first.
+	void renderInstanced(InstanceBuffer& instances, GLsizei count);
 	void clearMesh();
 
 	~Mesh();
@@ -16,7 +116,50 @@ private:
 	GLuint VAO;
 	GLuint VBO;
 	GLuint IBO;
-
+	GLsizei vertexCount;
 	GLsizei indexCount;
-};
+	GLenum indexType;
+
+	GeometryArena* arena;
+	ArenaAllocation allocation;
 
+	VertexLayoutDesc layout;
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	std::vector<MeshLod> lods;
+	unsigned int currentLod;
+	std::vector<Meshlet> meshlets;
+
+	struct PendingWrite
+	{
+		bool indexData;
+		GLsizeiptr byteOffset;
+		GLsizeiptr size;
+		size_t stagingOffset;
+	};
+
+	std::vector<PendingWrite> pendingWrites;
+	std::vector<unsigned char> updateStaging;
+	std::vector<unsigned char> mergeStaging;
+	GLsizeiptr updateBytesUploaded;
+	GLuint updateUploadCalls;
+
+	bool optimised;
+	MeshOptimizerReport optimizerReport;
+
+	static GLsizeiptr indexBytesUploaded;
+	static GLsizeiptr indexBytesSaved;
+
+	void optimiseGeometry(const void*& vertices, unsigned int& vertexCount, unsigned int*& indices, unsigned int numOfIndices,
+		std::vector<unsigned char>& vertexCopy, std::vector<unsigned int>& indexCopy);
+	const void* prepareIndices(unsigned int* indices, unsigned int numOfIndices, unsigned int vertexCount, std::vector<GLushort>& shortIndices);
+	void createMesh(const void* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int numOfIndices);
+	void uploadMesh(const void* vertices, unsigned int vertexCount, const void* indexData, unsigned int numOfIndices);
+	void createVertexArray();
+	void queueWrite(bool indexData, GLsizeiptr byteOffset, const void* data, GLsizeiptr size);
+	void flushWrites(bool indexData);
+	void uploadToArena(GeometryArena* geometryArena, const void* vertices, unsigned int vertexCount, const void* indexData, unsigned int numOfIndices);
+};
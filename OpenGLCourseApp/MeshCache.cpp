@@ -0,0 +1,240 @@
+#include "MeshCache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+
+namespace
+{
+	GLuint64 alignUp(GLuint64 value, GLuint64 alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	void writePadding(std::ofstream& out, GLuint64 written, GLuint64 target)
+	{
+		static const char zeros[MeshCacheHeader::blobAlignment] = {};
+		while (written < target)
+		{
+			GLuint64 count = target - written < sizeof(zeros) ? target - written : sizeof(zeros);
+			out.write(zeros, (std::streamsize)count);
+			written += count;
+		}
+	}
+}
+
+MeshCache::MeshCache()
+{
+	header = nullptr;
+	entries = nullptr;
+}
+
+bool MeshCache::open(const char* fileLocation)
+{
+	close();
+
+	if (!file.open(fileLocation))
+	{
+		return false;
+	}
+
+	if (!validate(fileLocation))
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshCache::validate(const char* fileLocation)
+{
+	size_t size = file.getSize();
+	if (size < sizeof(MeshCacheHeader))
+	{
+		printf("ERROR::MeshCache::open %s is too small\n", fileLocation);
+		return false;
+	}
+
+	const MeshCacheHeader* fileHeader = (const MeshCacheHeader*)file.getData();
+	if (fileHeader->fileMagic != MeshCacheHeader::magic || fileHeader->fileVersion != MeshCacheHeader::version ||
+		fileHeader->entrySize != sizeof(MeshCacheEntry))
+	{
+		printf("MeshCache: %s is from a different format version, ignoring it\n", fileLocation);
+		return false;
+	}
+
+	if (fileHeader->fileSize != size || fileHeader->tableOffset > size ||
+		(size - fileHeader->tableOffset) / sizeof(MeshCacheEntry) < fileHeader->meshCount)
+	{
+		printf("ERROR::MeshCache::open %s does not match its recorded size\n", fileLocation);
+		return false;
+	}
+
+	const MeshCacheEntry* table = (const MeshCacheEntry*)(file.getData() + fileHeader->tableOffset);
+	for (GLuint i = 0; i < fileHeader->meshCount; i++)
+	{
+		const MeshCacheEntry& entry = table[i];
+		bool valid = entry.layout.attributeCount <= VertexLayoutDesc::maxAttributes &&
+			(entry.indexType == GL_UNSIGNED_SHORT || entry.indexType == GL_UNSIGNED_INT) &&
+			entry.vertexBytes == (GLuint64)entry.vertexCount * entry.layout.stride &&
+			entry.indexBytes == (GLuint64)entry.indexCount * Mesh::getIndexSize(entry.indexType) &&
+			entry.vertexOffset <= size && entry.vertexBytes <= size - entry.vertexOffset &&
+			entry.indexOffset <= size && entry.indexBytes <= size - entry.indexOffset;
+
+		if (!valid)
+		{
+			printf("ERROR::MeshCache::open %s has a corrupt entry %u\n", fileLocation, i);
+			return false;
+		}
+	}
+
+	header = fileHeader;
+	entries = table;
+	return true;
+}
+
+int MeshCache::findMesh(const char* name, GLuint64 sourceHash)
+{
+	for (unsigned int i = 0; i < getMeshCount(); i++)
+	{
+		if (strncmp(entries[i].name, name, sizeof(entries[i].name)) != 0)
+		{
+			continue;
+		}
+
+		if (entries[i].sourceHash != sourceHash)
+		{
+			printf("MeshCache: %s has changed since it was cached, rebuilding it\n", name);
+			return -1;
+		}
+		return (int)i;
+	}
+	return -1;
+}
+
+std::unique_ptr<Mesh> MeshCache::createMesh(unsigned int index, GeometryArena* geometryArena)
+{
+	const MeshCacheEntry& entry = entries[index];
+	glm::vec3 boundsMin(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+	glm::vec3 boundsMax(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+
+	std::unique_ptr<Mesh> mesh;
+	if (geometryArena && geometryArena->getLayout() == entry.layout)
+	{
+		mesh = std::make_unique<Mesh>(geometryArena, getVertices(index), entry.vertexCount, getIndices(index), entry.indexCount,
+			entry.indexType, boundsMin, boundsMax);
+	}
+	else
+	{
+		if (geometryArena)
+		{
+			printf("MeshCache: %s does not match the arena layout, creating a standalone mesh\n", entry.name);
+		}
+		mesh = std::make_unique<Mesh>(getVertices(index), entry.vertexCount, entry.layout, getIndices(index), entry.indexCount,
+			entry.indexType, boundsMin, boundsMax);
+	}
+
+	mesh->setPositionQuantisation(glm::vec3(entry.positionScale[0], entry.positionScale[1], entry.positionScale[2]),
+		glm::vec3(entry.positionOffset[0], entry.positionOffset[1], entry.positionOffset[2]));
+	return mesh;
+}
+
+bool MeshCache::write(const char* fileLocation, const std::vector<MeshCacheSource>& meshes)
+{
+	std::vector<MeshCacheEntry> table(meshes.size());
+
+	GLuint64 offset = alignUp(sizeof(MeshCacheHeader) + sizeof(MeshCacheEntry) * meshes.size(), MeshCacheHeader::blobAlignment);
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const MeshCacheSource& source = meshes[i];
+		MeshCacheEntry& entry = table[i];
+		memset(&entry, 0, sizeof(entry));
+
+		strncpy(entry.name, source.name, sizeof(entry.name) - 1);
+		entry.sourceHash = source.sourceHash;
+		entry.layout = source.layout;
+		entry.vertexCount = source.vertexCount;
+		entry.indexCount = source.indexCount;
+		entry.indexType = source.indexType;
+
+		glm::vec3 boundsMin, boundsMax;
+		Mesh::computeBounds(source.layout, source.vertices, source.vertexCount, boundsMin, boundsMax);
+		for (int c = 0; c < 3; c++)
+		{
+			entry.positionScale[c] = source.positionScale[c];
+			entry.positionOffset[c] = source.positionOffset[c];
+			entry.boundsMin[c] = boundsMin[c];
+			entry.boundsMax[c] = boundsMax[c];
+		}
+
+		entry.vertexOffset = offset;
+		entry.vertexBytes = (GLuint64)source.vertexCount * source.layout.stride;
+		offset = alignUp(offset + entry.vertexBytes, MeshCacheHeader::blobAlignment);
+
+		entry.indexOffset = offset;
+		entry.indexBytes = (GLuint64)source.indexCount * Mesh::getIndexSize(source.indexType);
+		offset = alignUp(offset + entry.indexBytes, MeshCacheHeader::blobAlignment);
+	}
+
+	MeshCacheHeader fileHeader;
+	fileHeader.fileMagic = MeshCacheHeader::magic;
+	fileHeader.fileVersion = MeshCacheHeader::version;
+	fileHeader.meshCount = (GLuint)meshes.size();
+	fileHeader.entrySize = sizeof(MeshCacheEntry);
+	fileHeader.tableOffset = sizeof(MeshCacheHeader);
+	fileHeader.fileSize = offset;
+
+	std::ofstream out(fileLocation, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		printf("ERROR::MeshCache::write could not create %s\n", fileLocation);
+		return false;
+	}
+
+	out.write((const char*)&fileHeader, sizeof(fileHeader));
+	out.write((const char*)table.data(), (std::streamsize)(sizeof(MeshCacheEntry) * table.size()));
+	GLuint64 written = sizeof(fileHeader) + sizeof(MeshCacheEntry) * table.size();
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		writePadding(out, written, table[i].vertexOffset);
+		out.write((const char*)meshes[i].vertices, (std::streamsize)table[i].vertexBytes);
+		written = table[i].vertexOffset + table[i].vertexBytes;
+
+		writePadding(out, written, table[i].indexOffset);
+		out.write((const char*)meshes[i].indices, (std::streamsize)table[i].indexBytes);
+		written = table[i].indexOffset + table[i].indexBytes;
+	}
+	writePadding(out, written, offset);
+
+	if (!out.good())
+	{
+		printf("ERROR::MeshCache::write failed writing %s\n", fileLocation);
+		return false;
+	}
+
+	return true;
+}
+
+GLuint64 MeshCache::hashSource(const void* data, size_t size, GLuint64 hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+void MeshCache::close()
+{
+	file.close();
+	header = nullptr;
+	entries = nullptr;
+}
+
+MeshCache::~MeshCache()
+{
+	close();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "VertexLayout.h"
+
+// On disk: MeshCacheHeader, the MeshCacheEntry table, then every vertex and index blob aligned to
+// blobAlignment. Everything is stored exactly as it is uploaded, so loading is a map and a copy to GL.
+struct MeshCacheHeader
+{
+	static constexpr GLuint magic = 0x4843534d;	// "MSCH"
+	static constexpr GLuint version = 2;
+	static constexpr GLuint blobAlignment = 256;
+
+	GLuint fileMagic;
+	GLuint fileVersion;
+	GLuint meshCount;
+	GLuint entrySize;
+	GLuint64 tableOffset;
+	GLuint64 fileSize;
+};
+
+struct MeshCacheEntry
+{
+	char name[64];
+	// Hash of whatever the mesh was built from, so an entry is rebuilt once its source changes.
+	GLuint64 sourceHash;
+	VertexLayoutDesc layout;
+	GLuint vertexCount;
+	GLuint indexCount;
+	GLenum indexType;
+	GLuint reserved;
+	GLfloat positionScale[3];
+	GLfloat positionOffset[3];
+	GLfloat boundsMin[3];
+	GLfloat boundsMax[3];
+	GLuint64 vertexOffset;
+	GLuint64 vertexBytes;
+	GLuint64 indexOffset;
+	GLuint64 indexBytes;
+};
+
+struct MeshCacheSource
+{
+	const char* name;
+	VertexLayoutDesc layout;
+	const void* vertices;
+	unsigned int vertexCount;
+	const void* indices;
+	unsigned int indexCount;
+	GLenum indexType;
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+	GLuint64 sourceHash;
+};
+
+class MeshCache
+{
+public:
+	MeshCache();
+
+	bool open(const char* fileLocation);
+	void close();
+
+	unsigned int getMeshCount() { return header ? header->meshCount : 0; }
+	const MeshCacheEntry& getEntry(unsigned int index) { return entries[index]; }
+	const void* getVertices(unsigned int index) { return file.getData() + entries[index].vertexOffset; }
+	const void* getIndices(unsigned int index) { return file.getData() + entries[index].indexOffset; }
+	// -1 if there is no entry called name or it was built from a different source.
+	int findMesh(const char* name, GLuint64 sourceHash);
+
+	// Uploads straight from the mapped blobs. Falls back to a standalone mesh if the arena layout differs.
+	std::unique_ptr<Mesh> createMesh(unsigned int index, GeometryArena* geometryArena = nullptr);
+
+	// Bounds are computed here; indices must already be in indexType.
+	static bool write(const char* fileLocation, const std::vector<MeshCacheSource>& meshes);
+	// FNV-1a, chained through hash to cover sources in several pieces.
+	static GLuint64 hashSource(const void* data, size_t size, GLuint64 hash = 14695981039346656037ull);
+
+	~MeshCache();
+
+private:
+	MappedFile file;
+	const MeshCacheHeader* header;
+	const MeshCacheEntry* entries;
+
+	bool validate(const char* fileLocation);
+};
@@ -0,0 +1,899 @@
+#include "MeshImporter.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <memory>
+
+#include "JsonValue.h"
+#include "MappedFile.h"
+#include "MeshNormals.h"
+#include "MeshWelder.h"
+
+namespace
+{
+	struct ObjCorner
+	{
+		int index[3];
+		unsigned char relative;
+	};
+
+	struct ObjGroup
+	{
+		size_t firstCorner;
+		std::string name;
+	};
+
+	// What one thread tokenised from its slice of a block. Negative OBJ indices are kept relative to the
+	// chunk until the chunks are merged in order and the running attribute counts are known.
+	struct ObjChunk
+	{
+		std::vector<GLfloat> positions;
+		std::vector<GLfloat> texCoords;
+		std::vector<GLfloat> normals;
+		std::vector<ObjCorner> corners;
+		std::vector<ObjGroup> groups;
+		unsigned int badLines;
+	};
+
+	struct ObjState
+	{
+		std::vector<GLfloat> positions;
+		std::vector<GLfloat> texCoords;
+		std::vector<GLfloat> normals;
+		std::vector<ObjCorner> objectCorners;
+		std::string objectName;
+		bool objectHasNormals;
+		unsigned int badLines;
+		unsigned int badIndices;
+	};
+
+	const char* skipSpaces(const char* current, const char* end)
+	{
+		while (current < end && (*current == ' ' || *current == '\t'))
+		{
+			current++;
+		}
+		return current;
+	}
+
+	bool parseFloat(const char*& current, const char* end, GLfloat& value)
+	{
+		current = skipSpaces(current, end);
+		if (current < end && *current == '+')
+		{
+			current++;
+		}
+
+		auto result = std::from_chars(current, end, value);
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+		current = result.ptr;
+		return true;
+	}
+
+	size_t parseFloats(const char* current, const char* end, GLfloat* values, size_t count)
+	{
+		size_t parsed = 0;
+		while (parsed < count && parseFloat(current, end, values[parsed]))
+		{
+			parsed++;
+		}
+		return parsed;
+	}
+
+	bool parseFace(const char* current, const char* end, ObjChunk& chunk, std::vector<ObjCorner>& faceCorners)
+	{
+		int counts[3] = { (int)(chunk.positions.size() / 3), (int)(chunk.texCoords.size() / 2), (int)(chunk.normals.size() / 3) };
+		faceCorners.clear();
+
+		while (true)
+		{
+			current = skipSpaces(current, end);
+			if (current >= end)
+			{
+				break;
+			}
+
+			ObjCorner corner = { { -1, -1, -1 }, 0 };
+			const char* cornerStart = current;
+
+			for (int c = 0; c < 3; c++)
+			{
+				if (c > 0)
+				{
+					if (current >= end || *current != '/')
+					{
+						break;
+					}
+					current++;
+				}
+
+				if (current < end && *current != '/' && *current != ' ' && *current != '\t')
+				{
+					int value = 0;
+					auto result = std::from_chars(current, end, value);
+					if (result.ec != std::errc())
+					{
+						return false;
+					}
+					current = result.ptr;
+
+					if (value > 0)
+					{
+						corner.index[c] = value - 1;
+					}
+					else if (value < 0)
+					{
+						corner.index[c] = counts[c] + value;
+						corner.relative |= 1 << c;
+					}
+				}
+			}
+
+			if (current == cornerStart || (current < end && *current != ' ' && *current != '\t'))
+			{
+				return false;
+			}
+			faceCorners.push_back(corner);
+		}
+
+		if (faceCorners.size() < 3)
+		{
+			return false;
+		}
+
+		for (size_t i = 1; i + 1 < faceCorners.size(); i++)
+		{
+			chunk.corners.push_back(faceCorners[0]);
+			chunk.corners.push_back(faceCorners[i]);
+			chunk.corners.push_back(faceCorners[i + 1]);
+		}
+		return true;
+	}
+
+	void parseObjChunk(const char* begin, const char* end, ObjChunk& chunk)
+	{
+		chunk.positions.clear();
+		chunk.texCoords.clear();
+		chunk.normals.clear();
+		chunk.corners.clear();
+		chunk.groups.clear();
+		chunk.badLines = 0;
+
+		std::vector<ObjCorner> faceCorners;
+		GLfloat values[3];
+
+		const char* line = begin;
+		while (line < end)
+		{
+			const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+			const char* next = lineEnd ? lineEnd + 1 : end;
+			if (!lineEnd)
+			{
+				lineEnd = end;
+			}
+			if (lineEnd > line && lineEnd[-1] == '\r')
+			{
+				lineEnd--;
+			}
+
+			const char* current = skipSpaces(line, lineEnd);
+			line = next;
+
+			if (lineEnd - current < 2 || (current[1] != ' ' && current[1] != '\t' && current[0] != 'v'))
+			{
+				continue;
+			}
+
+			bool valid = true;
+			switch (current[0])
+			{
+			case 'v':
+				if (current[1] == ' ' || current[1] == '\t')
+				{
+					valid = parseFloats(current + 1, lineEnd, values, 3) == 3;
+					chunk.positions.insert(chunk.positions.end(), values, values + 3);
+				}
+				else if (current[1] == 't')
+				{
+					values[1] = 0.f;
+					valid = parseFloats(current + 2, lineEnd, values, 2) >= 1;
+					chunk.texCoords.push_back(values[0]);
+					chunk.texCoords.push_back(1.f - values[1]);
+				}
+				else if (current[1] == 'n')
+				{
+					valid = parseFloats(current + 2, lineEnd, values, 3) == 3;
+					chunk.normals.insert(chunk.normals.end(), values, values + 3);
+				}
+				break;
+			case 'f':
+				valid = parseFace(current + 1, lineEnd, chunk, faceCorners);
+				break;
+			case 'o':
+			case 'g':
+			{
+				const char* name = skipSpaces(current + 1, lineEnd);
+				chunk.groups.push_back({ chunk.corners.size(), std::string(name, lineEnd - name) });
+				break;
+			}
+			}
+
+			if (!valid)
+			{
+				chunk.badLines++;
+			}
+		}
+	}
+
+	void emitObject(ObjState& state, const MeshImporter::MeshCallback& onMesh, ImportStats& stats, ThreadPool* pool)
+	{
+		if (state.objectCorners.empty())
+		{
+			return;
+		}
+
+		size_t cornerCount = state.objectCorners.size();
+		int counts[3] = { (int)(state.positions.size() / 3), (int)(state.texCoords.size() / 2), (int)(state.normals.size() / 3) };
+		std::vector<GLfloat> soup(cornerCount * 8);
+		std::atomic<unsigned int> badIndices(0);
+
+		pool->parallelFor(cornerCount, 16384, [&](size_t begin, size_t end)
+		{
+			unsigned int bad = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				const ObjCorner& corner = state.objectCorners[i];
+				GLfloat* vertex = &soup[i * 8];
+
+				if (corner.index[0] >= 0 && corner.index[0] < counts[0])
+				{
+					memcpy(vertex, &state.positions[(size_t)corner.index[0] * 3], 3 * sizeof(GLfloat));
+				}
+				else
+				{
+					vertex[0] = vertex[1] = vertex[2] = 0.f;
+					bad++;
+				}
+
+				if (corner.index[1] >= 0 && corner.index[1] < counts[1])
+				{
+					memcpy(vertex + 3, &state.texCoords[(size_t)corner.index[1] * 2], 2 * sizeof(GLfloat));
+				}
+				else
+				{
+					vertex[3] = vertex[4] = 0.f;
+					bad += corner.index[1] != -1 ? 1 : 0;
+				}
+
+				if (corner.index[2] >= 0 && corner.index[2] < counts[2])
+				{
+					memcpy(vertex + 5, &state.normals[(size_t)corner.index[2] * 3], 3 * sizeof(GLfloat));
+				}
+				else
+				{
+					vertex[5] = vertex[6] = vertex[7] = 0.f;
+					bad += corner.index[2] != -1 ? 1 : 0;
+				}
+			}
+			badIndices += bad;
+		});
+		state.badIndices += badIndices;
+
+		ImportedMesh mesh;
+		mesh.name = state.objectName;
+		MeshWelder::weldVertices(soup.data(), (unsigned int)cornerCount, 8, nullptr, 0, 0.f, mesh.vertices, mesh.indices, pool);
+		soup = std::vector<GLfloat>();
+
+		if (!state.objectHasNormals)
+		{
+			MeshNormals::calcAverageNormals(mesh.indices.data(), (unsigned int)mesh.indices.size(), mesh.vertices.data(),
+				(unsigned int)mesh.vertices.size(), 8, 5, NormalWeighting::Uniform, pool);
+		}
+
+		stats.meshCount++;
+		stats.vertexCount += mesh.getVertexCount();
+		stats.triangleCount += (unsigned int)(mesh.indices.size() / 3);
+
+		state.objectCorners.clear();
+		state.objectHasNormals = false;
+		onMesh(mesh);
+	}
+
+	void mergeChunk(ObjChunk& chunk, ObjState& state, const MeshImporter::MeshCallback& onMesh, ImportStats& stats, ThreadPool* pool)
+	{
+		int base[3] = { (int)(state.positions.size() / 3), (int)(state.texCoords.size() / 2), (int)(state.normals.size() / 3) };
+
+		state.positions.insert(state.positions.end(), chunk.positions.begin(), chunk.positions.end());
+		state.texCoords.insert(state.texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+		state.normals.insert(state.normals.end(), chunk.normals.begin(), chunk.normals.end());
+		state.badLines += chunk.badLines;
+
+		size_t group = 0;
+		for (size_t i = 0; i <= chunk.corners.size(); i++)
+		{
+			for (; group < chunk.groups.size() && chunk.groups[group].firstCorner == i; group++)
+			{
+				emitObject(state, onMesh, stats, pool);
+				state.objectName = chunk.groups[group].name;
+			}
+
+			if (i == chunk.corners.size())
+			{
+				break;
+			}
+
+			ObjCorner corner = chunk.corners[i];
+			for (int c = 0; c < 3; c++)
+			{
+				if (corner.relative & (1 << c))
+				{
+					corner.index[c] += base[c];
+				}
+			}
+			state.objectHasNormals |= corner.index[2] != -1;
+			state.objectCorners.push_back(corner);
+		}
+	}
+
+	struct AccessorView
+	{
+		const unsigned char* data;
+		size_t count;
+		size_t stride;
+		int componentType;
+		int components;
+		bool normalized;
+	};
+
+	struct BufferData
+	{
+		const unsigned char* data;
+		size_t size;
+	};
+
+	size_t componentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		}
+		return 0;
+	}
+
+	int typeComponents(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	bool resolveAccessor(const JsonValue& root, const std::vector<BufferData>& buffers, int accessorIndex, AccessorView& view)
+	{
+		const JsonValue& accessor = root["accessors"][(size_t)accessorIndex];
+		if (accessorIndex < 0 || accessor.isNull() || accessor.has("sparse"))
+		{
+			return false;
+		}
+
+		const JsonValue& bufferView = root["bufferViews"][(size_t)accessor["bufferView"].getInt()];
+		int bufferIndex = bufferView["buffer"].getInt();
+		if (bufferView.isNull() || bufferIndex < 0 || bufferIndex >= (int)buffers.size() || !buffers[bufferIndex].data)
+		{
+			return false;
+		}
+
+		view.componentType = accessor["componentType"].getInt();
+		view.components = typeComponents(accessor["type"].getString());
+		view.count = (size_t)accessor["count"].getNumber();
+		view.normalized = accessor["normalized"].getBool();
+
+		size_t elementSize = componentSize(view.componentType) * view.components;
+		size_t viewOffset = (size_t)bufferView["byteOffset"].getNumber();
+		size_t viewLength = (size_t)bufferView["byteLength"].getNumber();
+		size_t accessorOffset = (size_t)accessor["byteOffset"].getNumber();
+		view.stride = (size_t)bufferView["byteStride"].getNumber((double)elementSize);
+
+		const BufferData& buffer = buffers[bufferIndex];
+		if (elementSize == 0 || viewOffset > buffer.size || viewLength > buffer.size - viewOffset)
+		{
+			return false;
+		}
+		if (view.count > 0 && (view.stride < elementSize || accessorOffset > viewLength || elementSize > viewLength - accessorOffset ||
+			view.count - 1 > (viewLength - accessorOffset - elementSize) / view.stride))
+		{
+			return false;
+		}
+
+		view.data = buffer.data + viewOffset + accessorOffset;
+		return true;
+	}
+
+	GLfloat readComponent(const AccessorView& view, size_t element, int component)
+	{
+		const unsigned char* value = view.data + element * view.stride + component * componentSize(view.componentType);
+		switch (view.componentType)
+		{
+		case GL_FLOAT:
+		{
+			GLfloat result;
+			memcpy(&result, value, sizeof(result));
+			return result;
+		}
+		case GL_UNSIGNED_BYTE:
+			return view.normalized ? *value / 255.f : (GLfloat)*value;
+		case GL_BYTE:
+			return view.normalized ? std::max(*(const signed char*)value / 127.f, -1.f) : (GLfloat)*(const signed char*)value;
+		case GL_UNSIGNED_SHORT:
+		{
+			GLushort result;
+			memcpy(&result, value, sizeof(result));
+			return view.normalized ? result / 65535.f : (GLfloat)result;
+		}
+		case GL_SHORT:
+		{
+			GLshort result;
+			memcpy(&result, value, sizeof(result));
+			return view.normalized ? std::max(result / 32767.f, -1.f) : (GLfloat)result;
+		}
+		case GL_UNSIGNED_INT:
+		{
+			GLuint result;
+			memcpy(&result, value, sizeof(result));
+			return (GLfloat)result;
+		}
+		}
+		return 0.f;
+	}
+
+	unsigned int readIndex(const AccessorView& view, size_t element)
+	{
+		const unsigned char* value = view.data + element * view.stride;
+		switch (view.componentType)
+		{
+		case GL_UNSIGNED_BYTE:
+			return *value;
+		case GL_UNSIGNED_SHORT:
+		{
+			GLushort result;
+			memcpy(&result, value, sizeof(result));
+			return result;
+		}
+		case GL_UNSIGNED_INT:
+		{
+			GLuint result;
+			memcpy(&result, value, sizeof(result));
+			return result;
+		}
+		}
+		return ~0u;
+	}
+
+	bool decodeBase64(const char* text, size_t length, std::vector<unsigned char>& out)
+	{
+		unsigned int accumulator = 0;
+		int bits = 0;
+		out.clear();
+		out.reserve(length / 4 * 3);
+
+		for (size_t i = 0; i < length && text[i] != '='; i++)
+		{
+			char c = text[i];
+			int value;
+			if (c >= 'A' && c <= 'Z') value = c - 'A';
+			else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+			else if (c >= '0' && c <= '9') value = c - '0' + 52;
+			else if (c == '+') value = 62;
+			else if (c == '/') value = 63;
+			else return false;
+
+			accumulator = (accumulator << 6) | value;
+			bits += 6;
+			if (bits >= 8)
+			{
+				bits -= 8;
+				out.push_back((unsigned char)(accumulator >> bits));
+			}
+		}
+		return true;
+	}
+
+	bool importPrimitive(const JsonValue& root, const std::vector<BufferData>& buffers, const JsonValue& primitive, const std::string& name,
+		const MeshImporter::MeshCallback& onMesh, ImportStats& stats, ThreadPool* pool)
+	{
+		if (primitive["mode"].getInt(GL_TRIANGLES) != GL_TRIANGLES)
+		{
+			printf("MeshImporter: skipping %s, only triangle primitives are supported\n", name.c_str());
+			return true;
+		}
+
+		const JsonValue& attributes = primitive["attributes"];
+		AccessorView position, texCoord, normal, indexView;
+		if (!resolveAccessor(root, buffers, attributes["POSITION"].getInt(), position) || position.components < 3)
+		{
+			printf("ERROR::MeshImporter::importGltf %s has no usable POSITION accessor\n", name.c_str());
+			return false;
+		}
+
+		bool hasTexCoords = attributes.has("TEXCOORD_0") && resolveAccessor(root, buffers, attributes["TEXCOORD_0"].getInt(), texCoord) &&
+			texCoord.count == position.count && texCoord.components >= 2;
+		bool hasNormals = attributes.has("NORMAL") && resolveAccessor(root, buffers, attributes["NORMAL"].getInt(), normal) &&
+			normal.count == position.count && normal.components >= 3;
+
+		ImportedMesh mesh;
+		mesh.name = name;
+		size_t vertexCount = position.count;
+		mesh.vertices.assign(vertexCount * 8, 0.f);
+
+		pool->parallelFor(vertexCount, 16384, [&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++)
+			{
+				GLfloat* vertex = &mesh.vertices[v * 8];
+				for (int c = 0; c < 3; c++)
+				{
+					vertex[c] = readComponent(position, v, c);
+				}
+				if (hasTexCoords)
+				{
+					vertex[3] = readComponent(texCoord, v, 0);
+					vertex[4] = readComponent(texCoord, v, 1);
+				}
+				if (hasNormals)
+				{
+					for (int c = 0; c < 3; c++)
+					{
+						vertex[5 + c] = readComponent(normal, v, c);
+					}
+				}
+			}
+		});
+
+		if (primitive.has("indices"))
+		{
+			if (!resolveAccessor(root, buffers, primitive["indices"].getInt(), indexView) || indexView.components != 1)
+			{
+				printf("ERROR::MeshImporter::importGltf %s has an unusable indices accessor\n", name.c_str());
+				return false;
+			}
+
+			std::atomic<bool> outOfRange(false);
+			mesh.indices.resize(indexView.count - indexView.count % 3);
+			pool->parallelFor(mesh.indices.size(), 65536, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					mesh.indices[i] = readIndex(indexView, i);
+					if (mesh.indices[i] >= vertexCount)
+					{
+						outOfRange = true;
+						mesh.indices[i] = 0;
+					}
+				}
+			});
+
+			if (outOfRange)
+			{
+				printf("ERROR::MeshImporter::importGltf %s has indices out of range\n", name.c_str());
+			}
+		}
+		else
+		{
+			mesh.indices.resize(vertexCount - vertexCount % 3);
+			for (size_t i = 0; i < mesh.indices.size(); i++)
+			{
+				mesh.indices[i] = (unsigned int)i;
+			}
+		}
+
+		if (!hasNormals)
+		{
+			MeshNormals::calcAverageNormals(mesh.indices.data(), (unsigned int)mesh.indices.size(), mesh.vertices.data(),
+				(unsigned int)mesh.vertices.size(), 8, 5, NormalWeighting::Uniform, pool);
+		}
+
+		stats.meshCount++;
+		stats.vertexCount += mesh.getVertexCount();
+		stats.triangleCount += (unsigned int)(mesh.indices.size() / 3);
+		onMesh(mesh);
+		return true;
+	}
+
+	bool hasExtension(const char* fileLocation, const char* extension)
+	{
+		size_t length = strlen(fileLocation);
+		size_t extensionLength = strlen(extension);
+		if (length < extensionLength)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < extensionLength; i++)
+		{
+			if (tolower((unsigned char)fileLocation[length - extensionLength + i]) != extension[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+bool MeshImporter::importFile(const char* fileLocation, const MeshCallback& onMesh, ImportStats* stats, ThreadPool* pool)
+{
+	if (hasExtension(fileLocation, ".obj"))
+	{
+		return importObj(fileLocation, onMesh, stats, pool);
+	}
+	if (hasExtension(fileLocation, ".gltf") || hasExtension(fileLocation, ".glb"))
+	{
+		return importGltf(fileLocation, onMesh, stats, pool);
+	}
+
+	printf("ERROR::MeshImporter::importFile unsupported file type: %s\n", fileLocation);
+	return false;
+}
+
+bool MeshImporter::importObj(const char* fileLocation, const MeshCallback& onMesh, ImportStats* stats, ThreadPool* pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	FILE* file = fopen(fileLocation, "rb");
+	if (!file)
+	{
+		printf("ERROR::MeshImporter::importObj failed to open %s\n", fileLocation);
+		return false;
+	}
+
+	ImportStats result = {};
+	ObjState state;
+	state.objectName = "default";
+	state.objectHasNormals = false;
+	state.badLines = 0;
+	state.badIndices = 0;
+
+	std::unique_ptr<char[]> buffer(new char[streamBlockSize]);
+	std::vector<ObjChunk> chunks(pool->getParallelThreadCount() + 1);
+	size_t carried = 0;
+	bool atEnd = false;
+	bool failed = false;
+
+	while (!atEnd)
+	{
+		size_t readBytes = fread(buffer.get() + carried, 1, streamBlockSize - carried, file);
+		size_t available = carried + readBytes;
+		result.bytes += readBytes;
+		atEnd = available < streamBlockSize;
+
+		size_t blockEnd = available;
+		if (!atEnd)
+		{
+			while (blockEnd > 0 && buffer[blockEnd - 1] != '\n')
+			{
+				blockEnd--;
+			}
+			if (blockEnd == 0)
+			{
+				printf("ERROR::MeshImporter::importObj %s has a line longer than %zu bytes\n", fileLocation, streamBlockSize);
+				failed = true;
+				break;
+			}
+		}
+
+		// Split the block on line boundaries, one slice per thread, and tokenise the slices in parallel.
+		size_t chunkCount = std::min(chunks.size(), std::max((size_t)1, blockEnd / (256 * 1024)));
+		std::vector<size_t> bounds(chunkCount + 1, blockEnd);
+		bounds[0] = 0;
+		for (size_t c = 1; c < chunkCount; c++)
+		{
+			size_t split = std::max(bounds[c - 1], blockEnd * c / chunkCount);
+			while (split < blockEnd && buffer[split - 1] != '\n')
+			{
+				split++;
+			}
+			bounds[c] = split;
+		}
+
+		pool->parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; c++)
+			{
+				parseObjChunk(buffer.get() + bounds[c], buffer.get() + bounds[c + 1], chunks[c]);
+			}
+		});
+
+		for (size_t c = 0; c < chunkCount; c++)
+		{
+			mergeChunk(chunks[c], state, onMesh, result, pool);
+		}
+
+		carried = available - blockEnd;
+		memmove(buffer.get(), buffer.get() + blockEnd, carried);
+	}
+
+	if (ferror(file))
+	{
+		printf("ERROR::MeshImporter::importObj failed reading %s\n", fileLocation);
+		failed = true;
+	}
+	fclose(file);
+
+	if (!failed)
+	{
+		emitObject(state, onMesh, result, pool);
+	}
+
+	if (state.badLines > 0 || state.badIndices > 0)
+	{
+		printf("MeshImporter: %s had %u malformed lines and %u out of range indices\n", fileLocation, state.badLines, state.badIndices);
+	}
+
+	result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	if (stats)
+	{
+		*stats = result;
+	}
+	return !failed;
+}
+
+bool MeshImporter::importGltf(const char* fileLocation, const MeshCallback& onMesh, ImportStats* stats, ThreadPool* pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	MappedFile file;
+	if (!file.open(fileLocation))
+	{
+		printf("ERROR::MeshImporter::importGltf failed to open %s\n", fileLocation);
+		return false;
+	}
+
+	ImportStats result = {};
+	result.bytes = file.getSize();
+
+	const unsigned char* json = file.getData();
+	size_t jsonLength = file.getSize();
+	BufferData glbBinary = { nullptr, 0 };
+
+	GLuint header[3] = {};
+	if (file.getSize() >= sizeof(header))
+	{
+		memcpy(header, file.getData(), sizeof(header));
+	}
+
+	if (header[0] == 0x46546c67)
+	{
+		GLuint chunkHeader[2] = {};
+		if (header[1] != 2 || header[2] > file.getSize() || header[2] < 20)
+		{
+			printf("ERROR::MeshImporter::importGltf %s is not a valid glTF 2.0 binary\n", fileLocation);
+			return false;
+		}
+
+		size_t offset = 12;
+		memcpy(chunkHeader, file.getData() + offset, sizeof(chunkHeader));
+		if (chunkHeader[1] != 0x4e4f534a || chunkHeader[0] > header[2] - offset - 8)
+		{
+			printf("ERROR::MeshImporter::importGltf %s does not start with a JSON chunk\n", fileLocation);
+			return false;
+		}
+		json = file.getData() + offset + 8;
+		jsonLength = chunkHeader[0];
+		offset += 8 + ((chunkHeader[0] + 3) & ~3u);
+
+		if (offset + 8 <= header[2])
+		{
+			memcpy(chunkHeader, file.getData() + offset, sizeof(chunkHeader));
+			if (chunkHeader[1] == 0x004e4942 && chunkHeader[0] <= header[2] - offset - 8)
+			{
+				glbBinary.data = file.getData() + offset + 8;
+				glbBinary.size = chunkHeader[0];
+			}
+		}
+	}
+
+	JsonValue root;
+	if (!JsonValue::parse((const char*)json, jsonLength, root))
+	{
+		printf("ERROR::MeshImporter::importGltf failed to parse %s\n", fileLocation);
+		return false;
+	}
+
+	std::string directory(fileLocation);
+	size_t slash = directory.find_last_of("/\\");
+	directory = slash == std::string::npos ? std::string() : directory.substr(0, slash + 1);
+
+	const JsonValue& bufferList = root["buffers"];
+	std::vector<BufferData> buffers(bufferList.size(), BufferData{ nullptr, 0 });
+	std::vector<std::unique_ptr<MappedFile>> bufferFiles;
+	std::vector<std::vector<unsigned char>> decodedBuffers(bufferList.size());
+
+	for (size_t b = 0; b < bufferList.size(); b++)
+	{
+		const std::string& uri = bufferList[b]["uri"].getString();
+		size_t byteLength = (size_t)bufferList[b]["byteLength"].getNumber();
+
+		if (uri.empty())
+		{
+			buffers[b] = glbBinary;
+		}
+		else if (uri.compare(0, 5, "data:") == 0)
+		{
+			size_t comma = uri.find(',');
+			if (comma != std::string::npos && comma >= 12 && uri.compare(comma - 7, 7, ";base64") == 0 &&
+				decodeBase64(uri.c_str() + comma + 1, uri.size() - comma - 1, decodedBuffers[b]))
+			{
+				buffers[b] = { decodedBuffers[b].data(), decodedBuffers[b].size() };
+			}
+		}
+		else
+		{
+			bufferFiles.push_back(std::make_unique<MappedFile>());
+			if (bufferFiles.back()->open((directory + uri).c_str()))
+			{
+				buffers[b] = { bufferFiles.back()->getData(), bufferFiles.back()->getSize() };
+				result.bytes += buffers[b].size;
+			}
+		}
+
+		if (!buffers[b].data || buffers[b].size < byteLength)
+		{
+			printf("ERROR::MeshImporter::importGltf buffer %zu of %s is missing or too short\n", b, fileLocation);
+			buffers[b] = { nullptr, 0 };
+		}
+	}
+
+	bool succeeded = true;
+	const JsonValue& meshes = root["meshes"];
+	for (size_t m = 0; m < meshes.size(); m++)
+	{
+		const JsonValue& primitives = meshes[m]["primitives"];
+		std::string meshName = meshes[m].has("name") ? meshes[m]["name"].getString() : "mesh" + std::to_string(m);
+
+		for (size_t p = 0; p < primitives.size(); p++)
+		{
+			std::string name = primitives.size() > 1 ? meshName + "_" + std::to_string(p) : meshName;
+			succeeded &= importPrimitive(root, buffers, primitives[p], name, onMesh, result, pool);
+		}
+	}
+
+	result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	if (stats)
+	{
+		*stats = result;
+	}
+	return succeeded;
+}
+
+void MeshImporter::printStats(const char* name, const ImportStats& stats)
+{
+	printf("MeshImporter %s: %u meshes, %u vertices, %u triangles, %.1f MB in %.2f ms (%.1f MB/s)\n",
+		name, stats.meshCount, stats.vertexCount, stats.triangleCount, stats.bytes / (1024.0 * 1024.0),
+		stats.milliseconds, stats.getMegabytesPerSecond());
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "ThreadPool.h"
+
+// One mesh per OBJ object/group or glTF primitive, in StandardVertexLayout (8 floats per vertex).
+struct ImportedMesh
+{
+	std::string name;
+	std::vector<GLfloat> vertices;
+	std::vector<unsigned int> indices;
+
+	unsigned int getVertexCount() const { return (unsigned int)(vertices.size() / 8); }
+};
+
+struct ImportStats
+{
+	size_t bytes;
+	unsigned int meshCount;
+	unsigned int vertexCount;
+	unsigned int triangleCount;
+	double milliseconds;
+
+	double getMegabytesPerSecond() const { return milliseconds > 0.0 ? bytes / (1024.0 * 1024.0) / (milliseconds / 1000.0) : 0.0; }
+};
+
+namespace MeshImporter
+{
+	// OBJ is read in blocks of this size, so the text never has to fit in memory at once.
+	const size_t streamBlockSize = 8 * 1024 * 1024;
+
+	// Called on the importing thread as soon as each mesh is complete. The mesh may be moved from.
+	typedef std::function<void(ImportedMesh& mesh)> MeshCallback;
+
+	// Picks the importer from the extension: .obj, .gltf or .glb.
+	bool importFile(const char* fileLocation, const MeshCallback& onMesh, ImportStats* stats = nullptr, ThreadPool* pool = nullptr);
+
+	bool importObj(const char* fileLocation, const MeshCallback& onMesh, ImportStats* stats = nullptr, ThreadPool* pool = nullptr);
+	bool importGltf(const char* fileLocation, const MeshCallback& onMesh, ImportStats* stats = nullptr, ThreadPool* pool = nullptr);
+
+	void printStats(const char* name, const ImportStats& stats);
+}
@@ -0,0 +1,366 @@
+#include "MeshNormals.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <glm\glm.hpp>
+
+#include "SimdSupport.h"
+
+namespace
+{
+	struct FaceNormals
+	{
+		std::unique_ptr<GLfloat[]> x;
+		std::unique_ptr<GLfloat[]> y;
+		std::unique_ptr<GLfloat[]> z;
+	};
+
+	void faceNormalsScalar(const unsigned int* indices, const GLfloat* vertices, unsigned int vLength, bool normalise,
+		size_t begin, size_t end, FaceNormals& faces)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			const GLfloat* p0 = vertices + (size_t)indices[t * 3] * vLength;
+			const GLfloat* p1 = vertices + (size_t)indices[t * 3 + 1] * vLength;
+			const GLfloat* p2 = vertices + (size_t)indices[t * 3 + 2] * vLength;
+
+			glm::vec3 normal = glm::cross(
+				glm::vec3(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]),
+				glm::vec3(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]));
+
+			if (normalise)
+			{
+				GLfloat length = glm::length(normal);
+				normal = length > 0.f ? normal / length : glm::vec3(0.f, 0.f, 0.f);
+			}
+
+			faces.x[t] = normal.x;
+			faces.y[t] = normal.y;
+			faces.z[t] = normal.z;
+		}
+	}
+
+#if SIMD_X86
+	void faceNormalsSSE(const unsigned int* indices, const GLfloat* vertices, unsigned int vLength, bool normalise,
+		size_t begin, size_t end, FaceNormals& faces)
+	{
+		size_t t = begin;
+		for (; t + 4 <= end; t += 4)
+		{
+			__m128 px[3];
+			__m128 py[3];
+			__m128 pz[3];
+
+			for (int k = 0; k < 3; k++)
+			{
+				const GLfloat* a = vertices + (size_t)indices[t * 3 + k] * vLength;
+				const GLfloat* b = vertices + (size_t)indices[t * 3 + 3 + k] * vLength;
+				const GLfloat* c = vertices + (size_t)indices[t * 3 + 6 + k] * vLength;
+				const GLfloat* d = vertices + (size_t)indices[t * 3 + 9 + k] * vLength;
+				px[k] = _mm_set_ps(d[0], c[0], b[0], a[0]);
+				py[k] = _mm_set_ps(d[1], c[1], b[1], a[1]);
+				pz[k] = _mm_set_ps(d[2], c[2], b[2], a[2]);
+			}
+
+			__m128 e1x = _mm_sub_ps(px[1], px[0]);
+			__m128 e1y = _mm_sub_ps(py[1], py[0]);
+			__m128 e1z = _mm_sub_ps(pz[1], pz[0]);
+			__m128 e2x = _mm_sub_ps(px[2], px[0]);
+			__m128 e2y = _mm_sub_ps(py[2], py[0]);
+			__m128 e2z = _mm_sub_ps(pz[2], pz[0]);
+
+			__m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+			__m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+			__m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+
+			if (normalise)
+			{
+				__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+				__m128 length = _mm_sqrt_ps(lengthSq);
+				__m128 valid = _mm_cmpgt_ps(length, _mm_setzero_ps());
+				__m128 inverse = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.f), length), valid);
+				nx = _mm_mul_ps(nx, inverse);
+				ny = _mm_mul_ps(ny, inverse);
+				nz = _mm_mul_ps(nz, inverse);
+			}
+
+			_mm_storeu_ps(&faces.x[t], nx);
+			_mm_storeu_ps(&faces.y[t], ny);
+			_mm_storeu_ps(&faces.z[t], nz);
+		}
+
+		faceNormalsScalar(indices, vertices, vLength, normalise, t, end, faces);
+	}
+
+	SIMD_TARGET_AVX2
+	void faceNormalsAVX2(const unsigned int* indices, const GLfloat* vertices, unsigned int vLength, bool normalise,
+		size_t begin, size_t end, FaceNormals& faces)
+	{
+		const __m256i cornerStride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+		const __m256i vertexStride = _mm256_set1_epi32((int)vLength);
+
+		size_t t = begin;
+		for (; t + 8 <= end; t += 8)
+		{
+			__m256 px[3];
+			__m256 py[3];
+			__m256 pz[3];
+
+			for (int k = 0; k < 3; k++)
+			{
+				__m256i corner = _mm256_i32gather_epi32((const int*)(indices + t * 3 + k), cornerStride, 4);
+				__m256i offset = _mm256_mullo_epi32(corner, vertexStride);
+				px[k] = _mm256_i32gather_ps(vertices, offset, 4);
+				py[k] = _mm256_i32gather_ps(vertices + 1, offset, 4);
+				pz[k] = _mm256_i32gather_ps(vertices + 2, offset, 4);
+			}
+
+			__m256 e1x = _mm256_sub_ps(px[1], px[0]);
+			__m256 e1y = _mm256_sub_ps(py[1], py[0]);
+			__m256 e1z = _mm256_sub_ps(pz[1], pz[0]);
+			__m256 e2x = _mm256_sub_ps(px[2], px[0]);
+			__m256 e2y = _mm256_sub_ps(py[2], py[0]);
+			__m256 e2z = _mm256_sub_ps(pz[2], pz[0]);
+
+			__m256 nx = _mm256_fmsub_ps(e1y, e2z, _mm256_mul_ps(e1z, e2y));
+			__m256 ny = _mm256_fmsub_ps(e1z, e2x, _mm256_mul_ps(e1x, e2z));
+			__m256 nz = _mm256_fmsub_ps(e1x, e2y, _mm256_mul_ps(e1y, e2x));
+
+			if (normalise)
+			{
+				__m256 lengthSq = _mm256_fmadd_ps(nz, nz, _mm256_fmadd_ps(ny, ny, _mm256_mul_ps(nx, nx)));
+				__m256 length = _mm256_sqrt_ps(lengthSq);
+				__m256 valid = _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ);
+				__m256 inverse = _mm256_and_ps(_mm256_div_ps(_mm256_set1_ps(1.f), length), valid);
+				nx = _mm256_mul_ps(nx, inverse);
+				ny = _mm256_mul_ps(ny, inverse);
+				nz = _mm256_mul_ps(nz, inverse);
+			}
+
+			_mm256_storeu_ps(&faces.x[t], nx);
+			_mm256_storeu_ps(&faces.y[t], ny);
+			_mm256_storeu_ps(&faces.z[t], nz);
+		}
+
+		faceNormalsSSE(indices, vertices, vLength, normalise, t, end, faces);
+	}
+#endif
+
+	void cornerAngles(const unsigned int* indices, const GLfloat* vertices, unsigned int vLength,
+		size_t begin, size_t end, std::vector<GLfloat>& angles)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			glm::vec3 p[3];
+			for (int k = 0; k < 3; k++)
+			{
+				const GLfloat* v = vertices + (size_t)indices[t * 3 + k] * vLength;
+				p[k] = glm::vec3(v[0], v[1], v[2]);
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				glm::vec3 e1 = p[(k + 1) % 3] - p[k];
+				glm::vec3 e2 = p[(k + 2) % 3] - p[k];
+				GLfloat lengths = glm::length(e1) * glm::length(e2);
+				GLfloat cosine = lengths > 0.f ? glm::dot(e1, e2) / lengths : 1.f;
+				angles[t * 3 + k] = acosf(glm::clamp(cosine, -1.f, 1.f));
+			}
+		}
+	}
+}
+
+void MeshNormals::calcAverageNormalsReference(const unsigned int* indices, unsigned int indiceCount, GLfloat* vertices, unsigned int verticeCount, unsigned int vLength, unsigned int normalOffset)
+{
+	for (size_t i = 0; i < indiceCount; i += 3)
+	{
+		unsigned int in0 = indices[i] * vLength;
+		unsigned int in1 = indices[i + 1] * vLength;
+		unsigned int in2 = indices[i + 2] * vLength;
+
+		glm::vec3 v1(vertices[in1] - vertices[in0], vertices[in1 + 1] - vertices[in0 + 1], vertices[in1 + 2] - vertices[in0 + 2]);
+		glm::vec3 v2(vertices[in2] - vertices[in0], vertices[in2 + 1] - vertices[in0 + 1], vertices[in2 + 2] - vertices[in0 + 2]);
+		glm::vec3 normal = glm::cross(v1, v2);
+		normal = glm::normalize(normal);
+
+		in0 += normalOffset;
+		in1 += normalOffset;
+		in2 += normalOffset;
+
+		vertices[in0] += normal.x; vertices[in0 + 1] += normal.y; vertices[in0 + 2] += normal.z;
+		vertices[in1] += normal.x; vertices[in1 + 1] += normal.y; vertices[in1 + 2] += normal.z;
+		vertices[in2] += normal.x; vertices[in2 + 1] += normal.y; vertices[in2 + 2] += normal.z;
+	}
+
+	for (size_t i = 0; i < verticeCount / vLength; i++)
+	{
+		unsigned int nOffset = i * vLength + normalOffset;
+		glm::vec3 vec(vertices[nOffset], vertices[nOffset + 1], vertices[nOffset + 2]);
+		vec = glm::normalize(vec);
+
+		vertices[nOffset] = vec.x;
+		vertices[nOffset + 1] = vec.y;
+		vertices[nOffset + 2] = vec.z;
+	}
+}
+
+void MeshNormals::buildAdjacency(const unsigned int* indices, unsigned int indiceCount, unsigned int vertexCount, VertexAdjacency& adjacency, ThreadPool* pool)
+{
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	size_t cornerCount = indiceCount / 3 * 3;
+	adjacency.offsets.assign((size_t)vertexCount + 1, 0);
+	adjacency.corners.resize(cornerCount);
+
+	// Parallel counting sort: every chunk of corners gets a private histogram, so each chunk
+	// knows exactly where its corners go and no two threads ever write the same slot.
+	// Histograms cost chunks * vertexCount * 4 bytes, so very large meshes use fewer chunks.
+	size_t maxHistogramBytes = (size_t)256 * 1024 * 1024;
+	size_t chunkCount = std::min((size_t)pool->getParallelThreadCount() + 1, maxHistogramBytes / ((size_t)vertexCount * sizeof(unsigned int) + 1));
+	chunkCount = std::max(std::min(chunkCount, cornerCount / 65536), (size_t)1);
+	size_t chunkSize = (cornerCount + chunkCount - 1) / chunkCount;
+
+	std::vector<std::vector<unsigned int>> histograms(chunkCount);
+
+	pool->parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			std::vector<unsigned int>& histogram = histograms[chunk];
+			histogram.assign(vertexCount, 0);
+			size_t last = std::min(cornerCount, (chunk + 1) * chunkSize);
+			for (size_t i = chunk * chunkSize; i < last; i++)
+			{
+				histogram[indices[i]]++;
+			}
+		}
+	});
+
+	unsigned int running = 0;
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		adjacency.offsets[v] = running;
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			unsigned int count = histograms[chunk][v];
+			histograms[chunk][v] = running;
+			running += count;
+		}
+	}
+	adjacency.offsets[vertexCount] = running;
+
+	pool->parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			std::vector<unsigned int>& cursor = histograms[chunk];
+			size_t last = std::min(cornerCount, (chunk + 1) * chunkSize);
+			for (size_t i = chunk * chunkSize; i < last; i++)
+			{
+				adjacency.corners[cursor[indices[i]]++] = (unsigned int)i;
+			}
+		}
+	});
+}
+
+void MeshNormals::calcAverageNormals(const unsigned int* indices, unsigned int indiceCount, GLfloat* vertices, unsigned int verticeCount,
+	unsigned int vLength, unsigned int normalOffset, NormalWeighting weighting, ThreadPool* pool)
+{
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	size_t vertexCount = verticeCount / vLength;
+	size_t triangleCount = indiceCount / 3;
+
+	// On one thread the adjacency and gather are only extra work, so the plain scatter is faster.
+	if (weighting == NormalWeighting::Uniform && pool->getParallelThreadCount() == 0)
+	{
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			GLfloat* normal = vertices + v * vLength + normalOffset;
+			normal[0] = 0.f;
+			normal[1] = 0.f;
+			normal[2] = 0.f;
+		}
+
+		calcAverageNormalsReference(indices, indiceCount, vertices, verticeCount, vLength, normalOffset);
+		return;
+	}
+
+	VertexAdjacency adjacency;
+	buildAdjacency(indices, indiceCount, (unsigned int)vertexCount, adjacency, pool);
+	const std::vector<unsigned int>& offsets = adjacency.offsets;
+	const std::vector<unsigned int>& corners = adjacency.corners;
+
+	FaceNormals faces;
+	faces.x.reset(new GLfloat[triangleCount]);
+	faces.y.reset(new GLfloat[triangleCount]);
+	faces.z.reset(new GLfloat[triangleCount]);
+
+	std::vector<GLfloat> angles;
+	if (weighting == NormalWeighting::Angle)
+	{
+		angles.resize(triangleCount * 3);
+	}
+
+	bool normalise = weighting != NormalWeighting::Area;
+	bool useAVX2 = SimdSupport::hasAVX2();
+
+	pool->parallelFor(triangleCount, 4096, [&](size_t begin, size_t end)
+	{
+#if SIMD_X86
+		if (useAVX2)
+		{
+			faceNormalsAVX2(indices, vertices, vLength, normalise, begin, end, faces);
+		}
+		else
+		{
+			faceNormalsSSE(indices, vertices, vLength, normalise, begin, end, faces);
+		}
+#else
+		faceNormalsScalar(indices, vertices, vLength, normalise, begin, end, faces);
+#endif
+
+		if (weighting == NormalWeighting::Angle)
+		{
+			cornerAngles(indices, vertices, vLength, begin, end, angles);
+		}
+	});
+
+	pool->parallelFor(vertexCount, 4096, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+		{
+			GLfloat nx = 0.f;
+			GLfloat ny = 0.f;
+			GLfloat nz = 0.f;
+
+			for (unsigned int c = offsets[v]; c < offsets[v + 1]; c++)
+			{
+				unsigned int corner = corners[c];
+				unsigned int triangle = corner / 3;
+				GLfloat weight = weighting == NormalWeighting::Angle ? angles[corner] : 1.f;
+
+				nx += faces.x[triangle] * weight;
+				ny += faces.y[triangle] * weight;
+				nz += faces.z[triangle] * weight;
+			}
+
+			GLfloat length = sqrtf(nx * nx + ny * ny + nz * nz);
+			GLfloat inverse = length > 0.f ? 1.f / length : 0.f;
+
+			GLfloat* normal = vertices + v * vLength + normalOffset;
+			normal[0] = nx * inverse;
+			normal[1] = ny * inverse;
+			normal[2] = nz * inverse;
+		}
+	});
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "ThreadPool.h"
+
+enum class NormalWeighting
+{
+	Uniform,
+	Area,
+	Angle
+};
+
+// Corners (index buffer positions) grouped by vertex: corners[offsets[v] .. offsets[v + 1]).
+struct VertexAdjacency
+{
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> corners;
+};
+
+namespace MeshNormals
+{
+	void buildAdjacency(const unsigned int* indices, unsigned int indiceCount, unsigned int vertexCount, VertexAdjacency& adjacency,
+		ThreadPool* pool = nullptr);
+
+	// The original single threaded scatter version, kept for comparison. verticeCount is in floats.
+	void calcAverageNormalsReference(const unsigned int* indices, unsigned int indiceCount, GLfloat* vertices, unsigned int verticeCount,
+		unsigned int vLength, unsigned int normalOffset);
+
+	// Builds a vertex to triangle adjacency, computes face normals with SIMD and gathers them per vertex
+	// across the thread pool, so no two threads ever write the same vertex. verticeCount is in floats.
+	// Uniform weighting uses the reference instead when the pool has no parallel threads.
+	void calcAverageNormals(const unsigned int* indices, unsigned int indiceCount, GLfloat* vertices, unsigned int verticeCount,
+		unsigned int vLength, unsigned int normalOffset, NormalWeighting weighting = NormalWeighting::Uniform, ThreadPool* pool = nullptr);
+}
@@ -0,0 +1,367 @@
+#include "MeshOptimizer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include <glm\glm.hpp>
+
+namespace
+{
+	struct TriangleAdjacency
+	{
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> triangles;
+	};
+
+	void buildAdjacency(const unsigned int* indices, unsigned int numOfIndices, unsigned int vertexCount, TriangleAdjacency& adjacency)
+	{
+		adjacency.offsets.assign(vertexCount + 1, 0);
+		adjacency.triangles.resize(numOfIndices);
+
+		for (unsigned int i = 0; i < numOfIndices; i++)
+		{
+			adjacency.offsets[indices[i] + 1]++;
+		}
+		for (unsigned int v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v + 1] += adjacency.offsets[v];
+		}
+
+		std::vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		for (unsigned int i = 0; i < numOfIndices; i++)
+		{
+			adjacency.triangles[fill[indices[i]]++] = i / 3;
+		}
+	}
+
+	int skipDeadEnd(std::vector<unsigned int>& deadEnds, const std::vector<unsigned int>& liveTriangles, unsigned int& cursor, unsigned int vertexCount)
+	{
+		while (!deadEnds.empty())
+		{
+			unsigned int vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[vertex] > 0)
+			{
+				return (int)vertex;
+			}
+		}
+
+		while (cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+			{
+				return (int)cursor;
+			}
+			cursor++;
+		}
+
+		return -1;
+	}
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const unsigned int* indices, unsigned int numOfIndices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = { 0.f, 0.f };
+	if (numOfIndices == 0)
+	{
+		return stats;
+	}
+
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	unsigned int time = cacheSize + 1;
+	unsigned int misses = 0;
+	unsigned int uniqueVertices = 0;
+
+	for (unsigned int i = 0; i < numOfIndices; i++)
+	{
+		unsigned int vertex = indices[i];
+		if (time - timestamps[vertex] > cacheSize)
+		{
+			timestamps[vertex] = time++;
+			misses++;
+		}
+		if (!referenced[vertex])
+		{
+			referenced[vertex] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.acmr = (GLfloat)misses / (GLfloat)(numOfIndices / 3);
+	stats.atvr = (GLfloat)misses / (GLfloat)uniqueVertices;
+	return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(unsigned int* indices, unsigned int numOfIndices, unsigned int vertexCount, unsigned int cacheSize, std::vector<unsigned int>* clusters)
+{
+	unsigned int triangleCount = numOfIndices / 3;
+	if (clusters)
+	{
+		clusters->clear();
+	}
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	TriangleAdjacency adjacency;
+	buildAdjacency(indices, numOfIndices, vertexCount, adjacency);
+
+	std::vector<unsigned int> liveTriangles(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	}
+
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnds;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(numOfIndices);
+
+	unsigned int time = cacheSize + 1;
+	unsigned int cursor = 0;
+	int fanning = skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount);
+
+	if (clusters)
+	{
+		clusters->push_back(0);
+	}
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+
+		for (unsigned int a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++)
+		{
+			unsigned int triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				unsigned int vertex = indices[triangle * 3 + k];
+				output.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+
+				if (time - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = time++;
+				}
+			}
+
+			emitted[triangle] = true;
+		}
+
+		int next = -1;
+		int bestPriority = -1;
+		for (unsigned int vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+			{
+				continue;
+			}
+
+			int priority = 0;
+			if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+			{
+				priority = (int)(time - cacheTime[vertex]);
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = (int)vertex;
+			}
+		}
+
+		if (next == -1)
+		{
+			next = skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount);
+			if (next >= 0 && clusters && output.size() / 3 < triangleCount)
+			{
+				clusters->push_back((unsigned int)(output.size() / 3));
+			}
+		}
+
+		fanning = next;
+	}
+
+	memcpy(indices, output.data(), output.size() * sizeof(unsigned int));
+}
+
+void MeshOptimizer::optimizeOverdraw(unsigned int* indices, unsigned int numOfIndices, const GLfloat* vertices, unsigned int vertexCount,
+	unsigned int vertexStride, const std::vector<unsigned int>& hardClusters, GLfloat threshold, unsigned int cacheSize)
+{
+	unsigned int triangleCount = numOfIndices / 3;
+	if (triangleCount == 0 || hardClusters.empty())
+	{
+		return;
+	}
+
+	auto position = [&](unsigned int vertex)
+	{
+		const GLfloat* p = (const GLfloat*)((const unsigned char*)vertices + (size_t)vertex * vertexStride);
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	// Split hard clusters further wherever the running ACMR drops back under the threshold,
+	// so the sort has more freedom without giving up much vertex cache efficiency.
+	GLfloat targetAcmr = analyzeVertexCache(indices, numOfIndices, vertexCount, cacheSize).acmr * threshold;
+
+	std::vector<unsigned int> clusters;
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+
+	for (size_t c = 0; c < hardClusters.size(); c++)
+	{
+		unsigned int start = hardClusters[c];
+		unsigned int end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCount;
+		unsigned int clusterStart = start;
+		unsigned int misses = 0;
+
+		clusters.push_back(start);
+		time += cacheSize + 1;
+
+		for (unsigned int t = start; t < end; t++)
+		{
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				unsigned int vertex = indices[t * 3 + k];
+				if (time - timestamps[vertex] > cacheSize)
+				{
+					timestamps[vertex] = time++;
+					misses++;
+				}
+			}
+
+			unsigned int clusterTriangles = t - clusterStart + 1;
+			if (t + 1 < end && clusterTriangles >= 8 && (GLfloat)misses / clusterTriangles <= targetAcmr)
+			{
+				clusters.push_back(t + 1);
+				clusterStart = t + 1;
+				misses = 0;
+				time += cacheSize + 1;
+			}
+		}
+	}
+
+	glm::vec3 meshCentre(0.f, 0.f, 0.f);
+	GLfloat meshArea = 0.f;
+
+	std::vector<GLfloat> sortKeys(clusters.size());
+	std::vector<glm::vec3> clusterCentres(clusters.size());
+	std::vector<glm::vec3> clusterNormals(clusters.size());
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		unsigned int start = clusters[c];
+		unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		glm::vec3 centre(0.f, 0.f, 0.f);
+		glm::vec3 normal(0.f, 0.f, 0.f);
+		GLfloat area = 0.f;
+
+		for (unsigned int t = start; t < end; t++)
+		{
+			glm::vec3 p0 = position(indices[t * 3]);
+			glm::vec3 p1 = position(indices[t * 3 + 1]);
+			glm::vec3 p2 = position(indices[t * 3 + 2]);
+
+			glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+			GLfloat faceArea = glm::length(faceNormal);
+
+			centre += (p0 + p1 + p2) * (faceArea / 3.f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+
+		meshCentre += centre;
+		meshArea += area;
+
+		clusterCentres[c] = area > 0.f ? centre / area : position(indices[start * 3]);
+		GLfloat normalLength = glm::length(normal);
+		clusterNormals[c] = normalLength > 0.f ? normal / normalLength : normal;
+	}
+
+	meshCentre = meshArea > 0.f ? meshCentre / meshArea : meshCentre;
+
+	std::vector<unsigned int> order(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		sortKeys[c] = glm::dot(clusterCentres[c] - meshCentre, clusterNormals[c]);
+		order[c] = (unsigned int)c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+	{
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<unsigned int> output;
+	output.reserve(numOfIndices);
+	for (unsigned int c : order)
+	{
+		unsigned int start = clusters[c];
+		unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		output.insert(output.end(), indices + start * 3, indices + end * 3);
+	}
+
+	memcpy(indices, output.data(), output.size() * sizeof(unsigned int));
+}
+
+unsigned int MeshOptimizer::optimizeVertexFetch(void* vertices, unsigned int vertexCount, unsigned int vertexStride, unsigned int* indices, unsigned int numOfIndices)
+{
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(vertexCount, unused);
+	std::vector<unsigned char> reordered((size_t)vertexCount * vertexStride);
+	unsigned char* source = (unsigned char*)vertices;
+	unsigned int nextVertex = 0;
+
+	for (unsigned int i = 0; i < numOfIndices; i++)
+	{
+		unsigned int vertex = indices[i];
+		if (remap[vertex] == unused)
+		{
+			memcpy(&reordered[(size_t)nextVertex * vertexStride], source + (size_t)vertex * vertexStride, vertexStride);
+			remap[vertex] = nextVertex++;
+		}
+		indices[i] = remap[vertex];
+	}
+
+	memcpy(vertices, reordered.data(), (size_t)nextVertex * vertexStride);
+	return nextVertex;
+}
+
+MeshOptimizerReport MeshOptimizer::optimizeMesh(GLfloat* vertices, unsigned int vertexCount, unsigned int vertexStride, unsigned int* indices, unsigned int numOfIndices)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	MeshOptimizerReport report;
+	report.vertexCountBefore = vertexCount;
+	report.before = analyzeVertexCache(indices, numOfIndices, vertexCount);
+
+	std::vector<unsigned int> clusters;
+	optimizeVertexCache(indices, numOfIndices, vertexCount, defaultCacheSize, &clusters);
+	optimizeOverdraw(indices, numOfIndices, vertices, vertexCount, vertexStride, clusters);
+	report.vertexCountAfter = optimizeVertexFetch(vertices, vertexCount, vertexStride, indices, numOfIndices);
+
+	report.after = analyzeVertexCache(indices, numOfIndices, report.vertexCountAfter);
+	report.clusterCount = (unsigned int)clusters.size();
+	report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return report;
+}
+
+void MeshOptimizer::printReport(const char* name, const MeshOptimizerReport& report)
+{
+	printf("MeshOptimizer %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u clusters, %u -> %u vertices, %.2f ms\n",
+		name, report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr,
+		report.clusterCount, report.vertexCountBefore, report.vertexCountAfter, report.milliseconds);
+}
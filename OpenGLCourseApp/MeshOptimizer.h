@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+struct VertexCacheStats
+{
+	GLfloat acmr;
+	GLfloat atvr;
+};
+
+struct MeshOptimizerReport
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+	unsigned int clusterCount;
+	unsigned int vertexCountBefore;
+	unsigned int vertexCountAfter;
+	double milliseconds;
+};
+
+namespace MeshOptimizer
+{
+	const unsigned int defaultCacheSize = 16;
+
+	// ACMR is cache misses per triangle, ATVR is cache misses per referenced vertex (1.0 is ideal).
+	VertexCacheStats analyzeVertexCache(const unsigned int* indices, unsigned int numOfIndices, unsigned int vertexCount,
+		unsigned int cacheSize = defaultCacheSize);
+
+	// Tipsify (Sander et al. 2007). Writes the starting triangle of each cluster to clusters when given.
+	void optimizeVertexCache(unsigned int* indices, unsigned int numOfIndices, unsigned int vertexCount,
+		unsigned int cacheSize = defaultCacheSize, std::vector<unsigned int>* clusters = nullptr);
+
+	// Reorders whole clusters so outward facing ones are drawn first. Positions are 3 floats at
+	// the start of each vertex. threshold controls how much ACMR may grow to get smaller clusters.
+	void optimizeOverdraw(unsigned int* indices, unsigned int numOfIndices, const GLfloat* vertices, unsigned int vertexCount,
+		unsigned int vertexStride, const std::vector<unsigned int>& hardClusters, GLfloat threshold = 1.05f,
+		unsigned int cacheSize = defaultCacheSize);
+
+	// Moves vertices into first use order and drops unreferenced ones. Returns the new vertex count.
+	unsigned int optimizeVertexFetch(void* vertices, unsigned int vertexCount, unsigned int vertexStride,
+		unsigned int* indices, unsigned int numOfIndices);
+
+	// Runs all three passes. vertexStride is in bytes and positions must be 3 floats at offset 0.
+	MeshOptimizerReport optimizeMesh(GLfloat* vertices, unsigned int vertexCount, unsigned int vertexStride,
+		unsigned int* indices, unsigned int numOfIndices);
+
+	void printReport(const char* name, const MeshOptimizerReport& report);
+}
@@ -0,0 +1,422 @@
+#include "MeshSimplifier.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <glm\glm.hpp>
+
+#include "MeshNormals.h"
+#include "MeshOptimizer.h"
+#include "MeshWelder.h"
+
+namespace
+{
+	struct Quadric
+	{
+		double a00, a01, a02, a03;
+		double a11, a12, a13;
+		double a22, a23;
+		double a33;
+		double weight;
+	};
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double cost;
+	};
+
+	void addPlane(Quadric& q, const glm::dvec3& normal, double distance, double weight)
+	{
+		q.a00 += weight * normal.x * normal.x;
+		q.a01 += weight * normal.x * normal.y;
+		q.a02 += weight * normal.x * normal.z;
+		q.a03 += weight * normal.x * distance;
+		q.a11 += weight * normal.y * normal.y;
+		q.a12 += weight * normal.y * normal.z;
+		q.a13 += weight * normal.y * distance;
+		q.a22 += weight * normal.z * normal.z;
+		q.a23 += weight * normal.z * distance;
+		q.a33 += weight * distance * distance;
+		q.weight += weight;
+	}
+
+	void addQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a00 += other.a00;
+		q.a01 += other.a01;
+		q.a02 += other.a02;
+		q.a03 += other.a03;
+		q.a11 += other.a11;
+		q.a12 += other.a12;
+		q.a13 += other.a13;
+		q.a22 += other.a22;
+		q.a23 += other.a23;
+		q.a33 += other.a33;
+		q.weight += other.weight;
+	}
+
+	// Area weighted mean squared distance from p to the planes in a and b.
+	double collapseCost(const Quadric& a, const Quadric& b, const glm::vec3& p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double a00 = a.a00 + b.a00, a01 = a.a01 + b.a01, a02 = a.a02 + b.a02, a03 = a.a03 + b.a03;
+		double a11 = a.a11 + b.a11, a12 = a.a12 + b.a12, a13 = a.a13 + b.a13;
+		double a22 = a.a22 + b.a22, a23 = a.a23 + b.a23;
+		double a33 = a.a33 + b.a33;
+		double weight = a.weight + b.weight;
+
+		double error = x * x * a00 + y * y * a11 + z * z * a22 +
+			2.0 * (x * y * a01 + x * z * a02 + y * z * a12) +
+			2.0 * (x * a03 + y * a13 + z * a23) + a33;
+
+		return weight > 0.0 ? fabs(error) / weight : 0.0;
+	}
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const GLfloat* vertices, unsigned int vertexCount, unsigned int vertexStride,
+			const unsigned int* indices, unsigned int numOfIndices, ThreadPool* pool)
+			: vertexCount(vertexCount), current(indices, indices + numOfIndices), pool(pool)
+		{
+			positions.resize(vertexCount);
+			for (unsigned int v = 0; v < vertexCount; v++)
+			{
+				const GLfloat* position = (const GLfloat*)((const unsigned char*)vertices + (size_t)v * vertexStride);
+				positions[v] = glm::vec3(position[0], position[1], position[2]);
+			}
+
+			maxCost = 0.0;
+			lockVertices();
+			computeQuadrics();
+		}
+
+		const std::vector<unsigned int>& getIndices() { return current; }
+		GLfloat getError() { return (GLfloat)sqrt(maxCost); }
+
+		// Returns false once no further collapse is possible under maxError.
+		bool simplifyTo(size_t targetIndexCount, GLfloat maxError)
+		{
+			double maxErrorSquared = (double)maxError * maxError;
+
+			while (current.size() > targetIndexCount)
+			{
+				size_t collapseBudget = std::max((size_t)1, (current.size() - targetIndexCount) / 6);
+				if (!runPass(collapseBudget, maxErrorSquared))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		unsigned int vertexCount;
+		std::vector<unsigned int> current;
+		ThreadPool* pool;
+
+		std::vector<glm::vec3> positions;
+		std::vector<Quadric> quadrics;
+		std::vector<unsigned char> locked;
+		double maxCost;
+
+		VertexAdjacency adjacency;
+		std::vector<Collapse> candidates;
+		std::vector<unsigned char> touched;
+		std::vector<unsigned int> remap;
+
+		void lockVertices()
+		{
+			// Wedges sharing a position are UV or normal seams; moving one would tear the surface.
+			std::vector<GLfloat> positionStream((size_t)vertexCount * 3);
+			for (unsigned int v = 0; v < vertexCount; v++)
+			{
+				positionStream[(size_t)v * 3] = positions[v].x;
+				positionStream[(size_t)v * 3 + 1] = positions[v].y;
+				positionStream[(size_t)v * 3 + 2] = positions[v].z;
+			}
+
+			std::vector<GLfloat> uniquePositions;
+			std::vector<unsigned int> positionIds;
+			WeldReport weld = MeshWelder::weldVertices(positionStream.data(), vertexCount, 3, nullptr, 0, 0.f,
+				uniquePositions, positionIds, pool);
+
+			std::vector<unsigned int> wedgeCount(weld.vertexCountAfter, 0);
+			for (unsigned int v = 0; v < vertexCount; v++)
+			{
+				wedgeCount[positionIds[v]]++;
+			}
+
+			locked.assign(vertexCount, 0);
+			for (unsigned int v = 0; v < vertexCount; v++)
+			{
+				locked[v] = wedgeCount[positionIds[v]] > 1 ? 1 : 0;
+			}
+
+			// An edge with no opposite half edge in position space is an open border.
+			std::vector<unsigned int> positionIndices(current.size());
+			for (size_t i = 0; i < current.size(); i++)
+			{
+				positionIndices[i] = positionIds[current[i]];
+			}
+
+			VertexAdjacency positionAdjacency;
+			MeshNormals::buildAdjacency(positionIndices.data(), (unsigned int)positionIndices.size(), weld.vertexCountAfter, positionAdjacency, pool);
+
+			for (size_t corner = 0; corner < positionIndices.size(); corner++)
+			{
+				size_t triangle = corner / 3;
+				unsigned int a = positionIndices[corner];
+				unsigned int b = positionIndices[triangle * 3 + (corner + 1) % 3];
+
+				bool opposite = false;
+				for (unsigned int c = positionAdjacency.offsets[b]; c < positionAdjacency.offsets[b + 1] && !opposite; c++)
+				{
+					unsigned int otherCorner = positionAdjacency.corners[c];
+					opposite = positionIndices[otherCorner / 3 * 3 + (otherCorner + 1) % 3] == a;
+				}
+
+				if (!opposite)
+				{
+					locked[current[corner]] = 1;
+					locked[current[triangle * 3 + (corner + 1) % 3]] = 1;
+				}
+			}
+		}
+
+		void computeQuadrics()
+		{
+			size_t triangleCount = current.size() / 3;
+			std::vector<Quadric> faces(triangleCount);
+
+			pool->parallelFor(triangleCount, 4096, [&](size_t begin, size_t end)
+			{
+				for (size_t t = begin; t < end; t++)
+				{
+					glm::dvec3 p0 = positions[current[t * 3]];
+					glm::dvec3 p1 = positions[current[t * 3 + 1]];
+					glm::dvec3 p2 = positions[current[t * 3 + 2]];
+
+					glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+					double length = glm::length(normal);
+
+					Quadric& face = faces[t];
+					face = Quadric();
+					if (length > 0.0)
+					{
+						normal /= length;
+						addPlane(face, normal, -glm::dot(normal, p0), length * 0.5);
+					}
+				}
+			});
+
+			MeshNormals::buildAdjacency(current.data(), (unsigned int)current.size(), vertexCount, adjacency, pool);
+
+			quadrics.assign(vertexCount, Quadric());
+			pool->parallelFor(vertexCount, 4096, [&](size_t begin, size_t end)
+			{
+				for (size_t v = begin; v < end; v++)
+				{
+					for (unsigned int c = adjacency.offsets[v]; c < adjacency.offsets[v + 1]; c++)
+					{
+						addQuadric(quadrics[v], faces[adjacency.corners[c] / 3]);
+					}
+				}
+			});
+		}
+
+		bool flipsTriangle(unsigned int from, unsigned int to)
+		{
+			for (unsigned int c = adjacency.offsets[from]; c < adjacency.offsets[from + 1]; c++)
+			{
+				unsigned int corner = adjacency.corners[c];
+				unsigned int triangle = corner / 3;
+				unsigned int b = current[triangle * 3 + (corner + 1) % 3];
+				unsigned int d = current[triangle * 3 + (corner + 2) % 3];
+
+				if (b == to || d == to)
+				{
+					continue;
+				}
+
+				glm::vec3 before = glm::cross(positions[b] - positions[from], positions[d] - positions[from]);
+				glm::vec3 after = glm::cross(positions[b] - positions[to], positions[d] - positions[to]);
+				if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool runPass(size_t collapseBudget, double maxErrorSquared)
+		{
+			MeshNormals::buildAdjacency(current.data(), (unsigned int)current.size(), vertexCount, adjacency, pool);
+
+			candidates.clear();
+			for (size_t corner = 0; corner < current.size(); corner++)
+			{
+				unsigned int a = current[corner];
+				unsigned int b = current[corner / 3 * 3 + (corner + 1) % 3];
+				if (a < b && !(locked[a] && locked[b]))
+				{
+					candidates.push_back({ a, b, 0.0 });
+				}
+			}
+
+			pool->parallelFor(candidates.size(), 8192, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					Collapse& collapse = candidates[i];
+					unsigned int a = collapse.from;
+					unsigned int b = collapse.to;
+					double costToB = locked[a] ? HUGE_VAL : collapseCost(quadrics[a], quadrics[b], positions[b]);
+					double costToA = locked[b] ? HUGE_VAL : collapseCost(quadrics[a], quadrics[b], positions[a]);
+
+					if (costToA < costToB)
+					{
+						collapse.from = b;
+						collapse.to = a;
+						collapse.cost = costToA;
+					}
+					else
+					{
+						collapse.cost = costToB;
+					}
+				}
+			});
+
+			std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			touched.assign(vertexCount, 0);
+			remap.resize(vertexCount);
+			for (unsigned int v = 0; v < vertexCount; v++)
+			{
+				remap[v] = v;
+			}
+
+			// Collapses in one pass never share a triangle, so each flip test sees the final neighbourhood.
+			size_t collapses = 0;
+			for (const Collapse& collapse : candidates)
+			{
+				if (collapses >= collapseBudget || collapse.cost > maxErrorSquared)
+				{
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to] || flipsTriangle(collapse.from, collapse.to))
+				{
+					continue;
+				}
+
+				remap[collapse.from] = collapse.to;
+				addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+				maxCost = std::max(maxCost, collapse.cost);
+				collapses++;
+
+				for (unsigned int c = adjacency.offsets[collapse.from]; c < adjacency.offsets[collapse.from + 1]; c++)
+				{
+					unsigned int triangle = adjacency.corners[c] / 3;
+					touched[current[triangle * 3]] = 1;
+					touched[current[triangle * 3 + 1]] = 1;
+					touched[current[triangle * 3 + 2]] = 1;
+				}
+			}
+
+			if (collapses == 0)
+			{
+				return false;
+			}
+
+			size_t write = 0;
+			for (size_t t = 0; t < current.size() / 3; t++)
+			{
+				unsigned int a = remap[current[t * 3]];
+				unsigned int b = remap[current[t * 3 + 1]];
+				unsigned int c = remap[current[t * 3 + 2]];
+				if (a != b && b != c && a != c)
+				{
+					current[write++] = a;
+					current[write++] = b;
+					current[write++] = c;
+				}
+			}
+			current.resize(write);
+			return true;
+		}
+	};
+}
+
+LodChainReport MeshSimplifier::buildLodChain(const GLfloat* vertices, unsigned int vertexCount, unsigned int vertexStride,
+	const unsigned int* indices, unsigned int numOfIndices, unsigned int maxLods, GLfloat reduction, GLfloat maxError,
+	std::vector<unsigned int>& lodIndices, std::vector<MeshLod>& lods, ThreadPool* pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	numOfIndices -= numOfIndices % 3;
+	lodIndices.assign(indices, indices + numOfIndices);
+	lods.assign(1, { 0, (GLsizei)numOfIndices, 0.f });
+
+	LodChainReport report;
+	report.triangleCounts.push_back(numOfIndices / 3);
+	report.errors.push_back(0.f);
+
+	Simplifier simplifier(vertices, vertexCount, vertexStride, indices, numOfIndices, pool);
+	size_t target = numOfIndices;
+
+	for (unsigned int level = 1; level < maxLods; level++)
+	{
+		target = (size_t)(target * reduction) / 3 * 3;
+		if (target < 3)
+		{
+			break;
+		}
+
+		size_t previousCount = simplifier.getIndices().size();
+		bool reached = simplifier.simplifyTo(target, maxError);
+		const std::vector<unsigned int>& simplified = simplifier.getIndices();
+
+		if (simplified.size() >= previousCount)
+		{
+			break;
+		}
+
+		MeshLod lod;
+		lod.firstIndex = (GLuint)lodIndices.size();
+		lod.indexCount = (GLsizei)simplified.size();
+		lod.error = simplifier.getError();
+
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+		MeshOptimizer::optimizeVertexCache(lodIndices.data() + lod.firstIndex, lod.indexCount, vertexCount);
+		lods.push_back(lod);
+
+		report.triangleCounts.push_back(lod.indexCount / 3);
+		report.errors.push_back(lod.error);
+
+		if (!reached)
+		{
+			break;
+		}
+	}
+
+	report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return report;
+}
+
+void MeshSimplifier::printReport(const char* name, const LodChainReport& report)
+{
+	printf("MeshSimplifier %s: %zu levels in %.2f ms\n", name, report.triangleCounts.size(), report.milliseconds);
+	for (size_t i = 0; i < report.triangleCounts.size(); i++)
+	{
+		printf("  LOD %zu: %u triangles, error %.5f\n", i, report.triangleCounts[i], report.errors[i]);
+	}
+}
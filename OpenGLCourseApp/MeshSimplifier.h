@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "ThreadPool.h"
+
+// A range of a mesh's index buffer. error is the distance, in model units, the level may be
+// off from the full detail surface.
+struct MeshLod
+{
+	GLuint firstIndex;
+	GLsizei indexCount;
+	GLfloat error;
+};
+
+struct LodChainReport
+{
+	std::vector<unsigned int> triangleCounts;
+	std::vector<GLfloat> errors;
+	double milliseconds;
+};
+
+namespace MeshSimplifier
+{
+	// Quadric error edge collapse (Garland and Heckbert 1997) that only moves vertices onto their
+	// neighbours, so every level indexes the same vertex buffer. Vertices on UV seams or open borders
+	// stay put. Each level aims for reduction times the triangles of the one before and the chain
+	// stops early once a collapse would cost more than maxError. lodIndices holds the levels back to
+	// back, LOD 0 (the input) first. Positions are 3 floats at the start of each vertex.
+	LodChainReport buildLodChain(const GLfloat* vertices, unsigned int vertexCount, unsigned int vertexStride,
+		const unsigned int* indices, unsigned int numOfIndices, unsigned int maxLods, GLfloat reduction, GLfloat maxError,
+		std::vector<unsigned int>& lodIndices, std::vector<MeshLod>& lods, ThreadPool* pool = nullptr);
+
+	void printReport(const char* name, const LodChainReport& report);
+}
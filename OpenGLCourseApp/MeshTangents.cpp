@@ -0,0 +1,256 @@
+#include "MeshTangents.h"
+
+#include <cmath>
+#include <memory>
+
+#include <glm\glm.hpp>
+
+#include "MeshNormals.h"
+#include "SimdSupport.h"
+
+namespace
+{
+	struct FaceFrames
+	{
+		std::unique_ptr<GLfloat[]> tx;
+		std::unique_ptr<GLfloat[]> ty;
+		std::unique_ptr<GLfloat[]> tz;
+		std::unique_ptr<GLfloat[]> bx;
+		std::unique_ptr<GLfloat[]> by;
+		std::unique_ptr<GLfloat[]> bz;
+	};
+
+	void faceFramesScalar(const unsigned int* indices, const GLfloat* vertices, const TangentStreamLayout& stream,
+		size_t begin, size_t end, FaceFrames& faces)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			const GLfloat* v0 = vertices + (size_t)indices[t * 3] * stream.vLength;
+			const GLfloat* v1 = vertices + (size_t)indices[t * 3 + 1] * stream.vLength;
+			const GLfloat* v2 = vertices + (size_t)indices[t * 3 + 2] * stream.vLength;
+
+			const GLfloat* p0 = v0 + stream.positionOffset;
+			const GLfloat* p1 = v1 + stream.positionOffset;
+			const GLfloat* p2 = v2 + stream.positionOffset;
+			const GLfloat* uv0 = v0 + stream.texCoordOffset;
+			const GLfloat* uv1 = v1 + stream.texCoordOffset;
+			const GLfloat* uv2 = v2 + stream.texCoordOffset;
+
+			glm::vec3 e1(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]);
+			glm::vec3 e2(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]);
+			GLfloat du1 = uv1[0] - uv0[0];
+			GLfloat dv1 = uv1[1] - uv0[1];
+			GLfloat du2 = uv2[0] - uv0[0];
+			GLfloat dv2 = uv2[1] - uv0[1];
+
+			GLfloat sign = du1 * dv2 - du2 * dv1 < 0.f ? -1.f : 1.f;
+			glm::vec3 tangent = e1 * dv2 - e2 * dv1;
+			glm::vec3 bitangent = e2 * du1 - e1 * du2;
+
+			GLfloat tangentLength = glm::length(tangent);
+			GLfloat bitangentLength = glm::length(bitangent);
+			tangent = tangentLength > 0.f ? tangent * (sign / tangentLength) : glm::vec3(0.f);
+			bitangent = bitangentLength > 0.f ? bitangent * (sign / bitangentLength) : glm::vec3(0.f);
+
+			faces.tx[t] = tangent.x;
+			faces.ty[t] = tangent.y;
+			faces.tz[t] = tangent.z;
+			faces.bx[t] = bitangent.x;
+			faces.by[t] = bitangent.y;
+			faces.bz[t] = bitangent.z;
+		}
+	}
+
+#if SIMD_X86
+	SIMD_TARGET_AVX2
+	void normaliseSigned(__m256& x, __m256& y, __m256& z, __m256 sign)
+	{
+		__m256 length = _mm256_sqrt_ps(_mm256_fmadd_ps(z, z, _mm256_fmadd_ps(y, y, _mm256_mul_ps(x, x))));
+		__m256 valid = _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ);
+		__m256 scale = _mm256_and_ps(_mm256_div_ps(sign, length), valid);
+		x = _mm256_mul_ps(x, scale);
+		y = _mm256_mul_ps(y, scale);
+		z = _mm256_mul_ps(z, scale);
+	}
+
+	SIMD_TARGET_AVX2
+	void faceFramesAVX2(const unsigned int* indices, const GLfloat* vertices, const TangentStreamLayout& stream,
+		size_t begin, size_t end, FaceFrames& faces)
+	{
+		const __m256i cornerStride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+		const __m256i vertexStride = _mm256_set1_epi32((int)stream.vLength);
+		const GLfloat* positions = vertices + stream.positionOffset;
+		const GLfloat* texCoords = vertices + stream.texCoordOffset;
+
+		size_t t = begin;
+		for (; t + 8 <= end; t += 8)
+		{
+			__m256 px[3], py[3], pz[3], u[3], v[3];
+
+			for (int k = 0; k < 3; k++)
+			{
+				__m256i corner = _mm256_i32gather_epi32((const int*)(indices + t * 3 + k), cornerStride, 4);
+				__m256i offset = _mm256_mullo_epi32(corner, vertexStride);
+				px[k] = _mm256_i32gather_ps(positions, offset, 4);
+				py[k] = _mm256_i32gather_ps(positions + 1, offset, 4);
+				pz[k] = _mm256_i32gather_ps(positions + 2, offset, 4);
+				u[k] = _mm256_i32gather_ps(texCoords, offset, 4);
+				v[k] = _mm256_i32gather_ps(texCoords + 1, offset, 4);
+			}
+
+			__m256 e1x = _mm256_sub_ps(px[1], px[0]);
+			__m256 e1y = _mm256_sub_ps(py[1], py[0]);
+			__m256 e1z = _mm256_sub_ps(pz[1], pz[0]);
+			__m256 e2x = _mm256_sub_ps(px[2], px[0]);
+			__m256 e2y = _mm256_sub_ps(py[2], py[0]);
+			__m256 e2z = _mm256_sub_ps(pz[2], pz[0]);
+			__m256 du1 = _mm256_sub_ps(u[1], u[0]);
+			__m256 dv1 = _mm256_sub_ps(v[1], v[0]);
+			__m256 du2 = _mm256_sub_ps(u[2], u[0]);
+			__m256 dv2 = _mm256_sub_ps(v[2], v[0]);
+
+			__m256 area = _mm256_fmsub_ps(du1, dv2, _mm256_mul_ps(du2, dv1));
+			__m256 negative = _mm256_cmp_ps(area, _mm256_setzero_ps(), _CMP_LT_OQ);
+			__m256 sign = _mm256_blendv_ps(_mm256_set1_ps(1.f), _mm256_set1_ps(-1.f), negative);
+
+			__m256 tx = _mm256_fmsub_ps(e1x, dv2, _mm256_mul_ps(e2x, dv1));
+			__m256 ty = _mm256_fmsub_ps(e1y, dv2, _mm256_mul_ps(e2y, dv1));
+			__m256 tz = _mm256_fmsub_ps(e1z, dv2, _mm256_mul_ps(e2z, dv1));
+			__m256 bx = _mm256_fmsub_ps(e2x, du1, _mm256_mul_ps(e1x, du2));
+			__m256 by = _mm256_fmsub_ps(e2y, du1, _mm256_mul_ps(e1y, du2));
+			__m256 bz = _mm256_fmsub_ps(e2z, du1, _mm256_mul_ps(e1z, du2));
+
+			normaliseSigned(tx, ty, tz, sign);
+			normaliseSigned(bx, by, bz, sign);
+
+			_mm256_storeu_ps(&faces.tx[t], tx);
+			_mm256_storeu_ps(&faces.ty[t], ty);
+			_mm256_storeu_ps(&faces.tz[t], tz);
+			_mm256_storeu_ps(&faces.bx[t], bx);
+			_mm256_storeu_ps(&faces.by[t], by);
+			_mm256_storeu_ps(&faces.bz[t], bz);
+		}
+
+		faceFramesScalar(indices, vertices, stream, t, end, faces);
+	}
+#endif
+
+	glm::vec3 projectToPlane(const glm::vec3& vector, const glm::vec3& normal)
+	{
+		glm::vec3 projected = vector - normal * glm::dot(normal, vector);
+		GLfloat length = glm::length(projected);
+		return length > 0.f ? projected / length : glm::vec3(0.f);
+	}
+}
+
+void MeshTangents::expandToTangentLayout(const GLfloat* vertices, unsigned int vertexCount, std::vector<GLfloat>& tangentVertices)
+{
+	tangentVertices.assign((size_t)vertexCount * 12, 0.f);
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		for (int c = 0; c < 8; c++)
+		{
+			tangentVertices[(size_t)i * 12 + c] = vertices[(size_t)i * 8 + c];
+		}
+	}
+}
+
+void MeshTangents::calcTangents(const unsigned int* indices, unsigned int indiceCount, GLfloat* vertices, unsigned int vertexCount,
+	const TangentStreamLayout& stream, ThreadPool* pool)
+{
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	size_t triangleCount = indiceCount / 3;
+
+	VertexAdjacency adjacency;
+	MeshNormals::buildAdjacency(indices, indiceCount, vertexCount, adjacency, pool);
+
+	FaceFrames faces;
+	faces.tx.reset(new GLfloat[triangleCount]);
+	faces.ty.reset(new GLfloat[triangleCount]);
+	faces.tz.reset(new GLfloat[triangleCount]);
+	faces.bx.reset(new GLfloat[triangleCount]);
+	faces.by.reset(new GLfloat[triangleCount]);
+	faces.bz.reset(new GLfloat[triangleCount]);
+
+	bool useAVX2 = SimdSupport::hasAVX2();
+
+	pool->parallelFor(triangleCount, 4096, [&](size_t begin, size_t end)
+	{
+#if SIMD_X86
+		if (useAVX2)
+		{
+			faceFramesAVX2(indices, vertices, stream, begin, end, faces);
+			return;
+		}
+#endif
+		faceFramesScalar(indices, vertices, stream, begin, end, faces);
+	});
+
+	auto position = [&](unsigned int vertex)
+	{
+		const GLfloat* p = vertices + (size_t)vertex * stream.vLength + stream.positionOffset;
+		return glm::vec3(p[0], p[1], p[2]);
+	};
+
+	pool->parallelFor(vertexCount, 2048, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+		{
+			GLfloat* vertex = vertices + v * stream.vLength;
+			glm::vec3 normal(vertex[stream.normalOffset], vertex[stream.normalOffset + 1], vertex[stream.normalOffset + 2]);
+			glm::vec3 tangentSum(0.f);
+			glm::vec3 bitangentSum(0.f);
+
+			for (unsigned int c = adjacency.offsets[v]; c < adjacency.offsets[v + 1]; c++)
+			{
+				unsigned int corner = adjacency.corners[c];
+				unsigned int triangle = corner / 3;
+				unsigned int k = corner % 3;
+
+				glm::vec3 origin = position(indices[corner]);
+				glm::vec3 edge1 = projectToPlane(position(indices[triangle * 3 + (k + 1) % 3]) - origin, normal);
+				glm::vec3 edge2 = projectToPlane(position(indices[triangle * 3 + (k + 2) % 3]) - origin, normal);
+				GLfloat angle = acosf(glm::clamp(glm::dot(edge1, edge2), -1.f, 1.f));
+
+				glm::vec3 faceTangent(faces.tx[triangle], faces.ty[triangle], faces.tz[triangle]);
+				glm::vec3 faceBitangent(faces.bx[triangle], faces.by[triangle], faces.bz[triangle]);
+
+				tangentSum += projectToPlane(faceTangent, normal) * angle;
+				bitangentSum += projectToPlane(faceBitangent, normal) * angle;
+			}
+
+			glm::vec3 tangent = projectToPlane(tangentSum, normal);
+			if (glm::dot(tangent, tangent) == 0.f)
+			{
+				glm::vec3 axis = fabsf(normal.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f);
+				tangent = projectToPlane(axis, normal);
+			}
+
+			GLfloat handedness = glm::dot(glm::cross(normal, tangent), bitangentSum) < 0.f ? -1.f : 1.f;
+
+			GLfloat* out = vertex + stream.tangentOffset;
+			out[0] = tangent.x;
+			out[1] = tangent.y;
+			out[2] = tangent.z;
+			out[3] = handedness;
+		}
+	});
+}
+
+std::future<void> MeshTangents::calcTangentsAsync(const unsigned int* indices, unsigned int indiceCount, GLfloat* vertices, unsigned int vertexCount,
+	const TangentStreamLayout& stream, ThreadPool* pool)
+{
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	return pool->submit([=]()
+	{
+		calcTangents(indices, indiceCount, vertices, vertexCount, stream, pool);
+	});
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <future>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "ThreadPool.h"
+
+struct TangentStreamLayout
+{
+	unsigned int vLength;
+	unsigned int positionOffset;
+	unsigned int texCoordOffset;
+	unsigned int normalOffset;
+	unsigned int tangentOffset;
+};
+
+namespace MeshTangents
+{
+	// Offsets for TangentVertexLayout: x y z, u v, nx ny nz, tx ty tz tw.
+	const TangentStreamLayout tangentVertexStream = { 12, 0, 3, 5, 8 };
+
+	// Copies 8 float StandardVertexLayout vertices into the 12 float TangentVertexLayout with empty tangents.
+	void expandToTangentLayout(const GLfloat* vertices, unsigned int vertexCount, std::vector<GLfloat>& tangentVertices);
+
+	// Writes a unit tangent and handedness (w = +-1, bitangent = w * cross(normal, tangent)) per vertex,
+	// following MikkTSpace: face tangents are projected into each vertex's normal plane and
+	// weighted by the projected corner angle. Normals must already be present and normalised.
+	void calcTangents(const unsigned int* indices, unsigned int indiceCount, GLfloat* vertices, unsigned int vertexCount,
+		const TangentStreamLayout& stream, ThreadPool* pool = nullptr);
+
+	// Same as calcTangents but returns immediately; the buffers must stay alive until the future is ready.
+	std::future<void> calcTangentsAsync(const unsigned int* indices, unsigned int indiceCount, GLfloat* vertices, unsigned int vertexCount,
+		const TangentStreamLayout& stream, ThreadPool* pool = nullptr);
+}
@@ -0,0 +1,254 @@
+#include "MeshWelder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	const unsigned int bucketBits = 8;
+	const unsigned int bucketCount = 1u << bucketBits;
+
+	const double maxCell = 9.0e18;
+
+	long long quantise(GLfloat value, GLfloat inverseEpsilon)
+	{
+		if (inverseEpsilon > 0.f)
+		{
+			// In 64 bits and clamped, so huge coordinates at a tiny epsilon can't overflow the cast.
+			double cell = floor((double)value * inverseEpsilon + 0.5);
+			return (long long)(cell > -maxCell ? std::min(cell, maxCell) : -maxCell);
+		}
+
+		if (value == 0.f)
+		{
+			value = 0.f;
+		}
+		GLint bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	unsigned long long hashVertex(const GLfloat* vertex, unsigned int vLength, GLfloat inverseEpsilon)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		for (unsigned int c = 0; c < vLength; c++)
+		{
+			hash ^= (unsigned long long)quantise(vertex[c], inverseEpsilon);
+			hash *= 1099511628211ull;
+		}
+		hash ^= hash >> 29;
+		hash *= 0xbf58476d1ce4e5b9ull;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	bool sameVertex(const GLfloat* a, const GLfloat* b, unsigned int vLength, GLfloat inverseEpsilon)
+	{
+		for (unsigned int c = 0; c < vLength; c++)
+		{
+			if (quantise(a[c], inverseEpsilon) != quantise(b[c], inverseEpsilon))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+WeldReport MeshWelder::weldVertices(const GLfloat* vertices, unsigned int vertexCount, unsigned int vLength,
+	const unsigned int* indices, unsigned int numOfIndices, GLfloat epsilon,
+	std::vector<GLfloat>& weldedVertices, std::vector<unsigned int>& weldedIndices, ThreadPool* pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	GLfloat inverseEpsilon = epsilon > 0.f ? 1.f / epsilon : 0.f;
+	std::vector<unsigned long long> hashes(vertexCount);
+
+	pool->parallelFor(vertexCount, 8192, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+		{
+			hashes[v] = hashVertex(vertices + v * vLength, vLength, inverseEpsilon);
+		}
+	});
+
+	// Scatter vertices into buckets by the top hash bits, keeping original order inside each
+	// bucket, so every bucket can be deduplicated by its own thread.
+	size_t chunkCount = std::max((size_t)1, std::min((size_t)pool->getParallelThreadCount() + 1, (size_t)vertexCount / 65536));
+	size_t chunkSize = (vertexCount + chunkCount - 1) / chunkCount;
+	std::vector<std::vector<unsigned int>> histograms(chunkCount, std::vector<unsigned int>(bucketCount, 0));
+
+	pool->parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			size_t last = std::min((size_t)vertexCount, (chunk + 1) * chunkSize);
+			for (size_t v = chunk * chunkSize; v < last; v++)
+			{
+				histograms[chunk][hashes[v] >> (64 - bucketBits)]++;
+			}
+		}
+	});
+
+	std::vector<unsigned int> bucketOffsets(bucketCount + 1, 0);
+	unsigned int running = 0;
+	for (unsigned int bucket = 0; bucket < bucketCount; bucket++)
+	{
+		bucketOffsets[bucket] = running;
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			unsigned int count = histograms[chunk][bucket];
+			histograms[chunk][bucket] = running;
+			running += count;
+		}
+	}
+	bucketOffsets[bucketCount] = running;
+
+	std::vector<unsigned int> sorted(vertexCount);
+	pool->parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			size_t last = std::min((size_t)vertexCount, (chunk + 1) * chunkSize);
+			for (size_t v = chunk * chunkSize; v < last; v++)
+			{
+				sorted[histograms[chunk][hashes[v] >> (64 - bucketBits)]++] = (unsigned int)v;
+			}
+		}
+	});
+
+	const unsigned int empty = ~0u;
+	std::vector<unsigned int> canonical(vertexCount);
+
+	pool->parallelFor(bucketCount, 1, [&](size_t begin, size_t end)
+	{
+		std::vector<unsigned int> table;
+
+		for (size_t bucket = begin; bucket < end; bucket++)
+		{
+			unsigned int first = bucketOffsets[bucket];
+			unsigned int count = bucketOffsets[bucket + 1] - first;
+			if (count == 0)
+			{
+				continue;
+			}
+
+			size_t tableSize = 16;
+			while (tableSize < (size_t)count * 2)
+			{
+				tableSize *= 2;
+			}
+			table.assign(tableSize, empty);
+
+			for (unsigned int i = 0; i < count; i++)
+			{
+				unsigned int vertex = sorted[first + i];
+				size_t slot = (size_t)hashes[vertex] & (tableSize - 1);
+
+				while (true)
+				{
+					unsigned int existing = table[slot];
+					if (existing == empty)
+					{
+						table[slot] = vertex;
+						canonical[vertex] = vertex;
+						break;
+					}
+					if (hashes[existing] == hashes[vertex] &&
+						sameVertex(vertices + (size_t)existing * vLength, vertices + (size_t)vertex * vLength, vLength, inverseEpsilon))
+					{
+						canonical[vertex] = existing;
+						break;
+					}
+					slot = (slot + 1) & (tableSize - 1);
+				}
+			}
+		}
+	});
+
+	// Number the surviving vertices in original order: count per chunk, prefix, then fill.
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned int> chunkUnique(chunkCount + 1, 0);
+
+	pool->parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			size_t last = std::min((size_t)vertexCount, (chunk + 1) * chunkSize);
+			unsigned int unique = 0;
+			for (size_t v = chunk * chunkSize; v < last; v++)
+			{
+				unique += canonical[v] == v ? 1 : 0;
+			}
+			chunkUnique[chunk + 1] = unique;
+		}
+	});
+
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		chunkUnique[chunk + 1] += chunkUnique[chunk];
+	}
+
+	unsigned int weldedCount = chunkUnique[chunkCount];
+	weldedVertices.resize((size_t)weldedCount * vLength);
+
+	pool->parallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			size_t last = std::min((size_t)vertexCount, (chunk + 1) * chunkSize);
+			unsigned int next = chunkUnique[chunk];
+			for (size_t v = chunk * chunkSize; v < last; v++)
+			{
+				if (canonical[v] == v)
+				{
+					memcpy(&weldedVertices[(size_t)next * vLength], vertices + v * vLength, vLength * sizeof(GLfloat));
+					remap[v] = next++;
+				}
+			}
+		}
+	});
+
+	pool->parallelFor(vertexCount, 8192, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+		{
+			if (canonical[v] != v)
+			{
+				remap[v] = remap[canonical[v]];
+			}
+		}
+	});
+
+	unsigned int indexTotal = indices ? numOfIndices : vertexCount;
+	weldedIndices.resize(indexTotal);
+
+	pool->parallelFor(indexTotal, 16384, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			weldedIndices[i] = remap[indices ? indices[i] : (unsigned int)i];
+		}
+	});
+
+	WeldReport report;
+	report.vertexCountBefore = vertexCount;
+	report.vertexCountAfter = weldedCount;
+	report.dedupRatio = weldedCount > 0 ? (GLfloat)vertexCount / (GLfloat)weldedCount : 1.f;
+	report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return report;
+}
+
+void MeshWelder::printReport(const char* name, const WeldReport& report)
+{
+	printf("MeshWelder %s: %u -> %u vertices (%.2fx), %.2f ms\n",
+		name, report.vertexCountBefore, report.vertexCountAfter, report.dedupRatio, report.milliseconds);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "ThreadPool.h"
+
+struct WeldReport
+{
+	unsigned int vertexCountBefore;
+	unsigned int vertexCountAfter;
+	GLfloat dedupRatio;
+	double milliseconds;
+};
+
+namespace MeshWelder
+{
+	// Merges vertices whose every component matches, or lands in the same epsilon sized cell when
+	// epsilon > 0 (values straddling a cell boundary stay separate). indices may be null for a
+	// triangle soup, in which case vertex i is index i. Output vertices keep their original order.
+	WeldReport weldVertices(const GLfloat* vertices, unsigned int vertexCount, unsigned int vLength,
+		const unsigned int* indices, unsigned int numOfIndices, GLfloat epsilon,
+		std::vector<GLfloat>& weldedVertices, std::vector<unsigned int>& weldedIndices, ThreadPool* pool = nullptr);
+
+	void printReport(const char* name, const WeldReport& report);
+}
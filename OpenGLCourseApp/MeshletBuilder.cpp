@@ -0,0 +1,254 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "MeshNormals.h"
+
+namespace
+{
+	glm::vec3 vertexPosition(const GLfloat* vertices, unsigned int vertexStride, unsigned int vertex)
+	{
+		const GLfloat* position = (const GLfloat*)((const unsigned char*)vertices + (size_t)vertex * vertexStride);
+		return glm::vec3(position[0], position[1], position[2]);
+	}
+
+	void computeBounds(Meshlet& meshlet, const unsigned int* indices, const GLfloat* vertices, unsigned int vertexStride)
+	{
+		glm::vec3 boundsMin(FLT_MAX);
+		glm::vec3 boundsMax(-FLT_MAX);
+		glm::vec3 normalSum(0.f);
+		std::vector<glm::vec3> normals;
+
+		for (GLuint t = 0; t < meshlet.triangleCount; t++)
+		{
+			const unsigned int* triangle = indices + meshlet.firstIndex + t * 3;
+			glm::vec3 p0 = vertexPosition(vertices, vertexStride, triangle[0]);
+			glm::vec3 p1 = vertexPosition(vertices, vertexStride, triangle[1]);
+			glm::vec3 p2 = vertexPosition(vertices, vertexStride, triangle[2]);
+
+			boundsMin = glm::min(boundsMin, glm::min(p0, glm::min(p1, p2)));
+			boundsMax = glm::max(boundsMax, glm::max(p0, glm::max(p1, p2)));
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			GLfloat length = glm::length(normal);
+			if (length > 0.f)
+			{
+				normals.push_back(normal / length);
+				normalSum += normal / length;
+			}
+		}
+
+		meshlet.centre = (boundsMin + boundsMax) * 0.5f;
+		meshlet.radius = 0.f;
+		for (GLuint i = 0; i < meshlet.triangleCount * 3; i++)
+		{
+			glm::vec3 position = vertexPosition(vertices, vertexStride, indices[meshlet.firstIndex + i]);
+			meshlet.radius = std::max(meshlet.radius, glm::length(position - meshlet.centre));
+		}
+
+		// The cone is only useful when every face is within 90 degrees of the axis.
+		meshlet.coneAxis = glm::vec3(0.f);
+		meshlet.coneCutoff = 1.f;
+
+		GLfloat axisLength = glm::length(normalSum);
+		if (axisLength <= 0.f || normals.empty())
+		{
+			return;
+		}
+
+		glm::vec3 axis = normalSum / axisLength;
+		GLfloat minDot = 1.f;
+		for (const glm::vec3& normal : normals)
+		{
+			minDot = std::min(minDot, glm::dot(axis, normal));
+		}
+
+		if (minDot > 0.1f)
+		{
+			meshlet.coneAxis = axis;
+			meshlet.coneCutoff = sqrtf(1.f - minDot * minDot);
+		}
+	}
+}
+
+void MeshletBuilder::buildMeshlets(unsigned int* indices, unsigned int numOfIndices, const GLfloat* vertices, unsigned int vertexCount,
+	unsigned int vertexStride, std::vector<Meshlet>& meshlets)
+{
+	meshlets.clear();
+
+	unsigned int triangleCount = numOfIndices / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	VertexAdjacency adjacency;
+	MeshNormals::buildAdjacency(indices, triangleCount * 3, vertexCount, adjacency);
+
+	std::vector<unsigned char> emitted(triangleCount, 0);
+	std::vector<unsigned int> vertexMeshlet(vertexCount, ~0u);
+	std::vector<unsigned int> reordered;
+	reordered.reserve(triangleCount * 3);
+
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> meshletVertices;
+	unsigned int nextSeed = 0;
+
+	while (true)
+	{
+		// Start next to the previous cluster when it left neighbours behind, so clusters stay compact.
+		unsigned int seed = ~0u;
+		for (unsigned int candidate : candidates)
+		{
+			if (!emitted[candidate])
+			{
+				seed = candidate;
+				break;
+			}
+		}
+
+		while (seed == ~0u && nextSeed < triangleCount)
+		{
+			if (!emitted[nextSeed])
+			{
+				seed = nextSeed;
+			}
+			nextSeed++;
+		}
+
+		if (seed == ~0u)
+		{
+			break;
+		}
+
+		Meshlet meshlet = {};
+		meshlet.firstIndex = (GLuint)reordered.size();
+		unsigned int meshletId = (unsigned int)meshlets.size();
+		glm::vec3 centroidSum(0.f);
+
+		meshletVertices.clear();
+		candidates.clear();
+		candidates.push_back(seed);
+
+		while (meshlet.triangleCount < maxTriangles)
+		{
+			// Prefer the triangle that adds the fewest new vertices, then the one nearest the cluster centre.
+			unsigned int best = ~0u;
+			unsigned int bestNew = 4;
+			GLfloat bestDistance = FLT_MAX;
+			glm::vec3 centroid = meshletVertices.empty() ? glm::vec3(0.f) : centroidSum / (GLfloat)meshletVertices.size();
+
+			for (size_t i = 0; i < candidates.size(); i++)
+			{
+				unsigned int triangle = candidates[i];
+				if (emitted[triangle])
+				{
+					candidates[i--] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+
+				unsigned int newVertices = 0;
+				glm::vec3 triangleCentre(0.f);
+				for (int k = 0; k < 3; k++)
+				{
+					unsigned int vertex = indices[triangle * 3 + k];
+					newVertices += vertexMeshlet[vertex] != meshletId ? 1 : 0;
+					triangleCentre += vertexPosition(vertices, vertexStride, vertex) / 3.f;
+				}
+
+				if (meshletVertices.size() + newVertices > maxVertices)
+				{
+					continue;
+				}
+
+				GLfloat distance = meshletVertices.empty() ? 0.f : glm::length(triangleCentre - centroid);
+				if (newVertices < bestNew || (newVertices == bestNew && distance < bestDistance))
+				{
+					best = triangle;
+					bestNew = newVertices;
+					bestDistance = distance;
+				}
+			}
+
+			if (best == ~0u)
+			{
+				break;
+			}
+
+			emitted[best] = 1;
+			meshlet.triangleCount++;
+
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int vertex = indices[best * 3 + k];
+				reordered.push_back(vertex);
+
+				if (vertexMeshlet[vertex] == meshletId)
+				{
+					continue;
+				}
+
+				vertexMeshlet[vertex] = meshletId;
+				meshletVertices.push_back(vertex);
+				centroidSum += vertexPosition(vertices, vertexStride, vertex);
+
+				for (unsigned int c = adjacency.offsets[vertex]; c < adjacency.offsets[vertex + 1]; c++)
+				{
+					unsigned int neighbour = adjacency.corners[c] / 3;
+					if (!emitted[neighbour])
+					{
+						candidates.push_back(neighbour);
+					}
+				}
+			}
+		}
+
+		meshlet.vertexCount = (GLuint)meshletVertices.size();
+		meshlets.push_back(meshlet);
+	}
+
+	std::copy(reordered.begin(), reordered.end(), indices);
+
+	for (Meshlet& meshlet : meshlets)
+	{
+		computeBounds(meshlet, indices, vertices, vertexStride);
+	}
+}
+
+GLuint MeshletBuilder::cullMeshlets(const std::vector<Meshlet>& meshlets, Frustum& frustum, const glm::vec3& cameraPosition,
+	std::vector<IndexRange>& ranges)
+{
+	GLuint visibleTriangles = 0;
+	size_t firstRange = ranges.size();
+
+	for (const Meshlet& meshlet : meshlets)
+	{
+		glm::vec3 toCentre = meshlet.centre - cameraPosition;
+		if (glm::dot(toCentre, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCentre) + meshlet.radius)
+		{
+			continue;
+		}
+
+		if (!frustum.containsSphere(meshlet.centre, meshlet.radius))
+		{
+			continue;
+		}
+
+		visibleTriangles += meshlet.triangleCount;
+
+		GLsizei indexCount = (GLsizei)meshlet.triangleCount * 3;
+		if (ranges.size() > firstRange && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex)
+		{
+			ranges.back().indexCount += indexCount;
+		}
+		else
+		{
+			ranges.push_back({ meshlet.firstIndex, indexCount });
+		}
+	}
+
+	return visibleTriangles;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "Frustum.h"
+
+// A contiguous run of a mesh's indices with bounds in model space. The cluster faces away from any
+// viewpoint v where dot(centre - v, coneAxis) >= coneCutoff * length(centre - v) + radius.
+struct Meshlet
+{
+	GLuint firstIndex;
+	GLuint triangleCount;
+	GLuint vertexCount;
+	glm::vec3 centre;
+	GLfloat radius;
+	glm::vec3 coneAxis;
+	GLfloat coneCutoff;
+};
+
+struct IndexRange
+{
+	GLuint firstIndex;
+	GLsizei indexCount;
+};
+
+namespace MeshletBuilder
+{
+	const unsigned int maxVertices = 64;
+	const unsigned int maxTriangles = 124;
+
+	// Greedily grows clusters over shared vertices and reorders indices so every meshlet is
+	// contiguous. Positions are 3 floats at the start of each vertex.
+	void buildMeshlets(unsigned int* indices, unsigned int numOfIndices, const GLfloat* vertices, unsigned int vertexCount,
+		unsigned int vertexStride, std::vector<Meshlet>& meshlets);
+
+	// frustum and cameraPosition must be in the meshlets' model space, e.g. Frustum(viewProjection * model).
+	// Appends the surviving index ranges, merging neighbours, and returns the visible triangle count.
+	GLuint cullMeshlets(const std::vector<Meshlet>& meshlets, Frustum& frustum, const glm::vec3& cameraPosition,
+		std::vector<IndexRange>& ranges);
+}
@@ -0,0 +1,446 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "SimdSupport.h"
+
+namespace
+{
+	const float pi = 3.14159265f;
+	const float kaiserRadius = 3.f;
+	const float kaiserAlpha = 4.f;
+	const float lanczosRadius = 3.f;
+	// Fine enough that every 8 bit sRGB code is reachable, even in the steep dark end.
+	const int encodeSize = 16384;
+
+	// RGBA slot each source channel is filtered in; grey alpha images keep alpha in its own slot.
+	const int channelSlots[4][4] = { { 0 }, { 0, 3 }, { 0, 1, 2 }, { 0, 1, 2, 3 } };
+
+	struct ColourTables
+	{
+		// 256 colour entries then 256 alpha entries, so one gather decodes a whole RGBA texel.
+		float srgbToLinear[512];
+		float unormToFloat[512];
+		unsigned char linearToSRGB[encodeSize];
+
+		ColourTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float value = i / 255.f;
+				srgbToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+				srgbToLinear[i + 256] = value;
+				unormToFloat[i] = value;
+				unormToFloat[i + 256] = value;
+			}
+			for (int i = 0; i < encodeSize; i++)
+			{
+				float value = (float)i / (encodeSize - 1);
+				float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+				linearToSRGB[i] = (unsigned char)(encoded * 255.f + 0.5f);
+			}
+		}
+	};
+
+	const ColourTables& getTables()
+	{
+		static ColourTables tables;
+		return tables;
+	}
+
+	// Source texels each target texel reads along one axis: taps of them from first, wrapping.
+	struct FilterTaps
+	{
+		int taps;
+		std::vector<int> first;
+		std::vector<int> indices;
+		std::vector<float> weights;
+	};
+
+	int wrap(int index, int size)
+	{
+		index %= size;
+		return index < 0 ? index + size : index;
+	}
+
+	float sinc(float x)
+	{
+		if (std::fabs(x) < 1e-5f)
+		{
+			return 1.f;
+		}
+		x *= pi;
+		return std::sin(x) / x;
+	}
+
+	// Zeroth order modified Bessel function of the first kind, which shapes the Kaiser window.
+	float besselI0(float x)
+	{
+		float sum = 1.f;
+		float term = 1.f;
+		for (int k = 1; k < 16; k++)
+		{
+			float factor = x * 0.5f / k;
+			term *= factor * factor;
+			sum += term;
+		}
+		return sum;
+	}
+
+	float getRadius(MipFilter filter)
+	{
+		switch (filter)
+		{
+		case MipFilter::Kaiser:
+			return kaiserRadius;
+		case MipFilter::Lanczos:
+			return lanczosRadius;
+		default:
+			return 0.5f;
+		}
+	}
+
+	// x is in target texels.
+	float evaluateFilter(MipFilter filter, float x)
+	{
+		x = std::fabs(x);
+		switch (filter)
+		{
+		case MipFilter::Box:
+			return x <= 0.5f ? 1.f : 0.f;
+		case MipFilter::Kaiser:
+		{
+			if (x >= kaiserRadius)
+			{
+				return 0.f;
+			}
+			float t = x / kaiserRadius;
+			return sinc(x) * besselI0(kaiserAlpha * std::sqrt(1.f - t * t)) / besselI0(kaiserAlpha);
+		}
+		case MipFilter::Lanczos:
+			return x < lanczosRadius ? sinc(x) * sinc(x / lanczosRadius) : 0.f;
+		}
+		return 0.f;
+	}
+
+	FilterTaps buildTaps(MipFilter filter, int sourceSize, int targetSize)
+	{
+		float scale = (float)sourceSize / targetSize;
+		float radius = getRadius(filter) * scale;
+
+		// Trim taps whose weight is zero everywhere, so a 2:1 box only reads two texels.
+		FilterTaps result;
+		result.taps = 1;
+		result.first.resize(targetSize);
+		std::vector<int> last(targetSize);
+		for (int t = 0; t < targetSize; t++)
+		{
+			float centre = (t + 0.5f) * scale - 0.5f;
+			int low = (int)std::ceil(centre - radius);
+			int high = (int)std::floor(centre + radius);
+
+			result.first[t] = INT_MAX;
+			last[t] = low;
+			for (int s = low; s <= high; s++)
+			{
+				if (std::fabs(evaluateFilter(filter, (s - centre) / scale)) > 1e-5f)
+				{
+					result.first[t] = std::min(result.first[t], s);
+					last[t] = s;
+				}
+			}
+			if (result.first[t] == INT_MAX)
+			{
+				result.first[t] = (int)std::floor(centre + 0.5f);
+				last[t] = result.first[t];
+			}
+			result.taps = std::max(result.taps, last[t] - result.first[t] + 1);
+		}
+
+		result.indices.resize((size_t)targetSize * result.taps);
+		result.weights.resize((size_t)targetSize * result.taps);
+		for (int t = 0; t < targetSize; t++)
+		{
+			float centre = (t + 0.5f) * scale - 0.5f;
+			float total = 0.f;
+			for (int k = 0; k < result.taps; k++)
+			{
+				int s = result.first[t] + k;
+				float weight = s <= last[t] ? evaluateFilter(filter, (s - centre) / scale) : 0.f;
+				result.indices[(size_t)t * result.taps + k] = wrap(s, sourceSize);
+				result.weights[(size_t)t * result.taps + k] = weight;
+				total += weight;
+			}
+			for (int k = 0; k < result.taps; k++)
+			{
+				result.weights[(size_t)t * result.taps + k] = total != 0.f ? result.weights[(size_t)t * result.taps + k] / total : 1.f / result.taps;
+			}
+		}
+		return result;
+	}
+
+	void decodeRowScalar(const unsigned char* bytes, int count, const float* table, float* out)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			out[i] = table[bytes[i] + ((i & 3) == 3 ? 256 : 0)];
+		}
+	}
+
+	void verticalScalar(const float* const* rows, const float* weights, int taps, int count, float* out)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			float sum = 0.f;
+			for (int k = 0; k < taps; k++)
+			{
+				sum += weights[k] * rows[k][i];
+			}
+			out[i] = sum;
+		}
+	}
+
+	void horizontalScalar(const float* column, const int* indices, const float* weights, int taps, int targetWidth, float* out)
+	{
+		for (int x = 0; x < targetWidth; x++)
+		{
+			const int* texelIndices = indices + (size_t)x * taps;
+			const float* texelWeights = weights + (size_t)x * taps;
+			for (int c = 0; c < 4; c++)
+			{
+				float sum = 0.f;
+				for (int k = 0; k < taps; k++)
+				{
+					sum += texelWeights[k] * column[(size_t)texelIndices[k] * 4 + c];
+				}
+				out[(size_t)x * 4 + c] = sum;
+			}
+		}
+	}
+
+#if SIMD_X86
+	SIMD_TARGET_AVX2
+	void decodeRowAVX2(const unsigned char* bytes, int count, const float* table, float* out)
+	{
+		const __m256i alphaOffset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+
+		int i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(bytes + i)));
+			_mm256_storeu_ps(out + i, _mm256_i32gather_ps(table, _mm256_add_epi32(index, alphaOffset), 4));
+		}
+		decodeRowScalar(bytes + i, count - i, table, out + i);
+	}
+
+	SIMD_TARGET_AVX2
+	void verticalAVX2(const float* const* rows, const float* weights, int taps, int count, float* out)
+	{
+		int i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+			for (int k = 0; k < taps; k++)
+			{
+				sum = _mm256_fmadd_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i), sum);
+			}
+			_mm256_storeu_ps(out + i, sum);
+		}
+		for (; i < count; i++)
+		{
+			float sum = 0.f;
+			for (int k = 0; k < taps; k++)
+			{
+				sum += weights[k] * rows[k][i];
+			}
+			out[i] = sum;
+		}
+	}
+
+	// Two RGBA texels per register, each half with its own taps.
+	SIMD_TARGET_AVX2
+	void horizontalAVX2(const float* column, const int* indices, const float* weights, int taps, int targetWidth, float* out)
+	{
+		int x = 0;
+		for (; x + 2 <= targetWidth; x += 2)
+		{
+			const int* indices0 = indices + (size_t)x * taps;
+			const int* indices1 = indices0 + taps;
+			const float* weights0 = weights + (size_t)x * taps;
+			const float* weights1 = weights0 + taps;
+
+			__m256 sum = _mm256_setzero_ps();
+			for (int k = 0; k < taps; k++)
+			{
+				__m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(column + (size_t)indices0[k] * 4)),
+					_mm_loadu_ps(column + (size_t)indices1[k] * 4), 1);
+				__m256 weight = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weights0[k])), _mm_set1_ps(weights1[k]), 1);
+				sum = _mm256_fmadd_ps(weight, texels, sum);
+			}
+			_mm256_storeu_ps(out + (size_t)x * 4, sum);
+		}
+		for (; x < targetWidth; x++)
+		{
+			const int* texelIndices = indices + (size_t)x * taps;
+			const float* texelWeights = weights + (size_t)x * taps;
+
+			__m128 sum = _mm_setzero_ps();
+			for (int k = 0; k < taps; k++)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(texelWeights[k]), _mm_loadu_ps(column + (size_t)texelIndices[k] * 4)));
+			}
+			_mm_storeu_ps(out + (size_t)x * 4, sum);
+		}
+	}
+#endif
+
+	void encodeRow(const float* texels, int width, int channels, bool srgb, const ColourTables& tables, unsigned char* out)
+	{
+		const int* slots = channelSlots[channels - 1];
+		for (int x = 0; x < width; x++)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				int slot = slots[c];
+				float value = std::min(std::max(texels[(size_t)x * 4 + slot], 0.f), 1.f);
+				out[(size_t)x * channels + c] = srgb && slot != 3 ? tables.linearToSRGB[(int)(value * (encodeSize - 1) + 0.5f)] :
+					(unsigned char)(value * 255.f + 0.5f);
+			}
+		}
+	}
+}
+
+const char* MipGenerator::getFilterName(MipFilter filter)
+{
+	switch (filter)
+	{
+	case MipFilter::Box:
+		return "box";
+	case MipFilter::Kaiser:
+		return "Kaiser";
+	case MipFilter::Lanczos:
+		return "Lanczos";
+	}
+	return "unknown";
+}
+
+void MipGenerator::buildMipChain(const unsigned char* pixels, int width, int height, int channels, Ktx2Image& image,
+	MipFilter filter, bool srgb, ThreadPool* pool)
+{
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	// Drops any mapping image held, as well as old levels.
+	image = Ktx2Image();
+	image.vkFormat = Ktx2File::getRawFormat(channels);
+	image.width = width;
+	image.height = height;
+	image.levels.emplace_back(pixels, pixels + (size_t)width * height * channels);
+
+	const ColourTables& tables = getTables();
+	const float* decodeTable = srgb ? tables.srgbToLinear : tables.unormToFloat;
+	bool useAVX2 = SimdSupport::hasAVX2();
+
+	// Level 0 is decoded from RGBA8 a few rows at a time; every later level is kept as floats.
+	std::vector<unsigned char> expanded;
+	const unsigned char* sourceBytes = pixels;
+	if (channels != 4)
+	{
+		expanded.resize((size_t)width * height * 4);
+		for (size_t i = 0; i < (size_t)width * height; i++)
+		{
+			unsigned char* texel = &expanded[i * 4];
+			texel[0] = texel[1] = texel[2] = 0;
+			texel[3] = 255;
+			for (int c = 0; c < channels; c++)
+			{
+				texel[channelSlots[channels - 1][c]] = pixels[i * channels + c];
+			}
+		}
+		sourceBytes = expanded.data();
+	}
+
+	std::vector<float> source;
+	std::vector<float> target;
+
+	while (width > 1 || height > 1)
+	{
+		int targetWidth = std::max(1, width / 2);
+		int targetHeight = std::max(1, height / 2);
+		FilterTaps horizontal = buildTaps(filter, width, targetWidth);
+		FilterTaps vertical = buildTaps(filter, height, targetHeight);
+
+		target.resize((size_t)targetWidth * targetHeight * 4);
+		image.levels.emplace_back((size_t)targetWidth * targetHeight * channels);
+		unsigned char* packed = image.levels.back().data();
+		const float* sourceFloats = sourceBytes ? nullptr : source.data();
+
+		pool->parallelFor(targetHeight, 8, [&](size_t begin, size_t end)
+		{
+			int rowFloats = width * 4;
+			// Decoded level 0 rows, reused by the neighbouring target rows that share them.
+			std::vector<float> ring(sourceFloats ? 0 : (size_t)rowFloats * vertical.taps);
+			std::vector<int> ringRows(vertical.taps, INT_MIN);
+			std::vector<const float*> rows(vertical.taps);
+			std::vector<float> column(rowFloats);
+
+			for (size_t y = begin; y < end; y++)
+			{
+				for (int k = 0; k < vertical.taps; k++)
+				{
+					int unwrapped = vertical.first[y] + k;
+					int row = wrap(unwrapped, height);
+					if (sourceFloats)
+					{
+						rows[k] = sourceFloats + (size_t)row * rowFloats;
+						continue;
+					}
+
+					int slot = wrap(unwrapped, vertical.taps);
+					float* decoded = ring.data() + (size_t)slot * rowFloats;
+					if (ringRows[slot] != unwrapped)
+					{
+						const unsigned char* bytes = sourceBytes + (size_t)row * rowFloats;
+#if SIMD_X86
+						if (useAVX2)
+						{
+							decodeRowAVX2(bytes, rowFloats, decodeTable, decoded);
+						}
+						else
+#endif
+						{
+							decodeRowScalar(bytes, rowFloats, decodeTable, decoded);
+						}
+						ringRows[slot] = unwrapped;
+					}
+					rows[k] = decoded;
+				}
+
+				const float* rowWeights = vertical.weights.data() + y * vertical.taps;
+				float* out = target.data() + y * targetWidth * 4;
+#if SIMD_X86
+				if (useAVX2)
+				{
+					verticalAVX2(rows.data(), rowWeights, vertical.taps, rowFloats, column.data());
+					horizontalAVX2(column.data(), horizontal.indices.data(), horizontal.weights.data(), horizontal.taps, targetWidth, out);
+				}
+				else
+#endif
+				{
+					verticalScalar(rows.data(), rowWeights, vertical.taps, rowFloats, column.data());
+					horizontalScalar(column.data(), horizontal.indices.data(), horizontal.weights.data(), horizontal.taps, targetWidth, out);
+				}
+				encodeRow(out, targetWidth, channels, srgb, tables, packed + y * targetWidth * channels);
+			}
+		});
+
+		source.swap(target);
+		sourceBytes = nullptr;
+		width = targetWidth;
+		height = targetHeight;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "Ktx2File.h"
+#include "ThreadPool.h"
+
+enum class MipFilter
+{
+	// Averages each 2x2 block, like glGenerateMipmap.
+	Box,
+	// Kaiser windowed sinc: keeps more detail than box with little ringing.
+	Kaiser,
+	// Three lobe Lanczos: the sharpest, with slight halos on hard edges.
+	Lanczos,
+};
+
+// Builds mip chains on the CPU, so they can be cached with the texture rather than generated by
+// the driver on every load. Each level is filtered from the one above in linear light as floats,
+// with AVX2 where the CPU has it. Edges wrap, since every texture here repeats.
+namespace MipGenerator
+{
+	// Bumping this invalidates every cached texture built from these mips.
+	const GLuint generatorVersion = 1;
+
+	const char* getFilterName(MipFilter filter);
+
+	// Fills image with every level down to 1x1 in the uncompressed format matching channels. With
+	// srgb the colour channels are decoded to linear before filtering and encoded again after;
+	// alpha always stays linear. Rows are spread over pool.
+	void buildMipChain(const unsigned char* pixels, int width, int height, int channels, Ktx2Image& image,
+		MipFilter filter = MipFilter::Kaiser, bool srgb = true, ThreadPool* pool = nullptr);
+}
@@ -0,0 +1,210 @@
+#include "PixelBufferPool.h"
+
+PixelBufferPool::PixelBufferPool()
+{
+	persistent = false;
+
+	uploads = 0;
+	bytesUploaded = 0;
+	misses = 0;
+	regrows = 0;
+}
+
+bool PixelBufferPool::init(GLsizeiptr bufferSize, GLuint bufferCount)
+{
+	clearPixelBufferPool();
+	persistent = GLEW_ARB_buffer_storage != 0;
+
+	buffers.resize(bufferCount);
+	for (auto& buffer : buffers)
+	{
+		buffer = { 0, 0, nullptr, 0, false };
+		if (!createStorage(buffer, bufferSize))
+		{
+			clearPixelBufferPool();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PixelBufferPool::createStorage(PixelBuffer& buffer, GLsizeiptr size)
+{
+	deleteStorage(buffer);
+
+	glGenBuffers(1, &buffer.buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+	buffer.capacity = size;
+
+	if (persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+		buffer.data = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+
+		if (!buffer.data)
+		{
+			printf("ERROR::PixelBufferPool::createStorage failed to map %lld bytes\n", (long long)size);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return false;
+		}
+	}
+	else
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return true;
+}
+
+void PixelBufferPool::deleteStorage(PixelBuffer& buffer)
+{
+	if (buffer.fence)
+	{
+		glDeleteSync(buffer.fence);
+		buffer.fence = 0;
+	}
+
+	if (buffer.buffer == 0)
+	{
+		return;
+	}
+
+	if (buffer.data)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		buffer.data = nullptr;
+	}
+
+	glDeleteBuffers(1, &buffer.buffer);
+	buffer.buffer = 0;
+	buffer.capacity = 0;
+}
+
+bool PixelBufferPool::isIdle(PixelBuffer& buffer)
+{
+	if (buffer.inUse)
+	{
+		return false;
+	}
+
+	if (buffer.fence)
+	{
+		if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			return false;
+		}
+		glDeleteSync(buffer.fence);
+		buffer.fence = 0;
+	}
+	return true;
+}
+
+PixelBufferPool::PixelBuffer* PixelBufferPool::acquire(GLsizeiptr size)
+{
+	// The smallest idle buffer that fits, so big ones stay free for big uploads.
+	PixelBuffer* chosen = nullptr;
+	PixelBuffer* idle = nullptr;
+	for (auto& buffer : buffers)
+	{
+		if (!isIdle(buffer))
+		{
+			continue;
+		}
+
+		idle = &buffer;
+		if (buffer.capacity >= size && (!chosen || buffer.capacity < chosen->capacity))
+		{
+			chosen = &buffer;
+		}
+	}
+
+	if (!chosen)
+	{
+		if (!idle)
+		{
+			misses++;
+			return nullptr;
+		}
+
+		chosen = idle;
+		if (!createStorage(*chosen, size))
+		{
+			return nullptr;
+		}
+		regrows++;
+	}
+
+	if (!persistent)
+	{
+		// The fence has passed, so nothing can still be reading the old contents.
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, chosen->buffer);
+		chosen->data = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, chosen->capacity,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		if (!chosen->data)
+		{
+			printf("ERROR::PixelBufferPool::acquire failed to map %lld bytes\n", (long long)chosen->capacity);
+			return nullptr;
+		}
+	}
+
+	chosen->inUse = true;
+	return chosen;
+}
+
+void PixelBufferPool::beginUpload(PixelBuffer* buffer)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->buffer);
+	if (!persistent)
+	{
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		buffer->data = nullptr;
+	}
+}
+
+void PixelBufferPool::endUpload(PixelBuffer* buffer, GLsizeiptr bytes)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	buffer->inUse = false;
+
+	uploads++;
+	bytesUploaded += bytes;
+}
+
+void PixelBufferPool::cancel(PixelBuffer* buffer)
+{
+	if (!persistent && buffer->data)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		buffer->data = nullptr;
+	}
+	buffer->inUse = false;
+}
+
+void PixelBufferPool::printStats()
+{
+	printf("PixelBufferPool: %zu %s buffers, %llu uploads, %.2f MB uploaded, %llu times all in flight, %llu regrows\n",
+		buffers.size(), persistent ? "persistent" : "mapped per upload", uploads, bytesUploaded / (1024.0 * 1024.0), misses, regrows);
+}
+
+void PixelBufferPool::clearPixelBufferPool()
+{
+	for (auto& buffer : buffers)
+	{
+		deleteStorage(buffer);
+	}
+	buffers.clear();
+}
+
+PixelBufferPool::~PixelBufferPool()
+{
+	clearPixelBufferPool();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+// Staging buffers for texture uploads. Each is a pixel unpack buffer mapped for writing, so texels
+// can be written from any thread straight into memory the driver copies from without blocking;
+// glTexSubImage2D and friends then take offsets into it instead of client pointers. A buffer is
+// fenced after its uploads and only handed out again once the GPU has passed that fence. With GL
+// 4.4 buffer storage the buffers stay persistently mapped; otherwise each is mapped when acquired
+// and unmapped before its uploads. Everything but writing to data is render thread only.
+class PixelBufferPool
+{
+public:
+	struct PixelBuffer
+	{
+		GLuint buffer;
+		GLsizeiptr capacity;
+		// Writable from acquire() until beginUpload().
+		unsigned char* data;
+		GLsync fence;
+		bool inUse;
+	};
+
+	PixelBufferPool();
+
+	bool init(GLsizeiptr bufferSize, GLuint bufferCount);
+	bool isPersistent() { return persistent; }
+
+	// Returns a mapped buffer holding at least size bytes, regrowing a free one if none is big
+	// enough, or nullptr while every buffer is still in flight.
+	PixelBuffer* acquire(GLsizeiptr size);
+	// Binds buffer to GL_PIXEL_UNPACK_BUFFER; pixel pointers passed to GL are offsets into it until
+	// endUpload().
+	void beginUpload(PixelBuffer* buffer);
+	// Unbinds buffer and fences the uploads made from it.
+	void endUpload(PixelBuffer* buffer, GLsizeiptr bytes);
+	// Hands back an acquired buffer that was never uploaded from.
+	void cancel(PixelBuffer* buffer);
+
+	unsigned long long getUploads() { return uploads; }
+	unsigned long long getBytesUploaded() { return bytesUploaded; }
+	void printStats();
+
+	void clearPixelBufferPool();
+
+	~PixelBufferPool();
+
+private:
+	// Never resized after init(), so PixelBuffer pointers stay valid.
+	std::vector<PixelBuffer> buffers;
+	bool persistent;
+
+	unsigned long long uploads;
+	unsigned long long bytesUploaded;
+	unsigned long long misses;
+	unsigned long long regrows;
+
+	bool createStorage(PixelBuffer& buffer, GLsizeiptr size);
+	void deleteStorage(PixelBuffer& buffer);
+	bool isIdle(PixelBuffer& buffer);
+
+	PixelBufferPool(const PixelBufferPool&) = delete;
+	PixelBufferPool& operator=(const PixelBufferPool&) = delete;
+};
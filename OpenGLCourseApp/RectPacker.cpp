@@ -0,0 +1,125 @@
+#include "RectPacker.h"
+
+#include <algorithm>
+
+RectPacker::RectPacker()
+{
+	width = 0;
+	height = 0;
+	usedArea = 0;
+}
+
+RectPacker::RectPacker(GLuint width, GLuint height)
+{
+	this->width = width;
+	this->height = height;
+	usedArea = 0;
+	skyline.push_back({ 0, 0, width });
+}
+
+bool RectPacker::insert(GLuint rectWidth, GLuint rectHeight, GLuint& x, GLuint& y)
+{
+	size_t bestNode = skyline.size();
+	GLuint bestTop = UINT32_MAX;
+	GLuint bestWidth = UINT32_MAX;
+
+	for (size_t i = 0; i < skyline.size(); i++)
+	{
+		GLuint nodeY = 0;
+		if (!fitsAt(i, rectWidth, rectHeight, nodeY))
+		{
+			continue;
+		}
+
+		GLuint top = nodeY + rectHeight;
+		if (top < bestTop || (top == bestTop && skyline[i].width < bestWidth))
+		{
+			bestNode = i;
+			bestTop = top;
+			bestWidth = skyline[i].width;
+			y = nodeY;
+		}
+	}
+
+	if (bestNode == skyline.size())
+	{
+		return false;
+	}
+
+	x = skyline[bestNode].x;
+	skyline.insert(skyline.begin() + bestNode, { x, y + rectHeight, rectWidth });
+
+	// Trim or drop the nodes the new one now covers.
+	size_t next = bestNode + 1;
+	while (next < skyline.size())
+	{
+		GLuint coveredEnd = x + rectWidth;
+		if (skyline[next].x >= coveredEnd)
+		{
+			break;
+		}
+
+		GLuint nodeEnd = skyline[next].x + skyline[next].width;
+		if (nodeEnd <= coveredEnd)
+		{
+			skyline.erase(skyline.begin() + next);
+			continue;
+		}
+
+		skyline[next].width = nodeEnd - coveredEnd;
+		skyline[next].x = coveredEnd;
+		break;
+	}
+
+	// Neighbours at the same height become one node.
+	for (size_t i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	usedArea += (GLuint64)rectWidth * rectHeight;
+	return true;
+}
+
+GLfloat RectPacker::getOccupancy()
+{
+	if (width == 0 || height == 0)
+	{
+		return 0.f;
+	}
+	return (GLfloat)((double)usedArea / ((double)width * height));
+}
+
+RectPacker::~RectPacker()
+{
+}
+
+bool RectPacker::fitsAt(size_t nodeIndex, GLuint rectWidth, GLuint rectHeight, GLuint& y)
+{
+	if (skyline[nodeIndex].x + rectWidth > width)
+	{
+		return false;
+	}
+
+	// The rect rests on the highest node it spans.
+	y = 0;
+	GLuint remaining = rectWidth;
+	for (size_t i = nodeIndex; remaining > 0; i++)
+	{
+		y = std::max(y, skyline[i].y);
+		if (y + rectHeight > height)
+		{
+			return false;
+		}
+		remaining -= std::min(remaining, skyline[i].width);
+	}
+	return true;
+}
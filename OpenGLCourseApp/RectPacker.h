@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+// Skyline packer for atlas pages: each rect goes where its top edge ends up lowest, ties broken by
+// the narrower gap so long thin strips of waste are rare. Rects are never removed.
+class RectPacker
+{
+public:
+	RectPacker();
+	RectPacker(GLuint width, GLuint height);
+
+	bool insert(GLuint rectWidth, GLuint rectHeight, GLuint& x, GLuint& y);
+
+	GLuint getWidth() { return width; }
+	GLuint getHeight() { return height; }
+	// Fraction of the page covered by inserted rects.
+	GLfloat getOccupancy();
+
+	~RectPacker();
+
+private:
+	struct SkylineNode
+	{
+		GLuint x;
+		GLuint y;
+		GLuint width;
+	};
+
+	GLuint width;
+	GLuint height;
+	GLuint64 usedArea;
+	std::vector<SkylineNode> skyline;
+
+	bool fitsAt(size_t nodeIndex, GLuint rectWidth, GLuint rectHeight, GLuint& y);
+};
@@ -1,5 +1,7 @@
 #include "Shader.h"
 
+#include <algorithm>
+
 Shader::Shader()
 {
 	shaderProgram = 0;
@@ -13,6 +15,15 @@ Shader::Shader()
 	uniformEyePosition = 0;
 	uniformSpecularIntensity = 0;
 	uniformShininess = 0;
+	uniformPositionScale = 0;
+	uniformPositionOffset = 0;
+	uniformTextureIndex = 0;
+
+	for (GLuint i = 0; i < maxMaterials; i++)
+	{
+		uniformMaterialSpecularIntensity[i] = 0;
+		uniformMaterialShininess[i] = 0;
+	}
 }
 
 void Shader::createFromString(const char* vertexCode, const char* fragmentCode)
@@ -33,6 +44,19 @@ void Shader::createFromFiles(const char* vertexLocation, const char* fragmentLoc
 
 std::string Shader::readFile(const char* fileLocation)
 {
+	std::vector<std::filesystem::path> includeStack;
+	return readFile(fileLocation, includeStack);
+}
+
+std::string Shader::readFile(const char* fileLocation, std::vector<std::filesystem::path>& includeStack)
+{
+	std::filesystem::path location = std::filesystem::path(fileLocation).lexically_normal();
+	if (std::find(includeStack.begin(), includeStack.end(), location) != includeStack.end())
+	{
+		printf("ERROR::Shader::readFile %s includes itself through %s\n", fileLocation, includeStack.back().string().c_str());
+		return "";
+	}
+
 	std::string content;
 	std::ifstream fileStream(fileLocation, std::ios::in);
 
@@ -42,12 +66,28 @@ std::string Shader::readFile(const char* fileLocation)
 		return "";
 	}
 
+	includeStack.push_back(location);
 	std::string line = "";
 	while (!fileStream.eof())
 	{
 		std::getline(fileStream, line);
+
+		// #include "file" pastes in another file, found beside this one.
+		size_t start = line.find_first_not_of(" \t");
+		if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+		{
+			size_t open = line.find('"', start);
+			size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if (close != std::string::npos)
+			{
+				std::filesystem::path included = location.parent_path() / line.substr(open + 1, close - open - 1);
+				content.append(readFile(included.string().c_str(), includeStack));
+				continue;
+			}
+		}
 		content.append(line + "\n");
 	}
+	includeStack.pop_back();
 
 	fileStream.close();
 	return content;
@@ -103,6 +143,31 @@ GLuint Shader::getShininessLocation()
 	return uniformShininess;
 }
 
+GLuint Shader::getPositionScaleLocation()
+{
+	return uniformPositionScale;
+}
+
+GLuint Shader::getPositionOffsetLocation()
+{
+	return uniformPositionOffset;
+}
+
+GLuint Shader::getMaterialSpecularIntensityLocation(GLuint index)
+{
+	return uniformMaterialSpecularIntensity[index];
+}
+
+GLuint Shader::getMaterialShininessLocation(GLuint index)
+{
+	return uniformMaterialShininess[index];
+}
+
+GLuint Shader::getTextureIndexLocation()
+{
+	return uniformTextureIndex;
+}
+
 void Shader::useShader()
 {
 	glUseProgram(shaderProgram);
@@ -150,6 +215,21 @@ void Shader::compileShader(const char* vertexCode, const char* fragmentCode)
 		return;
 	}
 
+	// Validation fails while theTexture and textureArray both sample unit 0, so point them apart first.
+	GLint textureArray = glGetUniformLocation(shaderProgram, "textureArray");
+	if (textureArray != -1)
+	{
+		glUseProgram(shaderProgram);
+		glUniform1i(textureArray, textureArrayUnit);
+		glUseProgram(0);
+	}
+
+	GLuint textureSlots = glGetUniformBlockIndex(shaderProgram, "TextureSlots");
+	if (textureSlots != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(shaderProgram, textureSlots, textureSlotBinding);
+	}
+
 	glValidateProgram(shaderProgram);
 	glGetProgramiv(shaderProgram, GL_VALIDATE_STATUS, &result);
 	if (!result)
@@ -169,6 +249,18 @@ void Shader::compileShader(const char* vertexCode, const char* fragmentCode)
 	uniformSpecularIntensity = glGetUniformLocation(shaderProgram, "material.specularIntensity");
 	uniformShininess = glGetUniformLocation(shaderProgram, "material.shininess");
 	uniformEyePosition = glGetUniformLocation(shaderProgram, "eyePosition");
+	uniformPositionScale = glGetUniformLocation(shaderProgram, "positionScale");
+	uniformPositionOffset = glGetUniformLocation(shaderProgram, "positionOffset");
+	uniformTextureIndex = glGetUniformLocation(shaderProgram, "textureIndex");
+
+	for (GLuint i = 0; i < maxMaterials; i++)
+	{
+		char locationName[64];
+		snprintf(locationName, sizeof(locationName), "materials[%u].specularIntensity", i);
+		uniformMaterialSpecularIntensity[i] = glGetUniformLocation(shaderProgram, locationName);
+		snprintf(locationName, sizeof(locationName), "materials[%u].shininess", i);
+		uniformMaterialShininess[i] = glGetUniformLocation(shaderProgram, locationName);
+	}
 }
 
 void Shader::addShader(GLuint theProgram, const char* shaderCode, GLenum shaderType)
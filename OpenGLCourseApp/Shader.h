@@ -4,17 +4,27 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <filesystem>
+#include <vector>
 
 #include <GL\glew.h>
 
 class Shader
 {
 public:
+	// Size of the materials array in Shaders/instanced.frag.
+	static const GLuint maxMaterials = 8;
+	// Where shaders find TextureManager's slot table and texture array. The array has its own unit so
+	// it never shares one with theTexture.
+	static const GLuint textureSlotBinding = 1;
+	static const GLuint textureArrayUnit = 1;
+
 	Shader();
 
 	void createFromString(const char* vertexCode, const char* fragmentCode);
 	void createFromFiles(const char* vertexLocation, const char* fragmentLocation);
 	
+	// Expands #include "file" lines, relative to the including file.
 	std::string readFile(const char* fileLocation);
 	
 	GLuint getProjectionLocation();
@@ -27,6 +37,11 @@ public:
 	GLuint getEyePositionLocation();
 	GLuint getSpecularIntensityLocation();
 	GLuint getShininessLocation();
+	GLuint getPositionScaleLocation();
+	GLuint getPositionOffsetLocation();
+	GLuint getMaterialSpecularIntensityLocation(GLuint index);
+	GLuint getMaterialShininessLocation(GLuint index);
+	GLuint getTextureIndexLocation();
 
 	void useShader();
 	void clearShader();
@@ -45,8 +60,15 @@ private:
 	GLuint uniformEyePosition;
 	GLuint uniformSpecularIntensity;
 	GLuint uniformShininess;
+	GLuint uniformPositionScale;
+	GLuint uniformPositionOffset;
+	GLuint uniformMaterialSpecularIntensity[maxMaterials];
+	GLuint uniformMaterialShininess[maxMaterials];
+	GLuint uniformTextureIndex;
 
 	void compileShader(const char* vertexCode, const char* fragmentCode);
 	void addShader(GLuint theProgram, const char* shaderCode, GLenum shaderType);
+	// includeStack holds the files being expanded, so a cycle is reported instead of recursing forever.
+	std::string readFile(const char* fileLocation, std::vector<std::filesystem::path>& includeStack);
 };
 
@@ -0,0 +1,54 @@
+#version 430
+#extension GL_ARB_bindless_texture : require
+
+in vec2 TexCoord;
+in vec3 Normal;
+in vec3 FragPos;
+flat in float SpecularIntensity;
+flat in float Shininess;
+flat in uint TextureIndex;
+
+out vec4 colour;
+
+struct DirectionalLight 
+{
+	vec3 colour;
+	float ambientIntensity;
+	vec3 direction;
+	float diffuseIntensity;
+};
+
+// Resident ARB_bindless_texture handles, one per BindlessTextureTable entry.
+layout (std430, binding = 2) readonly buffer TextureHandles
+{
+	uvec2 textureHandles[];
+};
+
+uniform DirectionalLight directionalLight;
+
+uniform vec3 eyePosition;
+
+void main()
+{
+	vec4 ambientColour = vec4(directionalLight.colour, 1.0f) * directionalLight.ambientIntensity;
+	
+	float diffuseFactor = max(dot(normalize(Normal), normalize(directionalLight.direction)), 0.0f);
+	vec4 diffuseColour = vec4(directionalLight.colour, 1.0f) * directionalLight.diffuseIntensity * diffuseFactor;
+	
+	vec4 specularColour = vec4(0, 0, 0, 0);
+	
+	if(diffuseFactor > 0.0f)
+	{
+		vec3 fragToEye = normalize(eyePosition - FragPos);
+		vec3 reflectedVertex = normalize(reflect(directionalLight.direction, normalize(Normal)));
+		
+		float specularFactor = dot(fragToEye, reflectedVertex);
+		if(specularFactor > 0.0f)
+		{
+			specularFactor = pow(specularFactor, Shininess);
+			specularColour = vec4(directionalLight.colour * SpecularIntensity * specularFactor, 1.0f);
+		}
+	}
+	
+	colour = texture(sampler2D(textureHandles[TextureIndex]), TexCoord) * (ambientColour + diffuseColour + specularColour);
+}
\ No newline at end of file
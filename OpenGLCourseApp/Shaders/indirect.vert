@@ -0,0 +1,47 @@
+#version 430
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 tex;
+layout (location = 2) in vec3 norm;
+layout (location = 15) in uint drawId;
+
+struct DrawData
+{
+	mat4 model;
+	vec4 positionScale;
+	vec4 positionOffset;
+	uint textureIndex;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer
+{
+	DrawData draws[];
+};
+
+out vec2 TexCoord;
+out vec3 Normal;
+out vec3 FragPos;
+flat out float SpecularIntensity;
+flat out float Shininess;
+flat out uint TextureIndex;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+void main()
+{
+	DrawData draw = draws[drawId];
+	vec3 position = pos * draw.positionScale.xyz + draw.positionOffset.xyz;
+	
+	gl_Position = projection * view * draw.model * vec4(position, 1.0);
+	
+	TexCoord = tex;
+	
+	Normal = mat3(transpose(inverse(draw.model))) * norm;
+	
+	FragPos = (draw.model * vec4(position, 1.0)).xyz;
+	
+	SpecularIntensity = draw.positionScale.w;
+	Shininess = draw.positionOffset.w;
+	TextureIndex = draw.textureIndex;
+}
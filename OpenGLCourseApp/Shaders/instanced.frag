@@ -0,0 +1,57 @@
+#version 330
+
+in vec2 TexCoord;
+in vec3 Normal;
+in vec3 FragPos;
+flat in uint MaterialIndex;
+flat in uint TextureIndex;
+
+out vec4 colour;
+
+struct DirectionalLight 
+{
+	vec3 colour;
+	float ambientIntensity;
+	vec3 direction;
+	float diffuseIntensity;
+};
+
+struct Material
+{
+	float specularIntensity;
+	float shininess;
+};
+
+uniform DirectionalLight directionalLight;
+uniform Material materials[8];
+
+uniform vec3 eyePosition;
+
+#include "textureSlots.glsl"
+
+void main()
+{
+	Material material = materials[MaterialIndex];
+	
+	vec4 ambientColour = vec4(directionalLight.colour, 1.0f) * directionalLight.ambientIntensity;
+	
+	float diffuseFactor = max(dot(normalize(Normal), normalize(directionalLight.direction)), 0.0f);
+	vec4 diffuseColour = vec4(directionalLight.colour, 1.0f) * directionalLight.diffuseIntensity * diffuseFactor;
+	
+	vec4 specularColour = vec4(0, 0, 0, 0);
+	
+	if(diffuseFactor > 0.0f)
+	{
+		vec3 fragToEye = normalize(eyePosition - FragPos);
+		vec3 reflectedVertex = normalize(reflect(directionalLight.direction, normalize(Normal)));
+		
+		float specularFactor = dot(fragToEye, reflectedVertex);
+		if(specularFactor > 0.0f)
+		{
+			specularFactor = pow(specularFactor, material.shininess);
+			specularColour = vec4(directionalLight.colour * material.specularIntensity * specularFactor, 1.0f);
+		}
+	}
+	
+	colour = sampleTextureSlot(TextureIndex, TexCoord) * (ambientColour + diffuseColour + specularColour);
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#version 330
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 tex;
+layout (location = 2) in vec3 norm;
+layout (location = 4) in mat4 instanceModel;
+layout (location = 8) in uvec2 instanceInfo;
+
+out vec2 TexCoord;
+out vec3 Normal;
+out vec3 FragPos;
+flat out uint MaterialIndex;
+flat out uint TextureIndex;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+void main()
+{
+	vec3 position = pos * positionScale + positionOffset;
+	
+	gl_Position = projection * view * instanceModel * vec4(position, 1.0);
+	
+	TexCoord = tex;
+	
+	Normal = mat3(transpose(inverse(instanceModel))) * norm;
+	
+	FragPos = (instanceModel * vec4(position, 1.0)).xyz;
+	
+	MaterialIndex = instanceInfo.x;
+	TextureIndex = instanceInfo.y;
+}
\ No newline at end of file
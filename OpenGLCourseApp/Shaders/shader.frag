@@ -24,9 +24,13 @@ struct Material
 uniform sampler2D theTexture;
 uniform DirectionalLight directionalLight;
 uniform Material material;
+// -1 samples theTexture, anything else is a TextureManager slot.
+uniform int textureIndex;
 
 uniform vec3 eyePosition;
 
+#include "textureSlots.glsl"
+
 void main()
 {
 	vec4 ambientColour = vec4(directionalLight.colour, 1.0f) * directionalLight.ambientIntensity;
@@ -49,5 +53,6 @@ void main()
 		}
 	}
 	
-	colour = texture(theTexture, TexCoord) * (ambientColour + diffuseColour + specularColour);
+	vec4 textureColour = textureIndex < 0 ? texture(theTexture, TexCoord) : sampleTextureSlot(uint(textureIndex), TexCoord);
+	colour = textureColour * (ambientColour + diffuseColour + specularColour);
 }
\ No newline at end of file
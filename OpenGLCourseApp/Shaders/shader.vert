@@ -12,15 +12,19 @@ out vec3 FragPos;
 uniform mat4 model;
 uniform mat4 projection;
 uniform mat4 view;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(pos, 1.0);
-	vCol = vec4(clamp(pos, 0.0f, 1.0f), 1.0f);
+	vec3 position = pos * positionScale + positionOffset;
+	
+	gl_Position = projection * view * model * vec4(position, 1.0);
+	vCol = vec4(clamp(position, 0.0f, 1.0f), 1.0f);
 	
 	TexCoord = tex;
 	
 	Normal = mat3(transpose(inverse(model))) * norm;
 	
-	FragPos = (model * vec4(pos, 1.0)).xyz; 
+	FragPos = (model * vec4(position, 1.0)).xyz; 
 }
\ No newline at end of file
@@ -0,0 +1,21 @@
+// TextureManager's slot table and texture array, shared by every shader that draws its slots.
+struct TextureSlot
+{
+	vec4 rect;
+	uint layer;
+};
+
+layout (std140) uniform TextureSlots
+{
+	TextureSlot textureSlots[256];
+};
+
+uniform sampler2DArray textureArray;
+
+vec4 sampleTextureSlot(uint index, vec2 uv)
+{
+	TextureSlot slot = textureSlots[index];
+	// Atlas entries wrap by hand; gradients from the unwrapped coordinates keep fract() seamless.
+	vec2 scaled = uv * slot.rect.zw;
+	return textureGrad(textureArray, vec3(slot.rect.xy + fract(uv) * slot.rect.zw, float(slot.layer)), dFdx(scaled), dFdy(scaled));
+}
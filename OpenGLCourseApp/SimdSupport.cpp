@@ -0,0 +1,48 @@
+#include "SimdSupport.h"
+
+#if SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	bool detectAVX2()
+	{
+#if SIMD_X86 && defined(_MSC_VER)
+		int info[4] = { 0 };
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		if (!osxsave || !avx || !fma)
+		{
+			return false;
+		}
+
+		if ((_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif SIMD_X86
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+		return false;
+#endif
+	}
+}
+
+bool SimdSupport::hasAVX2()
+{
+	static bool supported = detectAVX2();
+	return supported;
+}
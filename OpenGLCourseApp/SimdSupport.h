@@ -0,0 +1,20 @@
+#pragma once
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+// MSVC compiles AVX2 intrinsics anywhere; GCC and Clang need the function tagged.
+#if defined(_MSC_VER)
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+namespace SimdSupport
+{
+	bool hasAVX2();
+}
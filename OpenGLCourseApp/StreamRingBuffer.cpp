@@ -0,0 +1,203 @@
+#include "StreamRingBuffer.h"
+
+#include <string.h>
+#include <algorithm>
+
+StreamRingBuffer::StreamRingBuffer()
+{
+	streamBuffer = 0;
+	regionSize = 0;
+	alignment = 16;
+	head = 0;
+	region = 0;
+	mappedData = nullptr;
+
+	for (GLuint i = 0; i < frameCount; i++)
+	{
+		fences[i] = 0;
+	}
+
+	bytesStreamed = 0;
+	fenceWaits = 0;
+	resizes = 0;
+}
+
+bool StreamRingBuffer::init(GLsizeiptr regionSize)
+{
+	// Offsets handed to glBindBufferRange must respect the binding point alignment.
+	GLint uniformAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	alignment = std::max<GLsizeiptr>(alignment, uniformAlignment);
+
+	if (GLEW_ARB_shader_storage_buffer_object)
+	{
+		GLint storageAlignment = 0;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		alignment = std::max<GLsizeiptr>(alignment, storageAlignment);
+	}
+
+	return createStorage(regionSize);
+}
+
+bool StreamRingBuffer::createStorage(GLsizeiptr size)
+{
+	if (streamBuffer != 0)
+	{
+		if (mappedData)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, streamBuffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			mappedData = nullptr;
+		}
+		glDeleteBuffers(1, &streamBuffer);
+	}
+
+	regionSize = (size + alignment - 1) / alignment * alignment;
+	head = 0;
+
+	glGenBuffers(1, &streamBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, streamBuffer);
+
+	if (GLEW_ARB_buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * frameCount, nullptr, flags);
+		mappedData = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * frameCount, flags);
+
+		if (!mappedData)
+		{
+			// Immutable storage can't take glBufferSubData either, so drop the buffer entirely.
+			printf("ERROR::StreamRingBuffer::createStorage failed to map %lld bytes\n", (long long)(regionSize * frameCount));
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			glDeleteBuffers(1, &streamBuffer);
+			streamBuffer = 0;
+			regionSize = 0;
+			return false;
+		}
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, regionSize * frameCount, nullptr, GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return true;
+}
+
+void StreamRingBuffer::waitForRegion(GLuint index)
+{
+	if (!fences[index])
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(fences[index], 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		fenceWaits++;
+		do
+		{
+			result = glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+
+	glDeleteSync(fences[index]);
+	fences[index] = 0;
+}
+
+void StreamRingBuffer::beginFrame()
+{
+	region = (region + 1) % frameCount;
+	head = 0;
+	waitForRegion(region);
+}
+
+bool StreamRingBuffer::reserve(GLsizeiptr size)
+{
+	if (streamBuffer != 0 && head + size <= regionSize)
+	{
+		return true;
+	}
+
+	for (GLuint i = 0; i < frameCount; i++)
+	{
+		waitForRegion(i);
+	}
+
+	resizes++;
+	return createStorage(std::max((head + size) * 2, regionSize * 2));
+}
+
+GLintptr StreamRingBuffer::write(const void* data, GLsizeiptr size)
+{
+	if (streamBuffer == 0 || head + size > regionSize)
+	{
+		return -1;
+	}
+
+	GLintptr offset = region * regionSize + head;
+	if (mappedData)
+	{
+		memcpy(mappedData + offset, data, size);
+	}
+	else
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, streamBuffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	head = std::min(regionSize, (head + size + alignment - 1) / alignment * alignment);
+	bytesStreamed += size;
+	return offset;
+}
+
+void StreamRingBuffer::endFrame()
+{
+	if (fences[region])
+	{
+		glDeleteSync(fences[region]);
+	}
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamRingBuffer::printStats(const char* name)
+{
+	printf("StreamRingBuffer %s: %s, %lld byte regions, %.2f MB streamed, %llu fence waits, %llu resizes\n",
+		name, mappedData ? "persistent" : "buffer sub data", (long long)regionSize, bytesStreamed / (1024.0 * 1024.0), fenceWaits, resizes);
+}
+
+void StreamRingBuffer::clearStreamRingBuffer()
+{
+	for (GLuint i = 0; i < frameCount; i++)
+	{
+		if (fences[i])
+		{
+			glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+	}
+
+	if (mappedData)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, streamBuffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		mappedData = nullptr;
+	}
+
+	if (streamBuffer != 0)
+	{
+		glDeleteBuffers(1, &streamBuffer);
+		streamBuffer = 0;
+	}
+
+	regionSize = 0;
+	head = 0;
+	region = 0;
+}
+
+StreamRingBuffer::~StreamRingBuffer()
+{
+	clearStreamRingBuffer();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <GL\glew.h>
+
+// One buffer split into frameCount regions that are written round robin, one per frame. Each region
+// is fenced once the frame's draws are queued and only reused after the GPU has passed that fence.
+// With GL 4.4 buffer storage the buffer stays persistently mapped and writes are plain memcpy;
+// otherwise writes fall back to glBufferSubData into the same fenced regions.
+class StreamRingBuffer
+{
+public:
+	static const GLuint frameCount = 3;
+
+	StreamRingBuffer();
+
+	bool init(GLsizeiptr regionSize);
+	bool isPersistent() { return mappedData != nullptr; }
+
+	// Moves to the next region, waiting for the GPU if it is still reading it.
+	void beginFrame();
+	// Makes sure size bytes fit in the current region, growing the buffer if they do not. Growing
+	// waits for every region, so size the buffer so this is rare. Returns false if the buffer could
+	// not be created, after which every write fails until a later reserve succeeds.
+	bool reserve(GLsizeiptr size);
+	// Copies data into the current region and returns its offset from the start of the buffer, or
+	// -1 if the region is full or there is no buffer.
+	GLintptr write(const void* data, GLsizeiptr size);
+	// Fences everything written since beginFrame().
+	void endFrame();
+
+	GLuint getBuffer() { return streamBuffer; }
+	GLsizeiptr getRegionSize() { return regionSize; }
+	GLsizeiptr getAlignment() { return alignment; }
+
+	unsigned long long getBytesStreamed() { return bytesStreamed; }
+	unsigned long long getFenceWaits() { return fenceWaits; }
+	unsigned long long getResizes() { return resizes; }
+	void printStats(const char* name);
+
+	void clearStreamRingBuffer();
+
+	~StreamRingBuffer();
+
+private:
+	GLuint streamBuffer;
+	GLsizeiptr regionSize;
+	GLsizeiptr alignment;
+	GLsizeiptr head;
+	GLuint region;
+	GLsync fences[frameCount];
+	unsigned char* mappedData;
+
+	unsigned long long bytesStreamed;
+	unsigned long long fenceWaits;
+	unsigned long long resizes;
+
+	bool createStorage(GLsizeiptr size);
+	void waitForRegion(GLuint index);
+};
@@ -1,5 +1,27 @@
 #include "Texture.h"
 
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+
+GLuint Texture::placeholderID = 0;
+bool Texture::compressionEnabled = true;
+MipFilter Texture::mipFilter = MipFilter::Kaiser;
+bool Texture::mipsInLinearLight = true;
+PixelBufferPool* Texture::pixelBufferPool = nullptr;
+const char* Texture::textureCacheDirectory = "Cache/Textures";
+
+namespace
+{
+	double millisecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
 Texture::Texture()
 {
 	textureID = 0;
@@ -7,6 +29,14 @@ Texture::Texture()
 	height = 0;
 	bitDepth = 0;
 	fileLocation = (char*)"";
+	decodeMilliseconds = 0.0;
+	uploadMilliseconds = 0.0;
+	memoryBytes = 0;
+	srgb = false;
+	streamRequested = false;
+	residentLevel = 0;
+	residencyPending = false;
+	staging = StagedUpload();
 }
 
 Texture::Texture(char* fileLoc)
@@ -16,37 +46,575 @@ Texture::Texture(char* fileLoc)
 	height = 0;
 	bitDepth = 0;
 	fileLocation = fileLoc;
+	decodeMilliseconds = 0.0;
+	uploadMilliseconds = 0.0;
+	memoryBytes = 0;
+	srgb = false;
+	streamRequested = false;
+	residentLevel = 0;
+	residencyPending = false;
+	staging = StagedUpload();
 }
 
 void Texture::loadTexture()
 {
-	unsigned char* texData = stbi_load(fileLocation, &width, &height, &bitDepth, 0);
-	if (!texData)
+	finishLoad(decodeImage(fileLocation), "loadTexture", false);
+}
+
+void Texture::loadTextureDeferred()
+{
+	std::string location = fileLocation;
+	pendingImage = ThreadPool::getShared().submit([location]()
+	{
+		return decodeImage(location);
+	}).share();
+}
+
+void Texture::loadTextureStreamed()
+{
+	streamRequested = true;
+
+	std::string location = fileLocation;
+	pendingImage = ThreadPool::getShared().submit([location]()
+	{
+		return decodeImage(location);
+	}).share();
+}
+
+GLuint Texture::getLevelCount()
+{
+	return streamLevels ? streamLevels->getLevelCount() : 0;
+}
+
+size_t Texture::getLevelBytes(GLuint level)
+{
+	return streamLevels && level < streamLevels->getLevelCount() ? streamLevels->getLevelBytes(level) : 0;
+}
+
+GLuint Texture::getTailLevel()
+{
+	GLuint level = 0;
+	while (level + 1 < getLevelCount() && (GLuint)std::max(width >> level, height >> level) > streamTailSize)
+	{
+		level++;
+	}
+	return level;
+}
+
+bool Texture::setResidentLevel(GLuint level, UploadThread* uploader)
+{
+	if (!streamLevels || residencyPending || level >= getLevelCount() || level == residentLevel)
+	{
+		return false;
+	}
+
+	GLuint sourceLevel = residentLevel;
+	residentLevel = level;
+	memoryBytes = 0;
+	for (GLuint i = level; i < getLevelCount(); i++)
+	{
+		memoryBytes += getLevelBytes(i);
+	}
+
+	if (!uploader && !pixelBufferPool)
+	{
+		GLuint texture = uploadLevels(*streamLevels, level, srgb, textureID, sourceLevel);
+		glDeleteTextures(1, &textureID);
+		textureID = texture;
+		return true;
+	}
+
+	if (!uploader)
+	{
+		residencyPending = true;
+		beginStaging(streamLevels, level, sourceLevel);
+		return true;
+	}
+
+	// The old texture stays bound, and is the copy source, until the new one is published.
+	residencyPending = true;
+	std::shared_ptr<Ktx2Image> levels = streamLevels;
+	std::shared_ptr<GLuint> texture = std::make_shared<GLuint>(0);
+	GLuint source = textureID;
+	bool srgb = this->srgb;
+	size_t bytes = level < sourceLevel ? memoryBytes : 0;
+
+	uploader->submit([levels, texture, level, srgb, source, sourceLevel, bytes]() -> size_t
+	{
+		*texture = uploadLevels(*levels, level, srgb, source, sourceLevel);
+		return bytes;
+	},
+	[this, texture]()
+	{
+		glDeleteTextures(1, &textureID);
+		textureID = *texture;
+		residencyPending = false;
+	});
+	return true;
+}
+
+void Texture::beginStaging(const std::shared_ptr<Ktx2Image>& levels, GLuint firstLevel, GLuint copySourceLevel)
+{
+	GLuint endLevel = getUploadEndLevel(*levels, textureID, copySourceLevel);
+	if (endLevel <= firstLevel)
+	{
+		// Every level is copied on the GPU, so there is nothing to stage.
+		GLuint texture = uploadLevels(*levels, firstLevel, srgb, textureID, copySourceLevel);
+		glDeleteTextures(1, &textureID);
+		textureID = texture;
+		residencyPending = false;
+		return;
+	}
+
+	staging = StagedUpload();
+	staging.levels = levels;
+	staging.firstLevel = firstLevel;
+	staging.copySourceLevel = copySourceLevel;
+	for (GLuint level = firstLevel; level < endLevel; level++)
+	{
+		staging.bytes += levels->getLevelBytes(level);
+	}
+	updateStaging();
+}
+
+void Texture::updateStaging()
+{
+	if (!staging.levels)
+	{
+		return;
+	}
+
+	if (!staging.buffer)
+	{
+		staging.buffer = pixelBufferPool->acquire((GLsizeiptr)staging.bytes);
+		if (!staging.buffer)
+		{
+			// Every buffer is still in flight; try again next update.
+			return;
+		}
+
+		std::shared_ptr<Ktx2Image> levels = staging.levels;
+		GLuint firstLevel = staging.firstLevel;
+		GLuint endLevel = getUploadEndLevel(*levels, textureID, staging.copySourceLevel);
+		unsigned char* target = staging.buffer->data;
+		staging.copy = ThreadPool::getShared().submit([levels, firstLevel, endLevel, target]()
+		{
+			stageLevels(*levels, firstLevel, endLevel, target);
+		}).share();
+	}
+
+	if (staging.copy.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	pixelBufferPool->beginUpload(staging.buffer);
+	GLuint texture = uploadLevels(*staging.levels, staging.firstLevel, srgb, textureID, staging.copySourceLevel, true);
+	pixelBufferPool->endUpload(staging.buffer, (GLsizeiptr)staging.bytes);
+	uploadMilliseconds = millisecondsSince(start);
+
+	glDeleteTextures(1, &textureID);
+	textureID = texture;
+	residencyPending = false;
+	staging = StagedUpload();
+}
+
+void Texture::cancelStaging()
+{
+	// The copy writes into the buffer, so it has to finish before the buffer goes back.
+	if (staging.copy.valid())
 	{
-		printf("Texture::loadTexture failed to find: %s\n", fileLocation);
+		staging.copy.wait();
+	}
+	if (staging.buffer)
+	{
+		pixelBufferPool->cancel(staging.buffer);
+	}
+	staging = StagedUpload();
+}
+
+void Texture::finishDeferredLoad()
+{
+	DecodedImage image = pendingImage.get();
+	pendingImage = std::shared_future<DecodedImage>();
+
+	finishLoad(image, streamRequested ? "loadTextureStreamed" : "loadTextureDeferred", pixelBufferPool != nullptr);
+	if (textureID != 0)
+	{
+		printf("Texture: %s %dx%d decoded in %.2f ms on a worker, uploaded in %.2f ms\n",
+			fileLocation, width, height, decodeMilliseconds, uploadMilliseconds);
+	}
+}
+
+void Texture::finishLoad(const DecodedImage& image, const char* caller, bool staged)
+{
+	if (!image.levels)
+	{
+		printf("Texture::%s failed to find: %s\n", caller, fileLocation);
 		return;
 	}
 
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	width = image.width;
+	height = image.height;
+	bitDepth = image.bitDepth;
+	decodeMilliseconds = image.milliseconds;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	if (streamRequested)
+	{
+		// Only the small levels go up now; a TextureStreamer brings in the rest.
+		streamLevels = image.levels;
+		residentLevel = getLevelCount();
+		setResidentLevel(getTailLevel());
+		printf("Texture: %s streaming as %s, %u of %u levels resident\n", fileLocation,
+			TextureCompressor::getName(streamLevels->vkFormat), getLevelCount() - residentLevel, getLevelCount());
+	}
+	else
+	{
+		if (staged)
+		{
+			// The placeholder stays bound until updateStaging() uploads from the pixel buffer.
+			beginStaging(image.levels, 0, image.levels->getLevelCount());
+		}
+		else
+		{
+			textureID = uploadLevels(*image.levels, 0, srgb);
+		}
+		memoryBytes = image.levels->getByteSize();
+		printf("Texture: %s as %s%s, %zu KB (%.1fx smaller than RGBA8)\n", fileLocation,
+			TextureCompressor::getName(image.levels->vkFormat), image.fromCache ? " from cache" : "",
+			memoryBytes / 1024, (double)getUncompressedBytes(width, height, 4) / memoryBytes);
+	}
+	uploadMilliseconds = millisecondsSince(start);
+}
+
+void Texture::loadTextureAsync(UploadThread& uploader)
+{
+	struct Upload
+	{
+		DecodedImage image;
+		GLuint textureID;
+		double milliseconds;
+		size_t bytes;
+	};
+
+	std::string location = fileLocation;
+	UploadThread* uploadThread = &uploader;
+	bool srgb = this->srgb;
+
+	// Decoding on the pool lets several textures decode at once; the upload thread only uploads.
+	ThreadPool::getShared().submit([this, location, uploadThread, srgb]()
+	{
+		std::shared_ptr<Upload> upload = std::make_shared<Upload>();
+		upload->image = decodeImage(location);
+		upload->textureID = 0;
+		upload->milliseconds = 0.0;
+		upload->bytes = 0;
+
+		if (!upload->image.levels)
+		{
+			printf("Texture::loadTextureAsync failed to find: %s\n", location.c_str());
+			return;
+		}
+
+		uploadThread->submit([upload, srgb]() -> size_t
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			upload->textureID = uploadLevels(*upload->image.levels, 0, srgb);
+			upload->bytes = upload->image.levels->getByteSize();
+			upload->milliseconds = millisecondsSince(start);
+			upload->image.levels.reset();
+			return upload->bytes;
+		},
+		[this, upload]()
+		{
+			glDeleteTextures(1, &textureID);
+			textureID = upload->textureID;
+			width = upload->image.width;
+			height = upload->image.height;
+			bitDepth = upload->image.bitDepth;
+			decodeMilliseconds = upload->image.milliseconds;
+			uploadMilliseconds = upload->milliseconds;
+			memoryBytes = upload->bytes;
+		});
+	});
+}
+
+Texture::DecodedImage Texture::decodeImage(const std::string& fileLocation)
+{
+	DecodedImage image;
+	image.width = 0;
+	image.height = 0;
+	image.bitDepth = 0;
+	image.fromCache = false;
+
+	// Either way the mips come from the cache, so the driver never has to generate them. A cooked
+	// file skips decoding, and only hashes the source to check it is current.
+	auto start = std::chrono::high_resolution_clock::now();
+	std::shared_ptr<Ktx2Image> levels = std::make_shared<Ktx2Image>();
+	if (TextureCompressor::loadCooked(fileLocation.c_str(), mipFilter, mipsInLinearLight, compressionEnabled, *levels, image.fromCache) ||
+		(compressionEnabled && TextureCompressor::loadOrCompress(fileLocation.c_str(), textureCacheDirectory, mipFilter, mipsInLinearLight,
+			*levels, image.fromCache)) ||
+		TextureCompressor::loadOrBuildMips(fileLocation.c_str(), textureCacheDirectory, mipFilter, mipsInLinearLight, *levels, image.fromCache))
+	{
+		image.levels = levels;
+		image.width = (int)levels->width;
+		image.height = (int)levels->height;
+		image.bitDepth = (int)Ktx2File::getChannelCount(levels->vkFormat);
+	}
+	image.milliseconds = millisecondsSince(start);
+	return image;
+}
+
+GLuint Texture::getPlaceholder()
+{
+	if (placeholderID == 0)
+	{
+		const unsigned char grey[4] = { 128, 128, 128, 255 };
+		placeholderID = uploadPixels(grey, 1, 1, 4, false);
+	}
+	return placeholderID;
+}
+
+GLuint Texture::uploadPixels(const unsigned char* texData, int width, int height, int channels, bool srgb)
+{
+	GLenum internalFormat = 0;
+	GLenum format = 0;
+	getPixelFormats(channels, srgb, internalFormat, format);
+
+	GLuint texture = createTexture(getMipCount(width, height));
+	applySwizzle(channels);
+
+	// Rows of one, two and three channel images are not always a multiple of four bytes.
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (hasTextureStorage())
+	{
+		glTexStorage2D(GL_TEXTURE_2D, getMipCount(width, height), internalFormat, width, height);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, texData);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, texData);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
+}
+
+GLuint Texture::uploadLevels(const Ktx2Image& image, GLuint firstLevel, bool srgb, GLuint copySource, GLuint copySourceLevel,
+	bool fromPixelBuffer)
+{
+	GLuint channels = Ktx2File::getChannelCount(image.vkFormat);
+	GLenum internalFormat = 0;
+	GLenum format = 0;
+	if (channels > 0)
+	{
+		getPixelFormats((int)channels, srgb, internalFormat, format);
+	}
+	else
+	{
+		internalFormat = TextureCompressor::getInternalFormat(image.vkFormat, srgb);
+	}
+
+	GLsizei levelCount = (GLsizei)(image.getLevelCount() - firstLevel);
+	GLsizei baseWidth = std::max(1u, image.width >> firstLevel);
+	GLsizei baseHeight = std::max(1u, image.height >> firstLevel);
+	bool copyLevels = canCopyLevels(copySource);
+	size_t stagedOffset = 0;
+
+	GLuint texture = createTexture(levelCount);
+	applySwizzle((int)Ktx2File::getSourceChannelCount(image.vkFormat));
+	if (hasTextureStorage())
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, baseWidth, baseHeight);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (GLsizei level = 0; level < levelCount; level++)
+	{
+		GLuint sourceLevel = firstLevel + level;
+		GLsizei levelWidth = std::max(1u, image.width >> sourceLevel);
+		GLsizei levelHeight = std::max(1u, image.height >> sourceLevel);
+
+		// Levels the old texture already holds are copied on the GPU rather than sent again.
+		if (copyLevels && sourceLevel >= copySourceLevel)
+		{
+			if (fromPixelBuffer)
+			{
+				// Copied levels follow every staged one, and allocating them must not read the buffer.
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			}
+			if (!hasTextureStorage())
+			{
+				uploadLevel(level, levelWidth, levelHeight, internalFormat, format, nullptr, Ktx2File::getLevelSize(image.vkFormat, levelWidth, levelHeight));
+			}
+			glCopyImageSubData(copySource, GL_TEXTURE_2D, sourceLevel - copySourceLevel, 0, 0, 0,
+				texture, GL_TEXTURE_2D, level, 0, 0, 0, levelWidth, levelHeight, 1);
+			continue;
+		}
+
+		size_t levelBytes = image.getLevelBytes(sourceLevel);
+		if (levelBytes != Ktx2File::getLevelSize(image.vkFormat, levelWidth, levelHeight))
+		{
+			printf("ERROR::Texture::uploadLevels level %u has the wrong size\n", sourceLevel);
+			break;
+		}
+		const unsigned char* pixels = fromPixelBuffer ? reinterpret_cast<const unsigned char*>(stagedOffset) : image.getLevelData(sourceLevel);
+		uploadLevel(level, levelWidth, levelHeight, internalFormat, format, pixels, levelBytes);
+		stagedOffset += levelBytes;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
+}
+
+bool Texture::canCopyLevels(GLuint copySource)
+{
+	return copySource != 0 && (GLEW_ARB_copy_image || GLEW_VERSION_4_3);
+}
+
+GLuint Texture::getUploadEndLevel(const Ktx2Image& image, GLuint copySource, GLuint copySourceLevel)
+{
+	GLuint levelCount = image.getLevelCount();
+	return canCopyLevels(copySource) ? std::min(copySourceLevel, levelCount) : levelCount;
+}
+
+size_t Texture::stageLevels(const Ktx2Image& image, GLuint firstLevel, GLuint endLevel, unsigned char* target)
+{
+	size_t offset = 0;
+	for (GLuint level = firstLevel; level < endLevel; level++)
+	{
+		memcpy(target + offset, image.getLevelData(level), image.getLevelBytes(level));
+		offset += image.getLevelBytes(level);
+	}
+	return offset;
+}
+
+void Texture::uploadLevel(GLint level, GLsizei width, GLsizei height, GLenum internalFormat, GLenum format, const unsigned char* data, size_t size)
+{
+	// format is 0 for block compressed data.
+	if (hasTextureStorage())
+	{
+		if (format != 0)
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+		}
+		else
+		{
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, internalFormat, (GLsizei)size, data);
+		}
+	}
+	else if (format != 0)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+	}
+	else
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, (GLsizei)size, data);
+	}
+}
+
+void Texture::getPixelFormats(int channels, bool srgb, GLenum& internalFormat, GLenum& format)
+{
+	switch (channels)
+	{
+	case 1:
+		internalFormat = GL_R8;
+		format = GL_RED;
+		break;
+	case 2:
+		internalFormat = GL_RG8;
+		format = GL_RG;
+		break;
+	case 3:
+		internalFormat = srgb ? GL_SRGB8 : GL_RGB8;
+		format = GL_RGB;
+		break;
+	default:
+		internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+		format = GL_RGBA;
+		break;
+	}
+}
+
+void Texture::applySwizzle(int channels)
+{
+	// stb_image gives grey and grey plus alpha for one and two channels, which sample as red and red
+	// plus green without a swizzle.
+	if (channels == 1)
+	{
+		const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+	else if (channels == 2)
+	{
+		const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+}
+
+GLuint Texture::createTexture(GLsizei levelCount)
+{
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// Immutable textures clamp this themselves; mutable ones would otherwise look for 1000 levels.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texData);
-	glGenerateMipmap(GL_TEXTURE_2D);
+	return texture;
+}
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+GLsizei Texture::getMipCount(int width, int height)
+{
+	GLsizei levelCount = 1;
+	for (int size = std::max(width, height); size > 1; size >>= 1)
+	{
+		levelCount++;
+	}
+	return levelCount;
+}
+
+bool Texture::hasTextureStorage()
+{
+	return GLEW_ARB_texture_storage || GLEW_VERSION_4_2;
+}
+
+size_t Texture::getUncompressedBytes(int width, int height, int channels)
+{
+	// A full mip chain is about four thirds of the base level.
+	return (size_t)width * height * channels * 4 / 3;
+}
+
+void Texture::updateLoad()
+{
+	if (pendingImage.valid() && pendingImage.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		finishDeferredLoad();
+	}
+	updateStaging();
+}
 
-	stbi_image_free(texData);
+GLuint Texture::getTextureID()
+{
+	return textureID != 0 ? textureID : getPlaceholder();
 }
 
 void Texture::useTexture()
 {
+	updateLoad();
+
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, textureID); 
+	glBindTexture(GL_TEXTURE_2D, getTextureID()); 
 }
 
 void Texture::clearTexture()
@@ -56,7 +624,14 @@ void Texture::clearTexture()
 	width = 0;
 	height = 0;
 	bitDepth = 0;
+	memoryBytes = 0;
 	fileLocation = (char*)"";
+	streamLevels.reset();
+	streamRequested = false;
+	residentLevel = 0;
+	residencyPending = false;
+	pendingImage = std::shared_future<DecodedImage>();
+	cancelStaging();
 }
 
 Texture::~Texture()
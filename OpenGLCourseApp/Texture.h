@@ -1,8 +1,17 @@
 #pragma once
 
+#include <future>
+#include <memory>
+#include <string>
+
 #include<GL\glew.h>
 #include "stb_image.h"
 
+#include "Ktx2File.h"
+#include "MipGenerator.h"
+#include "PixelBufferPool.h"
+#include "UploadThread.h"
+
 class Texture
 {
 public:
@@ -10,16 +19,136 @@ public:
 	Texture(char *fileLoc);
 	
 	void loadTexture();
+	// Decodes on the shared thread pool and uploads on the render thread, in the first useTexture()
+	// after the decode finishes. A placeholder is bound until then.
+	void loadTextureDeferred();
+	// Decodes on the shared thread pool and uploads on uploader's thread. The placeholder is bound
+	// until the upload is published, and the texture must outlive it.
+	void loadTextureAsync(UploadThread& uploader);
+	// Decodes on the shared thread pool like loadTextureDeferred(), but keeps every level in memory
+	// and only makes those no larger than streamTailSize resident. A TextureStreamer moves the
+	// resident level from there.
+	void loadTextureStreamed();
+	bool isLoaded() { return textureID != 0; }
+	// Finishes a deferred load whose decode is done. useTexture() does this itself.
+	void updateLoad();
+	// The texture useTexture() binds: the placeholder until loading finishes.
+	GLuint getTextureID();
 	void useTexture();
 	void clearTexture();
 
+	double getDecodeMilliseconds() { return decodeMilliseconds; }
+	double getUploadMilliseconds() { return uploadMilliseconds; }
+	size_t getMemoryBytes() { return memoryBytes; }
+
+	// Marks the file as sRGB encoded colour, so sampling returns linear values. Set before loading;
+	// data such as normal or roughness maps should stay linear.
+	void setSRGB(bool isSRGB) { srgb = isSRGB; }
+
+	// When on (the default), every load goes through the block compressed KTX2 cache in
+	// textureCacheDirectory, falling back to a cached uncompressed chain if the driver has no
+	// matching BCn format.
+	static void setCompression(bool enabled) { compressionEnabled = enabled; }
+	// How cached mip chains are built; the cache is keyed on both. In linear light (the default)
+	// colour channels are treated as sRGB encoded whatever setSRGB() says, since that only changes
+	// how the texture is sampled.
+	static void setMipGeneration(MipFilter filter, bool linearLight) { mipFilter = filter; mipsInLinearLight = linearLight; }
+	static MipFilter getMipFilter() { return mipFilter; }
+	static bool getMipsInLinearLight() { return mipsInLinearLight; }
+	// With a pool, deferred and streamed loads and setResidentLevel() without an uploader copy their
+	// levels into one of its buffers on the shared thread pool, then upload from it in a later
+	// updateLoad(), so the render thread neither copies texels nor waits on the driver.
+	static void setPixelBufferPool(PixelBufferPool* pool) { pixelBufferPool = pool; }
+	static const char* textureCacheDirectory;
+
+	static const GLuint streamTailSize = 64;
+	bool isStreamed() { return streamLevels != nullptr; }
+	GLuint getLevelCount();
+	// The finest level resident, or about to be if a rebuild is pending.
+	GLuint getResidentLevel() { return residentLevel; }
+	bool isResidencyPending() { return residencyPending; }
+	GLuint getTailLevel();
+	size_t getLevelBytes(GLuint level);
+	int getWidth() { return width; }
+	int getHeight() { return height; }
+	// Rebuilds the texture holding level and everything smaller. Levels the current texture
+	// already has are copied on the GPU where ARB_copy_image allows. With an uploader the rebuild
+	// runs on its thread and replaces the texture when published; calls return false until then.
+	bool setResidentLevel(GLuint level, UploadThread* uploader = nullptr);
+
 	~Texture();
 
 private:
+	struct DecodedImage
+	{
+		// Block compressed levels, or the raw mip chain if compression is off.
+		std::shared_ptr<Ktx2Image> levels;
+		bool fromCache;
+		int width;
+		int height;
+		int bitDepth;
+		double milliseconds;
+	};
+
 	GLuint textureID;
 	int width;
 	int height;
 	int bitDepth;
 
 	char* fileLocation;
+
+	std::shared_future<DecodedImage> pendingImage;
+	double decodeMilliseconds;
+	double uploadMilliseconds;
+	size_t memoryBytes;
+	bool srgb;
+
+	struct StagedUpload
+	{
+		std::shared_ptr<Ktx2Image> levels;
+		GLuint firstLevel;
+		// Levels from here down are copied from the current texture rather than staged.
+		GLuint copySourceLevel;
+		PixelBufferPool::PixelBuffer* buffer;
+		size_t bytes;
+		std::shared_future<void> copy;
+	};
+
+	StagedUpload staging;
+	std::shared_ptr<Ktx2Image> streamLevels;
+	bool streamRequested;
+	GLuint residentLevel;
+	bool residencyPending;
+
+	static GLuint placeholderID;
+	static bool compressionEnabled;
+	static MipFilter mipFilter;
+	static bool mipsInLinearLight;
+	static PixelBufferPool* pixelBufferPool;
+
+	static DecodedImage decodeImage(const std::string& fileLocation);
+	// Both create immutable storage with the whole mip chain where the driver supports it.
+	static GLuint uploadPixels(const unsigned char* texData, int width, int height, int channels, bool srgb);
+	// Uploads image's levels from firstLevel down, copying those copySource holds from
+	// copySourceLevel down instead. fromPixelBuffer reads the uploaded levels from the bound unpack
+	// buffer, packed in order by stageLevels().
+	static GLuint uploadLevels(const Ktx2Image& image, GLuint firstLevel, bool srgb, GLuint copySource = 0, GLuint copySourceLevel = 0,
+		bool fromPixelBuffer = false);
+	static bool canCopyLevels(GLuint copySource);
+	// The levels uploadLevels() sends rather than copies.
+	static GLuint getUploadEndLevel(const Ktx2Image& image, GLuint copySource, GLuint copySourceLevel);
+	static size_t stageLevels(const Ktx2Image& image, GLuint firstLevel, GLuint endLevel, unsigned char* target);
+	static void uploadLevel(GLint level, GLsizei width, GLsizei height, GLenum internalFormat, GLenum format, const unsigned char* data, size_t size);
+	static void getPixelFormats(int channels, bool srgb, GLenum& internalFormat, GLenum& format);
+	static void applySwizzle(int channels);
+	static GLuint createTexture(GLsizei levelCount);
+	static GLsizei getMipCount(int width, int height);
+	static bool hasTextureStorage();
+	static size_t getUncompressedBytes(int width, int height, int channels);
+	void finishLoad(const DecodedImage& image, const char* caller, bool staged);
+	void beginStaging(const std::shared_ptr<Ktx2Image>& levels, GLuint firstLevel, GLuint copySourceLevel);
+	void updateStaging();
+	void cancelStaging();
+	static GLuint getPlaceholder();
+	void finishDeferredLoad();
 };
\ No newline at end of file
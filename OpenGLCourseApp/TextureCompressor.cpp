@@ -0,0 +1,729 @@
+#include "TextureCompressor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <filesystem>
+#include <vector>
+
+#include <glm\glm.hpp>
+
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "stb_image.h"
+
+namespace
+{
+	typedef unsigned char Block[16][4];
+
+	void fetchBlock(const unsigned char* pixels, int width, int height, int channels, int blockX, int blockY, Block block)
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			int row = std::min(blockY * 4 + y, height - 1);
+			for (int x = 0; x < 4; x++)
+			{
+				int column = std::min(blockX * 4 + x, width - 1);
+				const unsigned char* texel = pixels + ((size_t)row * width + column) * channels;
+				unsigned char* out = block[y * 4 + x];
+
+				switch (channels)
+				{
+				case 1:
+					out[0] = out[1] = out[2] = texel[0];
+					out[3] = 255;
+					break;
+				case 2:
+					out[0] = texel[0];
+					out[1] = texel[1];
+					out[2] = 0;
+					out[3] = 255;
+					break;
+				case 3:
+					out[0] = texel[0];
+					out[1] = texel[1];
+					out[2] = texel[2];
+					out[3] = 255;
+					break;
+				default:
+					memcpy(out, texel, 4);
+					break;
+				}
+			}
+		}
+	}
+
+	// Direction of greatest variance of the block's first channelCount channels.
+	glm::vec4 principalAxis(const Block block, int channelCount, glm::vec4& mean)
+	{
+		mean = glm::vec4(0.f);
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < channelCount; c++)
+			{
+				mean[c] += block[i][c];
+			}
+		}
+		mean /= 16.f;
+
+		glm::mat4 covariance(0.f);
+		for (int i = 0; i < 16; i++)
+		{
+			glm::vec4 d(0.f);
+			for (int c = 0; c < channelCount; c++)
+			{
+				d[c] = block[i][c] - mean[c];
+			}
+			covariance += glm::outerProduct(d, d);
+		}
+
+		glm::vec4 axis(1.f, 1.f, 1.f, channelCount > 3 ? 1.f : 0.f);
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			glm::vec4 next = covariance * axis;
+			GLfloat length = glm::length(next);
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			axis = next / length;
+		}
+		return axis;
+	}
+
+	GLushort packColour565(const glm::vec3& colour)
+	{
+		int r = (int)glm::clamp(colour.r * 31.f / 255.f + 0.5f, 0.f, 31.f);
+		int g = (int)glm::clamp(colour.g * 63.f / 255.f + 0.5f, 0.f, 63.f);
+		int b = (int)glm::clamp(colour.b * 31.f / 255.f + 0.5f, 0.f, 31.f);
+		return (GLushort)((r << 11) | (g << 5) | b);
+	}
+
+	glm::vec3 unpackColour565(GLushort colour)
+	{
+		int r = (colour >> 11) & 31;
+		int g = (colour >> 5) & 63;
+		int b = colour & 31;
+		return glm::vec3((GLfloat)((r << 3) | (r >> 2)), (GLfloat)((g << 2) | (g >> 4)), (GLfloat)((b << 3) | (b >> 2)));
+	}
+
+	// Picks indices for two 565 endpoints in four colour mode and returns the squared error.
+	GLfloat fitColourIndices(const Block block, GLushort& colour0, GLushort& colour1, unsigned int& indices)
+	{
+		if (colour0 < colour1)
+		{
+			std::swap(colour0, colour1);
+		}
+
+		glm::vec3 palette[4];
+		palette[0] = unpackColour565(colour0);
+		palette[1] = unpackColour565(colour1);
+		palette[2] = (palette[0] * 2.f + palette[1]) / 3.f;
+		palette[3] = (palette[0] + palette[1] * 2.f) / 3.f;
+
+		indices = 0;
+		GLfloat error = 0.f;
+		for (int i = 0; i < 16; i++)
+		{
+			glm::vec3 texel(block[i][0], block[i][1], block[i][2]);
+			int best = 0;
+			GLfloat bestDistance = FLT_MAX;
+			for (int p = 0; p < (colour0 == colour1 ? 1 : 4); p++)
+			{
+				glm::vec3 d = texel - palette[p];
+				GLfloat distance = glm::dot(d, d);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (unsigned int)best << (i * 2);
+			error += bestDistance;
+		}
+		return error;
+	}
+
+	void encodeBC1(const Block block, unsigned char* out)
+	{
+		glm::vec4 mean;
+		glm::vec4 axis = principalAxis(block, 3, mean);
+
+		GLfloat minProjection = FLT_MAX;
+		GLfloat maxProjection = -FLT_MAX;
+		for (int i = 0; i < 16; i++)
+		{
+			GLfloat projection = glm::dot(glm::vec3(block[i][0], block[i][1], block[i][2]) - glm::vec3(mean), glm::vec3(axis));
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		GLushort colour0 = packColour565(glm::vec3(mean) + glm::vec3(axis) * maxProjection);
+		GLushort colour1 = packColour565(glm::vec3(mean) + glm::vec3(axis) * minProjection);
+		unsigned int indices;
+		GLfloat error = fitColourIndices(block, colour0, colour1, indices);
+
+		// One least squares refit of the endpoints to the chosen indices.
+		const GLfloat weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+		GLfloat aa = 0.f, ab = 0.f, bb = 0.f;
+		glm::vec3 ax(0.f), bx(0.f);
+		for (int i = 0; i < 16; i++)
+		{
+			GLfloat a = weights[(indices >> (i * 2)) & 3];
+			GLfloat b = 1.f - a;
+			glm::vec3 texel(block[i][0], block[i][1], block[i][2]);
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax += texel * a;
+			bx += texel * b;
+		}
+
+		GLfloat determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) > 1e-6f)
+		{
+			GLushort refit0 = packColour565((ax * bb - bx * ab) / determinant);
+			GLushort refit1 = packColour565((bx * aa - ax * ab) / determinant);
+			unsigned int refitIndices;
+			GLfloat refitError = fitColourIndices(block, refit0, refit1, refitIndices);
+			if (refitError < error)
+			{
+				colour0 = refit0;
+				colour1 = refit1;
+				indices = refitIndices;
+			}
+		}
+
+		memcpy(out, &colour0, 2);
+		memcpy(out + 2, &colour1, 2);
+		memcpy(out + 4, &indices, 4);
+	}
+
+	void encodeBC4(const Block block, int channel, unsigned char* out)
+	{
+		int maxValue = 0;
+		int minValue = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			maxValue = std::max(maxValue, (int)block[i][channel]);
+			minValue = std::min(minValue, (int)block[i][channel]);
+		}
+
+		out[0] = (unsigned char)maxValue;
+		out[1] = (unsigned char)minValue;
+
+		GLuint64 indices = 0;
+		if (maxValue > minValue)
+		{
+			int palette[8];
+			palette[0] = maxValue;
+			palette[1] = minValue;
+			for (int p = 1; p < 7; p++)
+			{
+				palette[p + 1] = ((7 - p) * maxValue + p * minValue) / 7;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int value = block[i][channel];
+				int best = 0;
+				for (int p = 1; p < 8; p++)
+				{
+					if (abs(value - palette[p]) < abs(value - palette[best]))
+					{
+						best = p;
+					}
+				}
+				indices |= (GLuint64)best << (i * 3);
+			}
+		}
+
+		for (int b = 0; b < 6; b++)
+		{
+			out[2 + b] = (unsigned char)(indices >> (b * 8));
+		}
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(unsigned char* out) : out(out), position(0)
+		{
+			memset(out, 0, 16);
+		}
+
+		void write(unsigned int value, int bits)
+		{
+			for (int b = 0; b < bits; b++, position++)
+			{
+				out[position / 8] |= ((value >> b) & 1) << (position % 8);
+			}
+		}
+
+	private:
+		unsigned char* out;
+		int position;
+	};
+
+	// BC7 mode 6: one subset, 7 bit RGBA endpoints plus a p bit each, 4 bit indices.
+	void encodeBC7(const Block block, unsigned char* out)
+	{
+		static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		glm::vec4 mean;
+		glm::vec4 axis = principalAxis(block, 4, mean);
+
+		GLfloat minProjection = FLT_MAX;
+		GLfloat maxProjection = -FLT_MAX;
+		for (int i = 0; i < 16; i++)
+		{
+			glm::vec4 texel(block[i][0], block[i][1], block[i][2], block[i][3]);
+			GLfloat projection = glm::dot(texel - mean, axis);
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		glm::vec4 ends[2] = { mean + axis * minProjection, mean + axis * maxProjection };
+
+		int bestQuantised[2][4] = {};
+		int bestPBits[2] = {};
+		int bestIndices[16] = {};
+		int bestError = INT_MAX;
+
+		for (int pBits = 0; pBits < 4; pBits++)
+		{
+			int quantised[2][4];
+			int endpoints[2][4];
+			for (int e = 0; e < 2; e++)
+			{
+				int p = (pBits >> e) & 1;
+				for (int c = 0; c < 4; c++)
+				{
+					int q = (int)floorf((glm::clamp(ends[e][c], 0.f, 255.f) - p) / 2.f + 0.5f);
+					quantised[e][c] = glm::clamp(q, 0, 127);
+					endpoints[e][c] = (quantised[e][c] << 1) | p;
+				}
+			}
+
+			int palette[16][4];
+			for (int w = 0; w < 16; w++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					palette[w][c] = ((64 - weights[w]) * endpoints[0][c] + weights[w] * endpoints[1][c] + 32) >> 6;
+				}
+			}
+
+			int indices[16];
+			int error = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0;
+				int bestDistance = INT_MAX;
+				for (int w = 0; w < 16; w++)
+				{
+					int distance = 0;
+					for (int c = 0; c < 4; c++)
+					{
+						int d = block[i][c] - palette[w][c];
+						distance += d * d;
+					}
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = w;
+					}
+				}
+				indices[i] = best;
+				error += bestDistance;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(bestQuantised, quantised, sizeof(quantised));
+				bestPBits[0] = pBits & 1;
+				bestPBits[1] = (pBits >> 1) & 1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+
+		// The first index is stored with an implied zero top bit, so swap the endpoints if it is set.
+		if (bestIndices[0] >= 8)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				std::swap(bestQuantised[0][c], bestQuantised[1][c]);
+			}
+			std::swap(bestPBits[0], bestPBits[1]);
+			for (int i = 0; i < 16; i++)
+			{
+				bestIndices[i] = 15 - bestIndices[i];
+			}
+		}
+
+		BitWriter writer(out);
+		writer.write(1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			writer.write(bestQuantised[0][c], 7);
+			writer.write(bestQuantised[1][c], 7);
+		}
+		writer.write(bestPBits[0], 1);
+		writer.write(bestPBits[1], 1);
+		writer.write(bestIndices[0], 3);
+		for (int i = 1; i < 16; i++)
+		{
+			writer.write(bestIndices[i], 4);
+		}
+	}
+
+	void encodeBlock(const Block block, BlockFormat format, unsigned char* out)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:
+			encodeBC1(block, out);
+			break;
+		case BlockFormat::BC3:
+			encodeBC4(block, 3, out);
+			encodeBC1(block, out + 8);
+			break;
+		case BlockFormat::BC4:
+			encodeBC4(block, 0, out);
+			break;
+		case BlockFormat::BC5:
+			encodeBC4(block, 0, out);
+			encodeBC4(block, 1, out + 8);
+			break;
+		case BlockFormat::BC7:
+			encodeBC7(block, out);
+			break;
+		}
+	}
+
+	GLuint64 hashBytes(const unsigned char* data, size_t size, GLuint64 hash)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ data[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Cooked files record the source they were made from under this key, as a 16 digit hex hash,
+	// and the mip settings they were built with under the other two.
+	const char* sourceHashKey = "sourceHash";
+	const char* mipFilterKey = "mipFilter";
+	const char* mipsInLinearLightKey = "mipsInLinearLight";
+
+	bool hasKeyValue(const Ktx2Image& image, const char* key, const std::string& value)
+	{
+		auto found = image.keyValues.find(key);
+		return found != image.keyValues.end() && found->second == value;
+	}
+
+	std::string getSourceHash(MappedFile& source)
+	{
+		char hash[17];
+		snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)hashBytes(source.getData(), source.getSize(), 14695981039346656037ull));
+		return hash;
+	}
+
+	// Names the cache entry after the source's contents and keys, everything else that changes
+	// what gets cached.
+	std::string getCacheLocation(MappedFile& source, const char* cacheDirectory, const GLuint* keys, size_t keyCount)
+	{
+		GLuint64 hash = hashBytes(source.getData(), source.getSize(), 14695981039346656037ull);
+		hash = hashBytes((const unsigned char*)keys, keyCount * sizeof(GLuint), hash);
+
+		char cacheName[32];
+		snprintf(cacheName, sizeof(cacheName), "%016llx.ktx2", (unsigned long long)hash);
+		return std::string(cacheDirectory) + "/" + cacheName;
+	}
+
+	// Maps the cached uncompressed chain for source or decodes it and builds one. Compressed
+	// entries start from this too, so a source is decoded once whichever cache asks first.
+	bool loadOrBuildMipsFrom(MappedFile& source, const char* cacheDirectory, MipFilter filter, bool srgb, Ktx2Image& image, bool& fromCache)
+	{
+		fromCache = false;
+
+		// An encoder version of 0 keeps these entries apart from the compressed ones.
+		GLuint keys[] = { 0, MipGenerator::generatorVersion, (GLuint)filter, srgb ? 1u : 0u };
+		std::string cacheLocation = getCacheLocation(source, cacheDirectory, keys, sizeof(keys) / sizeof(keys[0]));
+
+		std::error_code error;
+		if (std::filesystem::exists(cacheLocation, error) && Ktx2File::map(cacheLocation.c_str(), image) && Ktx2File::getChannelCount(image.vkFormat) != 0)
+		{
+			fromCache = true;
+			return true;
+		}
+
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		unsigned char* pixels = stbi_load_from_memory(source.getData(), (int)source.getSize(), &width, &height, &channels, 0);
+		if (!pixels)
+		{
+			return false;
+		}
+
+		MipGenerator::buildMipChain(pixels, width, height, channels, image, filter, srgb);
+		stbi_image_free(pixels);
+
+		std::filesystem::create_directories(cacheDirectory, error);
+		Ktx2File::write(cacheLocation.c_str(), image);
+		return true;
+	}
+}
+
+bool TextureCompressor::isSupported(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+	case BlockFormat::BC3:
+		return GLEW_EXT_texture_compression_s3tc != 0;
+	case BlockFormat::BC4:
+	case BlockFormat::BC5:
+		return GLEW_ARB_texture_compression_rgtc || GLEW_VERSION_3_0;
+	case BlockFormat::BC7:
+		return GLEW_ARB_texture_compression_bptc || GLEW_VERSION_4_2;
+	}
+	return false;
+}
+
+bool TextureCompressor::chooseFormat(int channels, BlockFormat& format)
+{
+	switch (channels)
+	{
+	case 1:
+		format = BlockFormat::BC4;
+		break;
+	case 2:
+		format = BlockFormat::BC5;
+		break;
+	case 3:
+		format = BlockFormat::BC1;
+		break;
+	default:
+		format = isSupported(BlockFormat::BC7) ? BlockFormat::BC7 : BlockFormat::BC3;
+		break;
+	}
+	return isSupported(format);
+}
+
+GLenum TextureCompressor::getInternalFormat(GLuint vkFormat, bool srgb)
+{
+	switch (vkFormat)
+	{
+	case Ktx2File::vkFormatBC1:
+		return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case Ktx2File::vkFormatBC3:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case Ktx2File::vkFormatBC4:
+		return GL_COMPRESSED_RED_RGTC1;
+	case Ktx2File::vkFormatBC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	case Ktx2File::vkFormatBC7:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+	return 0;
+}
+
+const char* TextureCompressor::getName(GLuint vkFormat)
+{
+	switch (vkFormat)
+	{
+	case Ktx2File::vkFormatBC1:
+		return "BC1";
+	case Ktx2File::vkFormatBC3:
+		return "BC3";
+	case Ktx2File::vkFormatBC4:
+		return "BC4";
+	case Ktx2File::vkFormatBC5:
+		return "BC5";
+	case Ktx2File::vkFormatBC7:
+		return "BC7";
+	case Ktx2File::vkFormatR8:
+		return "R8";
+	case Ktx2File::vkFormatRG8:
+		return "RG8";
+	case Ktx2File::vkFormatRGB8:
+		return "RGB8";
+	case Ktx2File::vkFormatRGBA8:
+		return "RGBA8";
+	}
+	return "unknown";
+}
+
+void TextureCompressor::compress(const Ktx2Image& levels, BlockFormat format, Ktx2Image& image, ThreadPool* pool)
+{
+	if (!pool)
+	{
+		pool = &ThreadPool::getShared();
+	}
+
+	GLuint blockBytes = Ktx2File::getBlockBytes((GLuint)format);
+	int channels = (int)Ktx2File::getChannelCount(levels.vkFormat);
+	// Drops any mapping image held, as well as old levels.
+	image = Ktx2Image();
+	image.vkFormat = (GLuint)format;
+	image.width = levels.width;
+	image.height = levels.height;
+
+	int width = (int)levels.width;
+	int height = (int)levels.height;
+	// Through the accessors, as the chain may be mapped from the cache.
+	for (GLuint level = 0; level < levels.getLevelCount(); level++)
+	{
+		const unsigned char* pixels = levels.getLevelData(level);
+		int blocksX = (width + 3) / 4;
+		int blocksY = (height + 3) / 4;
+		image.levels.emplace_back((size_t)blocksX * blocksY * blockBytes);
+		unsigned char* out = image.levels.back().data();
+
+		pool->parallelFor(blocksY, 8, [&](size_t begin, size_t end)
+		{
+			Block block;
+			for (size_t by = begin; by < end; by++)
+			{
+				for (int bx = 0; bx < blocksX; bx++)
+				{
+					fetchBlock(pixels, width, height, channels, bx, (int)by, block);
+					encodeBlock(block, format, out + (by * blocksX + bx) * blockBytes);
+				}
+			}
+		});
+
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+}
+
+bool TextureCompressor::loadOrCompress(const char* fileLocation, const char* cacheDirectory, MipFilter filter, bool srgb, Ktx2Image& image,
+	bool& fromCache)
+{
+	fromCache = false;
+
+	MappedFile source;
+	if (!source.open(fileLocation))
+	{
+		return false;
+	}
+
+	// The chosen format depends on what the driver supports, so it is part of the key too.
+	GLuint keys[] = { encoderVersion, MipGenerator::generatorVersion, (GLuint)filter, srgb ? 1u : 0u, isSupported(BlockFormat::BC7) ? 1u : 0u };
+	std::string cacheLocation = getCacheLocation(source, cacheDirectory, keys, sizeof(keys) / sizeof(keys[0]));
+
+	std::error_code error;
+	if (std::filesystem::exists(cacheLocation, error) && Ktx2File::map(cacheLocation.c_str(), image) && isSupported((BlockFormat)image.vkFormat))
+	{
+		fromCache = true;
+		return true;
+	}
+
+	Ktx2Image levels;
+	bool levelsFromCache = false;
+	BlockFormat format;
+	if (!loadOrBuildMipsFrom(source, cacheDirectory, filter, srgb, levels, levelsFromCache) ||
+		!chooseFormat((int)Ktx2File::getChannelCount(levels.vkFormat), format))
+	{
+		return false;
+	}
+	compress(levels, format, image);
+
+	std::filesystem::create_directories(cacheDirectory, error);
+	Ktx2File::write(cacheLocation.c_str(), image);
+	return true;
+}
+
+bool TextureCompressor::loadOrBuildMips(const char* fileLocation, const char* cacheDirectory, MipFilter filter, bool srgb, Ktx2Image& image,
+	bool& fromCache)
+{
+	fromCache = false;
+
+	MappedFile source;
+	if (!source.open(fileLocation))
+	{
+		return false;
+	}
+	return loadOrBuildMipsFrom(source, cacheDirectory, filter, srgb, image, fromCache);
+}
+
+std::string TextureCompressor::getCookedLocation(const char* fileLocation)
+{
+	return std::filesystem::path(fileLocation).replace_extension(".ktx2").string();
+}
+
+bool TextureCompressor::loadCooked(const char* fileLocation, MipFilter filter, bool srgb, bool allowCompressed, Ktx2Image& image, bool& fromCache)
+{
+	fromCache = false;
+
+	std::string cookedLocation = getCookedLocation(fileLocation);
+	std::error_code error;
+	if (!std::filesystem::exists(cookedLocation, error) || !Ktx2File::map(cookedLocation.c_str(), image))
+	{
+		return false;
+	}
+
+	if (Ktx2File::getChannelCount(image.vkFormat) == 0 && !isSupported((BlockFormat)image.vkFormat))
+	{
+		image = Ktx2Image();
+		return false;
+	}
+
+	// A cooked file shipped without its source is taken as it is.
+	MappedFile source;
+	if (!source.open(fileLocation))
+	{
+		fromCache = true;
+		return true;
+	}
+
+	// Both caches key on the mip settings, so a cooked file has to match them too.
+	if (!hasKeyValue(image, mipFilterKey, MipGenerator::getFilterName(filter)) || !hasKeyValue(image, mipsInLinearLightKey, srgb ? "1" : "0"))
+	{
+		printf("TextureCompressor: %s was cooked with other mip settings, ignoring it\n", cookedLocation.c_str());
+		image = Ktx2Image();
+		return false;
+	}
+	if (!allowCompressed && Ktx2File::getChannelCount(image.vkFormat) == 0)
+	{
+		image = Ktx2Image();
+		return false;
+	}
+	if (!hasKeyValue(image, sourceHashKey, getSourceHash(source)))
+	{
+		printf("TextureCompressor: %s has changed since it was cooked, ignoring %s\n", fileLocation, cookedLocation.c_str());
+		image = Ktx2Image();
+		return false;
+	}
+
+	fromCache = true;
+	return true;
+}
+
+bool TextureCompressor::cook(const char* fileLocation, const char* cacheDirectory, MipFilter filter, bool srgb, Ktx2Image& image)
+{
+	// The uncompressed chain is cached first, so TextureManager finds it without decoding either.
+	MappedFile source;
+	Ktx2Image levels;
+	bool fromCache = false;
+	if (!source.open(fileLocation) || !loadOrBuildMips(fileLocation, cacheDirectory, filter, srgb, levels, fromCache))
+	{
+		return false;
+	}
+	if (!loadOrCompress(fileLocation, cacheDirectory, filter, srgb, image, fromCache))
+	{
+		image = levels;
+	}
+
+	image.keyValues[sourceHashKey] = getSourceHash(source);
+	image.keyValues[mipFilterKey] = MipGenerator::getFilterName(filter);
+	image.keyValues[mipsInLinearLightKey] = srgb ? "1" : "0";
+	return Ktx2File::write(getCookedLocation(fileLocation).c_str(), image);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+
+#include <GL\glew.h>
+
+#include "Ktx2File.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+// Block compression to the BCn formats desktop GL samples natively. Each format's value is its
+// KTX2 vkFormat, so it can be written straight into a Ktx2Image.
+enum class BlockFormat : GLuint
+{
+	BC1 = Ktx2File::vkFormatBC1,
+	BC3 = Ktx2File::vkFormatBC3,
+	BC4 = Ktx2File::vkFormatBC4,
+	BC5 = Ktx2File::vkFormatBC5,
+	BC7 = Ktx2File::vkFormatBC7,
+};
+
+namespace TextureCompressor
+{
+	// Bumping this invalidates every cached texture.
+	const GLuint encoderVersion = 1;
+
+	bool isSupported(BlockFormat format);
+	// One channel goes to BC4, two (grey plus alpha) to BC5, three to BC1 and four to BC7, or BC3 where
+	// BPTC is missing. Returns false if the driver has none of them.
+	bool chooseFormat(int channels, BlockFormat& format);
+	// BC4 and BC5 have no sRGB variant and ignore srgb.
+	GLenum getInternalFormat(GLuint vkFormat, bool srgb = false);
+	const char* getName(GLuint vkFormat);
+
+	// Compresses every level of levels, an uncompressed chain from MipGenerator, spreading blocks
+	// over pool.
+	void compress(const Ktx2Image& levels, BlockFormat format, Ktx2Image& image, ThreadPool* pool = nullptr);
+
+	// Loads the cached KTX2 for fileLocation, keyed by a hash of the file's contents and the mip
+	// settings, or decodes, builds the mips, compresses and caches it. fromCache says which happened.
+	bool loadOrCompress(const char* fileLocation, const char* cacheDirectory, MipFilter filter, bool srgb, Ktx2Image& image,
+		bool& fromCache);
+	// The same cache for the uncompressed mip chain, for drivers without the BCn formats or when
+	// compression is off.
+	bool loadOrBuildMips(const char* fileLocation, const char* cacheDirectory, MipFilter filter, bool srgb, Ktx2Image& image,
+		bool& fromCache);
+
+	// Cooked textures sit beside their source with a .ktx2 extension and hold exactly what gets
+	// uploaded, so loading one is a map and a hash of the source, with no decode. They record the
+	// hash of the source they were cooked from and the mip settings, and one that no longer matches
+	// either is ignored.
+	std::string getCookedLocation(const char* fileLocation);
+	// Maps the cooked texture for fileLocation if there is an up to date one the driver can sample,
+	// cooked with filter and srgb, and uncompressed unless allowCompressed. One shipped without its
+	// source is taken whatever it was cooked with, as nothing else could replace it.
+	bool loadCooked(const char* fileLocation, MipFilter filter, bool srgb, bool allowCompressed, Ktx2Image& image, bool& fromCache);
+	// Writes the cooked texture for fileLocation, block compressed where the driver allows, and
+	// fills the uncompressed mip cache on the way.
+	bool cook(const char* fileLocation, const char* cacheDirectory, MipFilter filter, bool srgb, Ktx2Image& image);
+}
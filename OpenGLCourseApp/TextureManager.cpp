@@ -0,0 +1,346 @@
+#include "TextureManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "Shader.h"
+#include "Texture.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// Atlas arrays keep atlasLevels mip levels, down to 16 texels on a 2048 page, where a 1024 entry
+	// is a few texels across. Entries are padded with their edge texels and placed on multiples of
+	// the padding, so every level still has a texel of border and filtering never reaches a neighbour.
+	const GLsizei atlasLevels = 8;
+	const GLuint atlasPadding = 1u << (atlasLevels - 1);
+
+	// Level of a chain as RGBA, expanding fewer channels the way Texture swizzles them.
+	const unsigned char* getRGBALevel(const Ktx2Image& image, GLuint level, std::vector<unsigned char>& scratch)
+	{
+		GLuint channels = Ktx2File::getChannelCount(image.vkFormat);
+		const unsigned char* data = image.getLevelData(level);
+		if (channels == 4)
+		{
+			return data;
+		}
+
+		size_t texels = image.getLevelBytes(level) / channels;
+		scratch.resize(texels * 4);
+		for (size_t i = 0; i < texels; i++)
+		{
+			const unsigned char* source = data + i * channels;
+			unsigned char* target = &scratch[i * 4];
+			target[0] = source[0];
+			target[1] = channels >= 3 ? source[1] : source[0];
+			target[2] = channels >= 3 ? source[2] : source[0];
+			target[3] = channels == 2 ? source[1] : 255;
+		}
+		return scratch.data();
+	}
+
+	void copyPadded(const unsigned char* source, int width, int height, int padding, unsigned char* page, GLuint pageSize, GLuint x, GLuint y)
+	{
+		for (int row = -padding; row < height + padding; row++)
+		{
+			int sourceRow = std::min(std::max(row, 0), height - 1);
+			unsigned char* destination = page + ((size_t)(y + padding + row) * pageSize + x) * 4;
+			const unsigned char* sourceLine = source + (size_t)sourceRow * width * 4;
+
+			for (int column = -padding; column < 0; column++, destination += 4)
+			{
+				memcpy(destination, sourceLine, 4);
+			}
+			memcpy(destination, sourceLine, (size_t)width * 4);
+			destination += (size_t)width * 4;
+			for (int column = 0; column < padding; column++, destination += 4)
+			{
+				memcpy(destination, sourceLine + (size_t)(width - 1) * 4, 4);
+			}
+		}
+	}
+}
+
+TextureManager::TextureManager()
+{
+	slotBuffer = 0;
+}
+
+GLuint TextureManager::addTexture(const char* fileLocation)
+{
+	if (entries.size() >= maxTextures)
+	{
+		printf("ERROR::TextureManager::addTexture more than %u textures\n", maxTextures);
+		return invalidTexture;
+	}
+
+	entries.push_back({ fileLocation, invalidTexture, 0, 0 });
+	return (GLuint)entries.size() - 1;
+}
+
+bool TextureManager::build(GLuint atlasPageSize, GLuint maxAtlasedSize)
+{
+	for (auto& array : arrays)
+	{
+		glDeleteTextures(1, &array.texture);
+	}
+	arrays.clear();
+
+	// The same cached mip chains Texture loads, built in linear light, so nothing is decoded or
+	// filtered by the driver here once the cache is warm.
+	std::vector<Ktx2Image> chains(entries.size());
+	ThreadPool::getShared().parallelFor(entries.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			bool fromCache = false;
+			entries[i].array = invalidTexture;
+			const char* fileLocation = entries[i].fileLocation.c_str();
+			// The arrays are RGBA8, so only an uncompressed cooked file will do; otherwise the mip cache,
+			// which cooking fills too.
+			bool cooked = TextureCompressor::loadCooked(fileLocation, Texture::getMipFilter(), Texture::getMipsInLinearLight(), false, chains[i], fromCache) &&
+				Ktx2File::getChannelCount(chains[i].vkFormat) != 0;
+			if (!cooked)
+			{
+				chains[i] = Ktx2Image();
+			}
+			if (cooked || TextureCompressor::loadOrBuildMips(fileLocation, Texture::textureCacheDirectory, Texture::getMipFilter(),
+				Texture::getMipsInLinearLight(), chains[i], fromCache))
+			{
+				entries[i].width = (int)chains[i].width;
+				entries[i].height = (int)chains[i].height;
+			}
+		}
+	});
+
+	slots.assign(entries.size(), { glm::vec4(0.f, 0.f, 1.f, 1.f), 0, { 0, 0, 0 } });
+
+	std::vector<GLuint> atlased;
+	std::map<std::pair<int, int>, std::vector<GLuint>> bySize;
+	for (GLuint i = 0; i < (GLuint)entries.size(); i++)
+	{
+		if (chains[i].getLevelCount() == 0)
+		{
+			printf("ERROR::TextureManager::build failed to load: %s\n", entries[i].fileLocation.c_str());
+			continue;
+		}
+
+		GLuint paddedWidth = entries[i].width + 2 * atlasPadding;
+		GLuint paddedHeight = entries[i].height + 2 * atlasPadding;
+		if ((GLuint)std::max(entries[i].width, entries[i].height) <= maxAtlasedSize && paddedWidth <= atlasPageSize && paddedHeight <= atlasPageSize)
+		{
+			atlased.push_back(i);
+		}
+		else
+		{
+			bySize[{ entries[i].width, entries[i].height }].push_back(i);
+		}
+	}
+
+	// Tallest first packs a skyline tightly.
+	std::sort(atlased.begin(), atlased.end(), [this](GLuint a, GLuint b)
+	{
+		return entries[a].height > entries[b].height;
+	});
+
+	std::vector<RectPacker> pages;
+	std::vector<std::vector<GLuint>> pageEntries;
+	std::vector<glm::uvec2> positions(entries.size());
+	for (GLuint index : atlased)
+	{
+		GLuint rectWidth = (entries[index].width + 2 * atlasPadding + atlasPadding - 1) / atlasPadding * atlasPadding;
+		GLuint rectHeight = (entries[index].height + 2 * atlasPadding + atlasPadding - 1) / atlasPadding * atlasPadding;
+
+		GLuint x = 0;
+		GLuint y = 0;
+		size_t page = 0;
+		while (page < pages.size() && !pages[page].insert(rectWidth, rectHeight, x, y))
+		{
+			page++;
+		}
+		if (page == pages.size())
+		{
+			pages.push_back(RectPacker(atlasPageSize, atlasPageSize));
+			pageEntries.emplace_back();
+			pages.back().insert(rectWidth, rectHeight, x, y);
+		}
+		pageEntries[page].push_back(index);
+		positions[index] = glm::uvec2(x, y);
+
+		GLfloat scale = 1.f / atlasPageSize;
+		slots[index].rect = glm::vec4((x + atlasPadding) * scale, (y + atlasPadding) * scale, entries[index].width * scale, entries[index].height * scale);
+		slots[index].layer = (GLuint)page;
+		entries[index].array = 0;
+	}
+
+	std::vector<unsigned char> scratch;
+	if (!pages.empty())
+	{
+		arrays.push_back({ 0, (GLsizei)atlasPageSize, (GLsizei)atlasPageSize, (GLsizei)pages.size(), atlasLevels, true });
+		arrays.back().texture = createArray(atlasPageSize, atlasPageSize, (GLsizei)pages.size(), atlasLevels);
+
+		// Each level of a page is laid out from the same level of its entries' chains.
+		std::vector<unsigned char> pagePixels;
+		for (GLsizei level = 0; level < atlasLevels; level++)
+		{
+			GLuint levelSize = std::max(1u, atlasPageSize >> level);
+			for (size_t page = 0; page < pages.size(); page++)
+			{
+				pagePixels.assign((size_t)levelSize * levelSize * 4, 0);
+				for (GLuint index : pageEntries[page])
+				{
+					GLuint chainLevel = std::min((GLuint)level, chains[index].getLevelCount() - 1);
+					int width = std::max(1, entries[index].width >> chainLevel);
+					int height = std::max(1, entries[index].height >> chainLevel);
+					copyPadded(getRGBALevel(chains[index], chainLevel, scratch), width, height, (int)(atlasPadding >> level), pagePixels.data(), levelSize,
+						positions[index].x >> level, positions[index].y >> level);
+				}
+				uploadLayer(level, (GLsizei)page, levelSize, levelSize, pagePixels.data());
+			}
+		}
+	}
+
+	for (auto& group : bySize)
+	{
+		GLsizei width = group.first.first;
+		GLsizei height = group.first.second;
+		GLsizei levels = (GLsizei)chains[group.second[0]].getLevelCount();
+		GLsizei layers = (GLsizei)group.second.size();
+
+		arrays.push_back({ 0, width, height, layers, levels, false });
+		arrays.back().texture = createArray(width, height, layers, levels);
+
+		for (GLsizei layer = 0; layer < layers; layer++)
+		{
+			GLuint index = group.second[layer];
+			slots[index].layer = (GLuint)layer;
+			entries[index].array = (GLuint)arrays.size() - 1;
+
+			for (GLsizei level = 0; level < levels; level++)
+			{
+				uploadLayer(level, layer, std::max(1, width >> level), std::max(1, height >> level), getRGBALevel(chains[index], level, scratch));
+			}
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// The block is declared with maxTextures slots, and the bound range must cover all of it.
+	std::vector<TextureSlot> upload(maxTextures, { glm::vec4(0.f, 0.f, 1.f, 1.f), 0, { 0, 0, 0 } });
+	std::copy(slots.begin(), slots.end(), upload.begin());
+
+	if (slotBuffer == 0)
+	{
+		glGenBuffers(1, &slotBuffer);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, slotBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, upload.size() * sizeof(TextureSlot), upload.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	for (size_t i = 0; i < pages.size(); i++)
+	{
+		printf("TextureManager: atlas page %zu is %.0f%% full\n", i, pages[i].getOccupancy() * 100.f);
+	}
+	return !entries.empty() && std::all_of(chains.begin(), chains.end(), [](const Ktx2Image& chain) { return chain.getLevelCount() > 0; });
+}
+
+GLuint TextureManager::getArrayTexture(GLuint textureIndex)
+{
+	if (textureIndex >= entries.size() || entries[textureIndex].array == invalidTexture)
+	{
+		return 0;
+	}
+	return arrays[entries[textureIndex].array].texture;
+}
+
+void TextureManager::bindArray(GLuint textureIndex)
+{
+	bindArrayTexture(getArrayTexture(textureIndex));
+}
+
+void TextureManager::bindArrayTexture(GLuint arrayTexture)
+{
+	glActiveTexture(GL_TEXTURE0 + Shader::textureArrayUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, arrayTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void TextureManager::bindSlots()
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, Shader::textureSlotBinding, slotBuffer);
+}
+
+void TextureManager::printStats()
+{
+	size_t totalBytes = 0;
+	for (auto& array : arrays)
+	{
+		size_t bytes = 0;
+		for (GLsizei level = 0; level < array.levels; level++)
+		{
+			bytes += (size_t)std::max(1, array.width >> level) * std::max(1, array.height >> level) * array.layers * 4;
+		}
+		totalBytes += bytes;
+		printf("TextureManager: %s array %dx%d, %d layers, %d levels, %zu KB\n", array.atlas ? "atlas" : "texture",
+			array.width, array.height, array.layers, array.levels, bytes / 1024);
+	}
+	printf("TextureManager: %zu textures in %zu arrays, %zu KB\n", entries.size(), arrays.size(), totalBytes / 1024);
+}
+
+void TextureManager::clearTextureManager()
+{
+	for (auto& array : arrays)
+	{
+		glDeleteTextures(1, &array.texture);
+	}
+
+	if (slotBuffer != 0)
+	{
+		glDeleteBuffers(1, &slotBuffer);
+		slotBuffer = 0;
+	}
+
+	entries.clear();
+	arrays.clear();
+	slots.clear();
+}
+
+TextureManager::~TextureManager()
+{
+	clearTextureManager();
+}
+
+GLuint TextureManager::createArray(GLsizei width, GLsizei height, GLsizei layers, GLsizei levels)
+{
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	if (GLEW_ARB_texture_storage || GLEW_VERSION_4_2)
+	{
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, width, height, layers);
+	}
+	else
+	{
+		for (GLsizei level = 0; level < levels; level++)
+		{
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, std::max(1, width >> level), std::max(1, height >> level), layers, 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+	}
+	return texture;
+}
+
+void TextureManager::uploadLayer(GLsizei level, GLsizei layer, GLsizei width, GLsizei height, const unsigned char* pixels)
+{
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "RectPacker.h"
+
+// Matches TextureSlot in Shaders/textureSlots.glsl (std140). rect is the texture's
+// offset and scale inside its layer, (0, 0, 1, 1) when it owns the whole layer.
+struct TextureSlot
+{
+	glm::vec4 rect;
+	GLuint layer;
+	GLuint padding[3];
+};
+
+// Packs textures into a few GL_TEXTURE_2D_ARRAY objects so draws select one by index instead of
+// binding it. Textures of the same size share an array a layer each; ones up to maxAtlasedSize
+// are packed into atlas pages, which are layers of their own array. Shaders read the slot table
+// from a uniform block and sample the array bound to Shader::textureArrayUnit.
+class TextureManager
+{
+public:
+	// Size of the textureSlots array in Shaders/textureSlots.glsl.
+	static const GLuint maxTextures = 256;
+	static const GLuint invalidTexture = 0xFFFFFFFF;
+
+	TextureManager();
+
+	// Queues a file to be packed by build() and returns its index.
+	GLuint addTexture(const char* fileLocation);
+	// Loads every queued file's mip chain on the shared thread pool, from the same cache Texture
+	// uses, packs them and uploads every level of the arrays. An atlas page is atlasPageSize square.
+	// Blocks until all of that is done and nothing streams: arrays are not managed by
+	// TextureStreamer, so without bindless textures startup waits on it, and on a cold cache that
+	// includes decoding every source. Cooking with --cook, or any earlier run, fills the cache.
+	bool build(GLuint atlasPageSize = 2048, GLuint maxAtlasedSize = 1024);
+
+	// Draws with textures from the same array can share a batch.
+	GLuint getArrayTexture(GLuint textureIndex);
+	void bindArray(GLuint textureIndex);
+	static void bindArrayTexture(GLuint arrayTexture);
+	// Binds the slot table to Shader::textureSlotBinding.
+	void bindSlots();
+
+	GLuint getTextureCount() { return (GLuint)entries.size(); }
+	GLuint getArrayCount() { return (GLuint)arrays.size(); }
+	void printStats();
+
+	void clearTextureManager();
+
+	~TextureManager();
+
+private:
+	struct Entry
+	{
+		std::string fileLocation;
+		GLuint array;
+		int width;
+		int height;
+	};
+
+	struct TextureArray
+	{
+		GLuint texture;
+		GLsizei width;
+		GLsizei height;
+		GLsizei layers;
+		GLsizei levels;
+		bool atlas;
+	};
+
+	std::vector<Entry> entries;
+	std::vector<TextureArray> arrays;
+	std::vector<TextureSlot> slots;
+	GLuint slotBuffer;
+
+	// Leaves the new array bound for uploadLayer().
+	GLuint createArray(GLsizei width, GLsizei height, GLsizei layers, GLsizei levels);
+	static void uploadLayer(GLsizei level, GLsizei layer, GLsizei width, GLsizei height, const unsigned char* pixels);
+};
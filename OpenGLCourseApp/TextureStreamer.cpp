@@ -0,0 +1,189 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// A texture not drawn for this many frames only needs its tail levels.
+	const GLuint64 staleFrames = 120;
+}
+
+TextureStreamer::TextureStreamer()
+{
+	uploader = nullptr;
+	budgetBytes = 0;
+	uploadBytesPerFrame = 0;
+	residentBytes = 0;
+	frame = 0;
+
+	levelsLoaded = 0;
+	levelsEvicted = 0;
+	bytesLoaded = 0;
+}
+
+void TextureStreamer::init(size_t budgetBytes, size_t uploadBytesPerFrame, UploadThread* uploader)
+{
+	this->budgetBytes = budgetBytes;
+	this->uploadBytesPerFrame = uploadBytesPerFrame;
+	this->uploader = uploader;
+}
+
+void TextureStreamer::addTexture(Texture* texture)
+{
+	if (indices.count(texture) > 0)
+	{
+		return;
+	}
+
+	indices[texture] = entries.size();
+	// Until it is drawn a texture only wants its tail.
+	entries.push_back({ texture, 0.f, 0xFFFFFFFF, 0 });
+	texture->loadTextureStreamed();
+}
+
+void TextureStreamer::noteUse(Texture* texture, GLfloat screenSize)
+{
+	auto found = indices.find(texture);
+	if (found == indices.end())
+	{
+		return;
+	}
+
+	Entry& entry = entries[found->second];
+	if (entry.lastUsedFrame != frame)
+	{
+		entry.screenSize = 0.f;
+	}
+	entry.screenSize = std::max(entry.screenSize, screenSize);
+	entry.lastUsedFrame = frame;
+}
+
+void TextureStreamer::update()
+{
+	residentBytes = 0;
+	std::vector<Entry*> candidates;
+
+	for (auto& entry : entries)
+	{
+		entry.texture->updateLoad();
+		if (!entry.texture->isStreamed())
+		{
+			continue;
+		}
+
+		// Roughly one texel per pixel: each halving of screen size drops a level.
+		GLuint tailLevel = entry.texture->getTailLevel();
+		if (entry.lastUsedFrame == frame && entry.screenSize > 0.f)
+		{
+			GLfloat texels = (GLfloat)std::max(entry.texture->getWidth(), entry.texture->getHeight());
+			GLfloat level = std::floor(std::log2(std::max(texels / entry.screenSize, 1.f)));
+			entry.wantedLevel = std::min((GLuint)level, tailLevel);
+		}
+		else if (frame - entry.lastUsedFrame > staleFrames)
+		{
+			entry.wantedLevel = tailLevel;
+		}
+
+		for (GLuint level = entry.texture->getResidentLevel(); level < entry.texture->getLevelCount(); level++)
+		{
+			residentBytes += entry.texture->getLevelBytes(level);
+		}
+
+		entry.wantedLevel = std::min(entry.wantedLevel, tailLevel);
+		if (entry.texture->getResidentLevel() > entry.wantedLevel && !entry.texture->isResidencyPending())
+		{
+			candidates.push_back(&entry);
+		}
+	}
+
+	// Whatever is largest on screen this frame streams first.
+	std::sort(candidates.begin(), candidates.end(), [this](const Entry* a, const Entry* b)
+	{
+		GLfloat aSize = a->lastUsedFrame == frame ? a->screenSize : 0.f;
+		GLfloat bSize = b->lastUsedFrame == frame ? b->screenSize : 0.f;
+		return aSize > bSize;
+	});
+
+	size_t uploaded = 0;
+	for (Entry* entry : candidates)
+	{
+		GLuint level = entry->texture->getResidentLevel() - 1;
+		size_t bytes = entry->texture->getLevelBytes(level);
+		if (uploaded > 0 && uploaded + bytes > uploadBytesPerFrame)
+		{
+			break;
+		}
+
+		if (residentBytes + bytes > budgetBytes && !evict(residentBytes + bytes - budgetBytes, entry))
+		{
+			continue;
+		}
+
+		if (entry->texture->setResidentLevel(level, uploader))
+		{
+			residentBytes += bytes;
+			uploaded += bytes;
+			bytesLoaded += bytes;
+			levelsLoaded++;
+		}
+	}
+
+	frame++;
+}
+
+void TextureStreamer::printStats()
+{
+	printf("TextureStreamer: %zu textures, %zu KB resident of a %zu KB budget, %llu levels loaded (%zu KB), %llu evicted\n",
+		entries.size(), residentBytes / 1024, budgetBytes / 1024, (unsigned long long)levelsLoaded, bytesLoaded / 1024,
+		(unsigned long long)levelsEvicted);
+}
+
+void TextureStreamer::clearTextureStreamer()
+{
+	entries.clear();
+	indices.clear();
+	residentBytes = 0;
+	frame = 0;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	clearTextureStreamer();
+}
+
+bool TextureStreamer::evict(size_t bytes, const Entry* keep)
+{
+	size_t freed = 0;
+	while (freed < bytes)
+	{
+		// Only levels finer than a texture needs can go, oldest use first.
+		Entry* victim = nullptr;
+		for (auto& entry : entries)
+		{
+			if (&entry == keep || !entry.texture->isStreamed() || entry.texture->isResidencyPending() ||
+				entry.texture->getResidentLevel() >= std::min(entry.wantedLevel, entry.texture->getTailLevel()))
+			{
+				continue;
+			}
+			if (!victim || entry.lastUsedFrame < victim->lastUsedFrame)
+			{
+				victim = &entry;
+			}
+		}
+
+		if (!victim)
+		{
+			return false;
+		}
+
+		GLuint level = victim->texture->getResidentLevel();
+		size_t levelBytes = victim->texture->getLevelBytes(level);
+		victim->texture->setResidentLevel(level + 1, uploader);
+
+		freed += levelBytes;
+		residentBytes -= levelBytes;
+		levelsEvicted++;
+	}
+	return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "Texture.h"
+#include "UploadThread.h"
+
+// Moves streamed textures' resident level towards what their on screen size needs, one level per
+// texture per update and at most uploadBytesPerFrame of new levels each time. Levels beyond a
+// texture's need are kept while they fit in budgetBytes, then evicted least recently used first.
+class TextureStreamer
+{
+public:
+	TextureStreamer();
+
+	// With an uploader, rebuilds run on its thread instead of stalling the render thread.
+	void init(size_t budgetBytes, size_t uploadBytesPerFrame, UploadThread* uploader = nullptr);
+
+	// Starts loading texture with loadTextureStreamed(); it must outlive the streamer.
+	void addTexture(Texture* texture);
+	// screenSize is the size in pixels of what texture was drawn on this frame.
+	void noteUse(Texture* texture, GLfloat screenSize);
+	// Call once a frame, after drawing.
+	void update();
+
+	size_t getResidentBytes() { return residentBytes; }
+	void printStats();
+
+	void clearTextureStreamer();
+
+	~TextureStreamer();
+
+private:
+	struct Entry
+	{
+		Texture* texture;
+		GLfloat screenSize;
+		GLuint wantedLevel;
+		GLuint64 lastUsedFrame;
+	};
+
+	std::vector<Entry> entries;
+	std::unordered_map<Texture*, size_t> indices;
+	UploadThread* uploader;
+	size_t budgetBytes;
+	size_t uploadBytesPerFrame;
+	size_t residentBytes;
+	GLuint64 frame;
+
+	GLuint64 levelsLoaded;
+	GLuint64 levelsEvicted;
+	size_t bytesLoaded;
+
+	bool evict(size_t bytes, const Entry* keep);
+};
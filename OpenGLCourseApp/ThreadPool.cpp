@@ -0,0 +1,149 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool()
+{
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	startWorkers(hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+	parallelThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	startWorkers(threadCount > 0 ? threadCount : 1);
+	parallelThreads = threadCount;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	size_t maxChunks = (size_t)parallelThreads * 4 + 1;
+	size_t chunkSize = std::max(grainSize, (count + maxChunks - 1) / maxChunks);
+	size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	if (chunkCount == 1)
+	{
+		body(0, count);
+		return;
+	}
+
+	// Helpers can still be queued after the last chunk finished, so what they touch is shared. They
+	// only reach body after claiming a chunk, which can't happen once this call has returned.
+	struct Shared
+	{
+		std::atomic<size_t> nextChunk;
+		size_t chunkSize;
+		size_t chunkCount;
+		size_t count;
+		const std::function<void(size_t begin, size_t end)>* body;
+		size_t finished;
+		std::mutex doneMutex;
+		std::condition_variable doneCondition;
+	};
+
+	std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+	shared->nextChunk = 0;
+	shared->chunkSize = chunkSize;
+	shared->chunkCount = chunkCount;
+	shared->count = count;
+	shared->body = &body;
+	shared->finished = 0;
+
+	auto runChunks = [](Shared& state)
+	{
+		size_t ran = 0;
+		for (size_t chunk = state.nextChunk++; chunk < state.chunkCount; chunk = state.nextChunk++)
+		{
+			size_t begin = chunk * state.chunkSize;
+			(*state.body)(begin, std::min(state.count, begin + state.chunkSize));
+			ran++;
+		}
+
+		if (ran > 0)
+		{
+			std::lock_guard<std::mutex> lock(state.doneMutex);
+			state.finished += ran;
+			if (state.finished == state.chunkCount)
+			{
+				state.doneCondition.notify_all();
+			}
+		}
+	};
+
+	size_t helperCount = std::min(chunkCount - 1, (size_t)parallelThreads);
+	for (size_t i = 0; i < helperCount; i++)
+	{
+		enqueue([shared, runChunks]() { runChunks(*shared); });
+	}
+
+	runChunks(*shared);
+
+	// Every chunk is claimed by now, and whoever claimed one is running it, so this only waits on
+	// work that is already under way.
+	std::unique_lock<std::mutex> lock(shared->doneMutex);
+	shared->doneCondition.wait(lock, [&]() { return shared->finished == chunkCount; });
+}
+
+ThreadPool& ThreadPool::getShared()
+{
+	static ThreadPool sharedPool;
+	return sharedPool;
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::startWorkers(unsigned int threadCount)
+{
+	stopping = false;
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		tasks.push_back(std::move(task));
+	}
+	queueCondition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty())
+			{
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
+	}
+}
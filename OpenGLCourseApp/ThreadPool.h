@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	ThreadPool();
+	ThreadPool(unsigned int threadCount);
+
+	template<typename Task>
+	auto submit(Task task) -> std::future<decltype(task())>
+	{
+		typedef decltype(task()) Result;
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> result = packaged->get_future();
+		enqueue([packaged]() { (*packaged)(); });
+		return result;
+	}
+
+	// Splits [0, count) into chunks of at least grainSize and blocks until all of them ran.
+	// The calling thread claims chunks of this call alongside the workers and never runs other
+	// queued tasks, so nesting is safe and a long task can't hold it up.
+	void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& body);
+
+	unsigned int getThreadCount() { return (unsigned int)workers.size(); }
+	// Workers parallelFor spreads over. None on a single core machine, where the one worker is only
+	// there so submit stays asynchronous and parallelFor runs everything on the calling thread.
+	unsigned int getParallelThreadCount() { return parallelThreads; }
+
+	static ThreadPool& getShared();
+
+	~ThreadPool();
+
+private:
+	std::vector<std::thread> workers;
+	unsigned int parallelThreads;
+	std::deque<std::function<void()>> tasks;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool stopping;
+
+	void startWorkers(unsigned int threadCount);
+	void enqueue(std::function<void()> task);
+	void workerLoop();
+};
@@ -0,0 +1,229 @@
+#include "UploadThread.h"
+
+UploadThread::UploadThread() : uploads(queueCapacity), completed(queueCapacity)
+{
+	uploadWindow = nullptr;
+	stopping = false;
+	pendingCount = 0;
+	bytesUploaded = 0;
+	uploadsCompleted = 0;
+	frameJobs = defaultFrameJobs;
+	frameBytes = defaultFrameBytes;
+}
+
+bool UploadThread::start(GLFWwindow* sharedWith)
+{
+	if (isRunning())
+	{
+		return true;
+	}
+
+	renderThread = std::this_thread::get_id();
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	uploadWindow = glfwCreateWindow(1, 1, "Upload", NULL, sharedWith);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (!uploadWindow)
+	{
+		printf("UploadThread::start no shared context, uploading on the render thread\n");
+		return false;
+	}
+
+	stopping = false;
+	worker = std::thread(&UploadThread::workerLoop, this);
+	return true;
+}
+
+void UploadThread::stop()
+{
+	if (isRunning())
+	{
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			stopping = true;
+		}
+		wakeCondition.notify_one();
+		worker.join();
+	}
+
+	if (uploadWindow)
+	{
+		glfwDestroyWindow(uploadWindow);
+		uploadWindow = nullptr;
+	}
+
+	// With the worker gone publish() runs what is left here. An onReady may submit more, so keep
+	// going until nothing is pending.
+	while (getPendingCount() > 0)
+	{
+		if (publish((size_t)-1, (size_t)-1) == 0)
+		{
+			// Fences made on this context only signal once it has been flushed.
+			glFlush();
+			std::this_thread::yield();
+		}
+	}
+}
+
+void UploadThread::submit(UploadFunction upload, ReadyFunction onReady)
+{
+	UploadJob job = { std::move(upload), std::move(onReady) };
+	pendingCount++;
+
+	bool onRenderThread = std::this_thread::get_id() == renderThread;
+	while (!uploads.tryPush(std::move(job)))
+	{
+		// Only the render thread empties completed, and without a worker only it runs uploads, so
+		// when it is the one submitting, e.g. from onReady, it has to make the room itself.
+		if (onRenderThread)
+		{
+			UploadJob queued;
+			if (!isRunning() && uploads.tryPop(queued))
+			{
+				inFlight.push_back(runUpload(queued));
+			}
+			collectCompleted();
+		}
+		std::this_thread::yield();
+	}
+
+	// Pairs with the second check under the lock in workerLoop().
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+	}
+	wakeCondition.notify_one();
+}
+
+UploadThread::CompletedJob UploadThread::runUpload(UploadJob& job)
+{
+	bytesUploaded += job.upload();
+
+	CompletedJob done = { glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(job.onReady) };
+	// Without a flush the fence could sit in this context's command queue and never signal.
+	glFlush();
+	return done;
+}
+
+void UploadThread::pushCompleted(CompletedJob done)
+{
+	while (!completed.tryPush(std::move(done)))
+	{
+		std::this_thread::yield();
+	}
+}
+
+void UploadThread::workerLoop()
+{
+	glfwMakeContextCurrent(uploadWindow);
+
+	UploadJob job;
+	for (;;)
+	{
+		if (uploads.tryPop(job))
+		{
+			pushCompleted(runUpload(job));
+			continue;
+		}
+
+		// Checking again under the lock means a submit that lands now is either seen here or its
+		// notify arrives after this thread is waiting.
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		if (stopping)
+		{
+			break;
+		}
+		if (uploads.tryPop(job))
+		{
+			lock.unlock();
+			pushCompleted(runUpload(job));
+			continue;
+		}
+		wakeCondition.wait(lock);
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+size_t UploadThread::publishCompleted()
+{
+	return publish(frameJobs, frameBytes);
+}
+
+void UploadThread::collectCompleted()
+{
+	CompletedJob done;
+	while (completed.tryPop(done))
+	{
+		inFlight.push_back(std::move(done));
+	}
+}
+
+size_t UploadThread::publish(size_t maxJobs, size_t maxBytes)
+{
+	if (!isRunning())
+	{
+		// This thread is the only consumer of completed, so results skip it rather than wait for
+		// room there.
+		unsigned long long startBytes = bytesUploaded.load();
+		UploadJob job;
+		for (size_t i = 0; i < maxJobs && bytesUploaded.load() - startBytes < maxBytes && uploads.tryPop(job); i++)
+		{
+			inFlight.push_back(runUpload(job));
+		}
+	}
+
+	collectCompleted();
+
+	size_t published = 0;
+	while (published < maxJobs && !inFlight.empty())
+	{
+		CompletedJob& front = inFlight.front();
+		if (front.fence)
+		{
+			if (glClientWaitSync(front.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			{
+				break;
+			}
+			glDeleteSync(front.fence);
+		}
+
+		// Popped first, as onReady may submit and so push to inFlight itself.
+		ReadyFunction onReady = std::move(front.onReady);
+		inFlight.pop_front();
+		if (onReady)
+		{
+			onReady();
+		}
+
+		pendingCount--;
+		uploadsCompleted++;
+		published++;
+	}
+
+	return published;
+}
+
+void UploadThread::printStats()
+{
+	printf("UploadThread: %s, %llu uploads published, %zu pending, %.2f MB uploaded\n",
+		isRunning() ? "shared context" : "render thread", uploadsCompleted, getPendingCount(), bytesUploaded.load() / (1024.0 * 1024.0));
+}
+
+UploadThread::~UploadThread()
+{
+	stop();
+
+	for (CompletedJob& done : inFlight)
+	{
+		if (done.fence)
+		{
+			glDeleteSync(done.fence);
+		}
+	}
+	inFlight.clear();
+}
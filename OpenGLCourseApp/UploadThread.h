@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <GL\glew.h>
+#include <GLFW\glfw3.h>
+
+#include "LockFreeQueue.h"
+
+// Runs GL uploads on a worker thread that owns a hidden window whose context shares objects with
+// the main one. Each upload is followed by a fence, and its onReady callback runs on the render
+// thread from publishCompleted() once the GPU has passed that fence, so the render thread never
+// sees a half written buffer or texture. Vertex arrays are not shared between contexts, so onReady
+// is where they get created. If no shared context can be made, publishCompleted() runs the
+// uploads itself instead. Uploads run in the order they were submitted and their onReady
+// callbacks are published in that same order.
+class UploadThread
+{
+public:
+	// Returns the bytes it uploaded, for the stats.
+	typedef std::function<size_t()> UploadFunction;
+	typedef std::function<void()> ReadyFunction;
+
+	static const size_t queueCapacity = 1024;
+	static const size_t defaultFrameJobs = 64;
+	static const size_t defaultFrameBytes = 16 * 1024 * 1024;
+
+	UploadThread();
+
+	// Must be called on the thread that created sharedWith, as GLFW only creates windows there.
+	// That thread is taken to be the render thread.
+	bool start(GLFWwindow* sharedWith);
+	// Render thread, with its context current. Finishes everything still queued and publishes it,
+	// so no onReady is lost and nothing an upload created leaks.
+	void stop();
+	bool isRunning() { return worker.joinable(); }
+
+	// Safe from any thread, including from onReady. Blocks while the queue is full.
+	void submit(UploadFunction upload, ReadyFunction onReady);
+	// Render thread only, once a frame. Returns how many uploads were published. Publishes at most
+	// maxJobs of them and, without a shared context, runs queued uploads itself until maxBytes have
+	// been uploaded. Whatever is left waits for the next call.
+	size_t publishCompleted();
+	void setFrameBudget(size_t maxJobs, size_t maxBytes) { frameJobs = maxJobs; frameBytes = maxBytes; }
+
+	size_t getPendingCount() { return pendingCount.load(); }
+	unsigned long long getBytesUploaded() { return bytesUploaded.load(); }
+	unsigned long long getUploadsCompleted() { return uploadsCompleted; }
+	void printStats();
+
+	~UploadThread();
+
+private:
+	struct UploadJob
+	{
+		UploadFunction upload;
+		ReadyFunction onReady;
+	};
+
+	struct CompletedJob
+	{
+		GLsync fence;
+		ReadyFunction onReady;
+	};
+
+	GLFWwindow* uploadWindow;
+	std::thread worker;
+	std::thread::id renderThread;
+	std::atomic<bool> stopping;
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+
+	LockFreeQueue<UploadJob> uploads;
+	LockFreeQueue<CompletedJob> completed;
+	// Popped from completed but still waiting on their fence; render thread only.
+	std::deque<CompletedJob> inFlight;
+
+	std::atomic<size_t> pendingCount;
+	std::atomic<unsigned long long> bytesUploaded;
+	unsigned long long uploadsCompleted;
+	size_t frameJobs;
+	size_t frameBytes;
+
+	void workerLoop();
+	CompletedJob runUpload(UploadJob& job);
+	void pushCompleted(CompletedJob done);
+	void collectCompleted();
+	size_t publish(size_t maxJobs, size_t maxBytes);
+};
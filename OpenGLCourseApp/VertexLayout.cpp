@@ -0,0 +1,172 @@
+#include "VertexLayout.h"
+
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+
+void VertexLayoutDesc::apply(GLintptr baseOffset) const
+{
+	for (GLuint i = 0; i < attributeCount; i++)
+	{
+		const VertexAttribDesc& attribute = attributes[i];
+		glVertexAttribPointer(i, attribute.components, attribute.type, attribute.normalized, stride,
+			(void*)(baseOffset + attribute.offset));
+		glEnableVertexAttribArray(i);
+	}
+}
+
+bool VertexLayoutDesc::operator==(const VertexLayoutDesc& other) const
+{
+	if (attributeCount != other.attributeCount || stride != other.stride)
+	{
+		return false;
+	}
+
+	for (GLuint i = 0; i < attributeCount; i++)
+	{
+		const VertexAttribDesc& a = attributes[i];
+		const VertexAttribDesc& b = other.attributes[i];
+		if (a.components != b.components || a.type != b.type || a.normalized != b.normalized || a.offset != b.offset)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+GLushort VertexPacking::packHalf(GLfloat value)
+{
+	GLuint bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+
+	GLuint sign = (bits >> 16) & 0x8000;
+	GLint exponent = (GLint)((bits >> 23) & 0xff) - 127 + 15;
+	GLuint mantissa = bits & 0x7fffff;
+
+	if (((bits >> 23) & 0xff) == 0xff)
+	{
+		return (GLushort)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	}
+	if (exponent >= 31)
+	{
+		return (GLushort)(sign | 0x7c00);
+	}
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return (GLushort)sign;
+		}
+		mantissa |= 0x800000;
+		GLuint shift = (GLuint)(14 - exponent);
+		GLuint half = mantissa >> shift;
+		GLuint remainder = mantissa & ((1u << shift) - 1);
+		GLuint halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+		{
+			half++;
+		}
+		return (GLushort)(sign | half);
+	}
+
+	GLuint half = sign | ((GLuint)exponent << 10) | (mantissa >> 13);
+	GLuint remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		half++;
+	}
+	return (GLushort)half;
+}
+
+GLfloat VertexPacking::unpackHalf(GLushort value)
+{
+	GLuint sign = (GLuint)(value & 0x8000) << 16;
+	GLuint exponent = (value >> 10) & 0x1f;
+	GLuint mantissa = value & 0x3ff;
+	GLuint bits = 0;
+
+	if (exponent == 0)
+	{
+		GLfloat result = ldexpf((GLfloat)mantissa, -24);
+		return sign ? -result : result;
+	}
+	if (exponent == 31)
+	{
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+
+	GLfloat result = 0.f;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+GLushort VertexPacking::packUnorm16(GLfloat value)
+{
+	value = value < 0.f ? 0.f : (value > 1.f ? 1.f : value);
+	return (GLushort)(value * 65535.f + 0.5f);
+}
+
+GLuint VertexPacking::packSnorm2101010Rev(GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+	auto snorm = [](GLfloat value, GLfloat maxValue, GLuint mask)
+	{
+		value = value < -1.f ? -1.f : (value > 1.f ? 1.f : value);
+		GLint quantised = (GLint)roundf(value * maxValue);
+		return (GLuint)quantised & mask;
+	};
+
+	return snorm(x, 511.f, 0x3ff)
+		| (snorm(y, 511.f, 0x3ff) << 10)
+		| (snorm(z, 511.f, 0x3ff) << 20)
+		| (snorm(w, 1.f, 0x3) << 30);
+}
+
+void VertexPacking::packStandardVertices(const GLfloat* vertices, unsigned int vertexCount, unsigned int vLength,
+	PackedVertex* packed, GLfloat* positionScale, GLfloat* positionOffset)
+{
+	GLfloat minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	GLfloat maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		const GLfloat* vertex = vertices + i * vLength;
+		for (int c = 0; c < 3; c++)
+		{
+			minPos[c] = fminf(minPos[c], vertex[c]);
+			maxPos[c] = fmaxf(maxPos[c], vertex[c]);
+		}
+	}
+
+	for (int c = 0; c < 3; c++)
+	{
+		if (vertexCount == 0)
+		{
+			minPos[c] = 0.f;
+			maxPos[c] = 0.f;
+		}
+		positionOffset[c] = minPos[c];
+		positionScale[c] = maxPos[c] > minPos[c] ? maxPos[c] - minPos[c] : 1.f;
+	}
+
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		const GLfloat* vertex = vertices + i * vLength;
+		PackedVertex& out = packed[i];
+
+		for (int c = 0; c < 3; c++)
+		{
+			out.position[c] = packUnorm16((vertex[c] - positionOffset[c]) / positionScale[c]);
+		}
+		out.position[3] = 65535;
+
+		out.texCoord[0] = packHalf(vertex[3]);
+		out.texCoord[1] = packHalf(vertex[4]);
+
+		out.normal = packSnorm2101010Rev(vertex[5], vertex[6], vertex[7]);
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <GL\glew.h>
+
+namespace VertexAttrib
+{
+	template<GLint Components, GLenum Type, GLboolean Normalized, GLuint Size>
+	struct Format
+	{
+		static constexpr GLint components = Components;
+		static constexpr GLenum type = Type;
+		static constexpr GLboolean normalized = Normalized;
+		static constexpr GLuint size = Size;
+	};
+
+	typedef Format<2, GL_FLOAT, GL_FALSE, 8> Float2;
+	typedef Format<3, GL_FLOAT, GL_FALSE, 12> Float3;
+	typedef Format<4, GL_FLOAT, GL_FALSE, 16> Float4;
+	typedef Format<2, GL_HALF_FLOAT, GL_FALSE, 4> Half2;
+	typedef Format<4, GL_HALF_FLOAT, GL_FALSE, 8> Half4;
+	typedef Format<4, GL_UNSIGNED_SHORT, GL_TRUE, 8> Unorm16x4;
+	typedef Format<4, GL_SHORT, GL_TRUE, 8> Snorm16x4;
+	typedef Format<4, GL_INT_2_10_10_10_REV, GL_TRUE, 4> Snorm2101010Rev;
+}
+
+struct VertexAttribDesc
+{
+	GLint components;
+	GLenum type;
+	GLboolean normalized;
+	GLuint offset;
+};
+
+struct VertexLayoutDesc
+{
+	static constexpr GLuint maxAttributes = 8;
+
+	GLuint attributeCount;
+	GLsizei stride;
+	VertexAttribDesc attributes[maxAttributes];
+
+	void apply(GLintptr baseOffset = 0) const;
+
+	bool operator==(const VertexLayoutDesc& other) const;
+	bool operator!=(const VertexLayoutDesc& other) const { return !(*this == other); }
+};
+
+// Attributes are bound to locations 0..N-1 in declaration order, tightly packed.
+template<typename... Attribs>
+class VertexLayout
+{
+public:
+	static constexpr GLuint attributeCount = sizeof...(Attribs);
+	static constexpr GLsizei stride = (0 + ... + Attribs::size);
+
+	static_assert(attributeCount <= VertexLayoutDesc::maxAttributes, "VertexLayout has too many attributes");
+	static_assert(stride % 4 == 0, "VertexLayout stride must be 4 byte aligned");
+
+	static constexpr GLuint offsetOf(GLuint index)
+	{
+		constexpr GLuint sizes[] = { Attribs::size... };
+		GLuint offset = 0;
+		for (GLuint i = 0; i < index; i++)
+		{
+			offset += sizes[i];
+		}
+		return offset;
+	}
+
+	static constexpr VertexLayoutDesc makeDesc()
+	{
+		constexpr GLint components[] = { Attribs::components... };
+		constexpr GLenum types[] = { Attribs::type... };
+		constexpr GLboolean normalized[] = { Attribs::normalized... };
+
+		VertexLayoutDesc result = {};
+		result.attributeCount = attributeCount;
+		result.stride = stride;
+		for (GLuint i = 0; i < attributeCount; i++)
+		{
+			result.attributes[i] = { components[i], types[i], normalized[i], offsetOf(i) };
+		}
+		return result;
+	}
+
+	static constexpr VertexLayoutDesc desc = makeDesc();
+
+	static void apply()
+	{
+		desc.apply();
+	}
+};
+
+//	  x, y, z		u, v		nx, ny, nz
+typedef VertexLayout<VertexAttrib::Float3, VertexAttrib::Float2, VertexAttrib::Float3> StandardVertexLayout;
+
+//	  x, y, z		u, v		nx, ny, nz		tx, ty, tz, handedness
+typedef VertexLayout<VertexAttrib::Float3, VertexAttrib::Float2, VertexAttrib::Float3, VertexAttrib::Float4> TangentVertexLayout;
+
+// 16 bytes instead of 32: positions quantised to the mesh bounds, half float uvs, 10 bit normals.
+typedef VertexLayout<VertexAttrib::Unorm16x4, VertexAttrib::Half2, VertexAttrib::Snorm2101010Rev> PackedVertexLayout;
+
+struct PackedVertex
+{
+	GLushort position[4];
+	GLushort texCoord[2];
+	GLuint normal;
+};
+
+static_assert(sizeof(PackedVertex) == PackedVertexLayout::stride, "PackedVertex does not match PackedVertexLayout");
+
+namespace VertexPacking
+{
+	GLushort packHalf(GLfloat value);
+	GLfloat unpackHalf(GLushort value);
+	GLushort packUnorm16(GLfloat value);
+	GLuint packSnorm2101010Rev(GLfloat x, GLfloat y, GLfloat z, GLfloat w = 0.f);
+
+	// Converts vertices in StandardVertexLayout (vLength floats each) to PackedVertex.
+	// Positions are stored relative to the mesh bounds; pos = packed * scale + offset.
+	void packStandardVertices(const GLfloat* vertices, unsigned int vertexCount, unsigned int vLength,
+		PackedVertex* packed, GLfloat* positionScale, GLfloat* positionOffset);
+}
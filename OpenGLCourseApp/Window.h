@@ -22,6 +22,11 @@ public:
 		return (GLfloat)bufferHeight;
 	}
 
+	GLFWwindow* getWindow()
+	{
+		return mainWindow;
+	}
+
 	bool getShouldClose()
 	{
 		return glfwWindowShouldClose(mainWindow);
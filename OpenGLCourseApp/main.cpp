@@ -2,9 +2,13 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <cfloat>
 #include <cmath>
 #include <vector>
 #include <iostream>
+#include <filesystem>
+#include <future>
+#include <string>
 
 #include <GL\glew.h>
 #include <GLFW\glfw3.h>
@@ -13,24 +17,69 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "Benchmarks.h"
+#include "BindlessTextureTable.h"
+#include "DrawList.h"
+#include "GeometryArena.h"
+#include "InstanceBuffer.h"
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshImporter.h"
+#include "MeshNormals.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "PixelBufferPool.h"
 #include "Shader.h"
+#include "ThreadPool.h"
+#include "UploadThread.h"
 #include "Window.h"
 #include "Camera.h"
 #include "Texture.h"
+#include "TextureCompressor.h"
+#include "TextureManager.h"
+#include "TextureStreamer.h"
 #include "Light.h"
 #include "Material.h"
 
 Window mainWindow;
 
+std::unique_ptr<GeometryArena> geometryArena;
 std::vector<std::unique_ptr<Mesh>> meshList;
-std::vector<Shader> shaderList;
+std::vector<std::unique_ptr<Shader>> shaderList;
+// Owned by shaderList. The indirect and bindless ones are null where the driver can't run them.
+Shader* standardShader = nullptr;
+Shader* indirectShader = nullptr;
+Shader* bindlessShader = nullptr;
+
+DrawList drawList;
+
+UploadThread uploadThread;
+PixelBufferPool pixelBufferPool;
+const GLuint pixelBufferCount = 4;
+std::future<void> importJob;
+
+Shader instancedShader;
+InstanceBuffer pyramidInstances;
+const GLuint pyramidFieldSize = 48;
+// Only this many rows of the field are animated, so most of the instance buffer is never re-sent.
+const GLuint pyramidAnimatedRows = 4;
 
 Camera camera;
 
 Texture brickTexture;
 Texture dirtTexture;
 
+TextureManager textureManager;
+BindlessTextureTable bindlessTextures;
+bool bindlessEnabled = false;
+
+TextureStreamer textureStreamer;
+const size_t textureBudgetBytes = 64 * 1024 * 1024;
+const size_t textureUploadBytesPerFrame = 4 * 1024 * 1024;
+GLuint brickSlot = TextureManager::invalidTexture;
+GLuint dirtSlot = TextureManager::invalidTexture;
+
 Material shinyMaterial;
 Material dullMaterial;
 
@@ -61,42 +110,45 @@ static const char* vShader = "Shaders/shader.vert";
 
 static const char* fShader = "Shaders/shader.frag";
 
-void calcAverageNormals(unsigned int* indices, unsigned int indiceCount, GLfloat* vertices, unsigned int verticeCount, unsigned int vLength, unsigned int normalOffset)
-{
-	for (size_t i = 0; i < indiceCount; i += 3)
-	{
-		unsigned int in0 = indices[i] * vLength;
-		unsigned int in1 = indices[i + 1] * vLength;
-		unsigned int in2 = indices[i + 2] * vLength;
+static const char* vIndirectShader = "Shaders/indirect.vert";
+
+static const char* fIndirectShader = "Shaders/indirect.frag";
 
-		glm::vec3 v1(vertices[in1] - vertices[in0], vertices[in1 + 1] - vertices[in0 + 1], vertices[in1 + 2] - vertices[in0 + 2]);
-		glm::vec3 v2(vertices[in2] - vertices[in0], vertices[in2 + 1] - vertices[in0 + 1], vertices[in2 + 2] - vertices[in0 + 2]);
-		glm::vec3 normal = glm::cross(v1, v2);
-		normal = glm::normalize(normal);
+static const char* fBindlessShader = "Shaders/bindless.frag";
 
-		in0 += normalOffset;
-		in1 += normalOffset;
-		in2 += normalOffset;
+static const char* vInstancedShader = "Shaders/instanced.vert";
 
-		vertices[in0] += normal.x; vertices[in0 + 1] += normal.y; vertices[in0 + 2] += normal.z;
-		vertices[in1] += normal.x; vertices[in1 + 1] += normal.y; vertices[in1 + 2] += normal.z;
-		vertices[in2] += normal.x; vertices[in2 + 1] += normal.y; vertices[in2 + 2] += normal.z;
+static const char* fInstancedShader = "Shaders/instanced.frag";
+
+static const char* meshCacheFile = "Cache/meshes.meshcache";
+
+bool loadCachedObjects(GLuint64 sourceHash)
+{
+	MeshCache meshCache;
+	if (!meshCache.open(meshCacheFile))
+	{
+		return false;
 	}
 
-	for (size_t i = 0; i < verticeCount / vLength; i++)
+	int pyramid = meshCache.findMesh("pyramid", sourceHash);
+	if (pyramid < 0)
 	{
-		unsigned int nOffset = i * vLength + normalOffset;
-		glm::vec3 vec(vertices[nOffset], vertices[nOffset + 1], vertices[nOffset + 2]);
-		vec = glm::normalize(vec);
+		return false;
+	}
 
-		vertices[nOffset] = vec.x;
-		vertices[nOffset + 1] = vec.y;
-		vertices[nOffset + 2] = vec.z;
+	for (int i = 0; i < 2; i++)
+	{
+		meshList.push_back(meshCache.createMesh(pyramid, geometryArena.get()));
 	}
+
+	printf("Loaded meshes from %s\n", meshCacheFile);
+	return true;
 }
 
 void createObjects()
 {
+	geometryArena = std::make_unique<GeometryArena>(PackedVertexLayout::desc, 16 * 1024 * 1024, 16 * 1024 * 1024);
+
 	GLfloat vertices[] = {
 	//	  x		 y	    z		 u      v        nx     ny     nz
 		-1.0f,  0.0f,  1.0f,	0.0f,  0.0f,	0.0f,  0.0f,  0.0f,
@@ -115,34 +167,274 @@ void createObjects()
 		0, 2, 3
 	};
 
-	calcAverageNormals(indices, 18, vertices, 40, 8, 5);
+	GLuint64 sourceHash = MeshCache::hashSource(indices, sizeof(indices), MeshCache::hashSource(vertices, sizeof(vertices)));
+	if (loadCachedObjects(sourceHash))
+	{
+		return;
+	}
+
+	MeshNormals::calcAverageNormals(indices, 18, vertices, 40, 8, 5);
+
+	MeshOptimizerReport optimizerReport = MeshOptimizer::optimizeMesh(vertices, 5, sizeof(vertices[0]) * 8, indices, 18);
+	MeshOptimizer::printReport("pyramid", optimizerReport);
+
+	PackedVertex packedVertices[5];
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+	VertexPacking::packStandardVertices(vertices, optimizerReport.vertexCountAfter, 8, packedVertices, &positionScale.x, &positionOffset.x);
+
+	for (int i = 0; i < 2; i++)
+	{
+		meshList.push_back(std::make_unique<Mesh>(geometryArena.get(), packedVertices, optimizerReport.vertexCountAfter, indices, 18));
+		meshList.back()->setPositionQuantisation(positionScale, positionOffset);
+	}
 
-	meshList.push_back(std::make_unique<Mesh>(vertices, indices, 40, 18));
-	meshList.push_back(std::make_unique<Mesh>(vertices, indices, 40, 18));
+	GLushort shortIndices[18];
+	for (int i = 0; i < 18; i++)
+	{
+		shortIndices[i] = (GLushort)indices[i];
+	}
+
+	MeshCacheSource pyramid = { "pyramid", PackedVertexLayout::desc, packedVertices, optimizerReport.vertexCountAfter,
+		shortIndices, 18, GL_UNSIGNED_SHORT, positionScale, positionOffset, sourceHash };
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(meshCacheFile).parent_path(), error);
+	MeshCache::write(meshCacheFile, { pyramid });
+}
+
+// Imports on the thread pool and hands each mesh to the upload thread as soon as it is processed,
+// so the window keeps drawing while a large file streams in. Finished meshes are copied into the
+// geometry arena, so they batch with everything else.
+void importModel(const char* fileLocation)
+{
+	std::string location = fileLocation;
+	importJob = ThreadPool::getShared().submit([location]()
+	{
+		ImportStats stats;
+		MeshImporter::importFile(location.c_str(), [](ImportedMesh& imported)
+		{
+			unsigned int vertexCount = imported.getVertexCount();
+			unsigned int indexCount = (unsigned int)imported.indices.size();
+			MeshOptimizerReport report = MeshOptimizer::optimizeMesh(imported.vertices.data(), vertexCount, sizeof(GLfloat) * 8, imported.indices.data(), indexCount);
+
+			std::vector<unsigned int> lodIndices;
+			std::vector<MeshLod> lods;
+			LodChainReport lodReport = MeshSimplifier::buildLodChain(imported.vertices.data(), report.vertexCountAfter, sizeof(GLfloat) * 8,
+				imported.indices.data(), indexCount, 5, 0.5f, FLT_MAX, lodIndices, lods);
+			MeshSimplifier::printReport(imported.name.c_str(), lodReport);
+
+			std::vector<Meshlet> meshlets;
+			MeshletBuilder::buildMeshlets(lodIndices.data(), lods[0].indexCount, imported.vertices.data(), report.vertexCountAfter, sizeof(GLfloat) * 8, meshlets);
+
+			std::vector<unsigned char> packedVertices(report.vertexCountAfter * sizeof(PackedVertex));
+			glm::vec3 positionScale;
+			glm::vec3 positionOffset;
+			VertexPacking::packStandardVertices(imported.vertices.data(), report.vertexCountAfter, 8, (PackedVertex*)packedVertices.data(), &positionScale.x, &positionOffset.x);
+
+			Mesh::createAsync(uploadThread, geometryArena.get(), std::move(packedVertices), report.vertexCountAfter, PackedVertexLayout::desc, std::move(lodIndices),
+				[positionScale, positionOffset, lods = std::move(lods), meshlets = std::move(meshlets)](std::unique_ptr<Mesh> mesh)
+			{
+				mesh->setPositionQuantisation(positionScale, positionOffset);
+				mesh->setLods(lods);
+				mesh->setMeshlets(meshlets);
+				meshList.push_back(std::move(mesh));
+			});
+		}, &stats);
+
+		MeshImporter::printStats(location.c_str(), stats);
+	});
+}
+
+Shader* createShader(const char* vertexLocation, const char* fragmentLocation)
+{
+	shaderList.push_back(std::make_unique<Shader>());
+	shaderList.back()->createFromFiles(vertexLocation, fragmentLocation);
+	return shaderList.back().get();
 }
 
 void createShaders()
 {
-	Shader* shader1 = new Shader();
-	shader1->createFromFiles(vShader, fShader);
-	shaderList.push_back(*shader1);
+	standardShader = createShader(vShader, fShader);
+
+	if (drawList.isIndirectSupported())
+	{
+		indirectShader = createShader(vIndirectShader, fIndirectShader);
+	}
+
+	if (drawList.isIndirectSupported() && BindlessTextureTable::isSupported())
+	{
+		bindlessShader = createShader(vIndirectShader, fBindlessShader);
+		drawList.setBindlessTable(&bindlessTextures);
+		bindlessEnabled = true;
+		printf("Bindless textures enabled\n");
+	}
+
+	instancedShader.createFromFiles(vInstancedShader, fInstancedShader);
+}
+
+// Bindless draws take the Texture itself, which streams its mips for the size it is drawn at;
+// otherwise the same image comes from textureManager's arrays.
+void addSceneDraw(Mesh* mesh, const glm::mat4& model, Texture* texture, GLuint slot, Material* material, GLfloat projectionScale)
+{
+	if (bindlessEnabled)
+	{
+		if (drawList.addDraw(mesh, model, texture, material))
+		{
+			textureStreamer.noteUse(texture, mesh->getScreenSize(model, camera.getCameraPosition(), projectionScale));
+		}
+	}
+	else
+	{
+		drawList.addDraw(mesh, model, slot, material);
+	}
+}
+
+void createTextures()
+{
+	brickSlot = textureManager.addTexture("Textures/brick.png");
+	dirtSlot = textureManager.addTexture("Textures/dirt.png");
+
+	// Brick is larger than the default maxAtlasedSize, so both are allowed into the atlas to share
+	// one 2048 page and the pyramid field draws in a single call whichever texture each instance uses.
+	textureManager.build(2048, 2048);
+	textureManager.bindSlots();
+	textureManager.printStats();
 }
 
-int main()
+glm::mat4 pyramidFieldModel(GLuint x, GLuint z, GLfloat angle)
+{
+	glm::mat4 model(1.f);
+	model = glm::translate(model, glm::vec3(((GLfloat)x - pyramidFieldSize * 0.5f) * 1.5f, -3.f, -8.f - (GLfloat)z * 1.5f));
+	model = glm::rotate(model, angle, glm::vec3(0.f, 1.f, 0.f));
+	model = glm::scale(model, glm::vec3(0.4f, 0.4f, 0.4f));
+	return model;
+}
+
+void createPyramidField()
+{
+	for (GLuint z = 0; z < pyramidFieldSize; z++)
+	{
+		for (GLuint x = 0; x < pyramidFieldSize; x++)
+		{
+			InstanceData instance;
+			instance.model = pyramidFieldModel(x, z, 0.f);
+			instance.materialIndex = (x + z) % 2;
+			instance.textureIndex = (x + z) % 3 == 0 ? dirtSlot : brickSlot;
+			pyramidInstances.addInstance(instance);
+		}
+	}
+}
+
+void updatePyramidField(GLfloat time)
+{
+	for (GLuint z = 0; z < pyramidAnimatedRows; z++)
+	{
+		for (GLuint x = 0; x < pyramidFieldSize; x++)
+		{
+			pyramidInstances.setModel(z * pyramidFieldSize + x, pyramidFieldModel(x, z, time + x * 0.2f));
+		}
+	}
+}
+
+void renderPyramidField(const glm::mat4& projection, const glm::mat4& view)
+{
+	instancedShader.useShader();
+
+	mainLight.useLight(instancedShader.getAmbientIntensityLocation(), instancedShader.getAmbientColourLocation(),
+		instancedShader.getDiffuseIntensityLocation(), instancedShader.getDirectionLocation());
+	shinyMaterial.useMaterial(instancedShader.getMaterialSpecularIntensityLocation(0), instancedShader.getMaterialShininessLocation(0));
+	dullMaterial.useMaterial(instancedShader.getMaterialSpecularIntensityLocation(1), instancedShader.getMaterialShininessLocation(1));
+
+	glUniformMatrix4fv(instancedShader.getProjectionLocation(), 1, GL_FALSE, glm::value_ptr(projection));
+	glUniformMatrix4fv(instancedShader.getViewLocation(), 1, GL_FALSE, glm::value_ptr(view));
+	glUniform3f(instancedShader.getEyePositionLocation(), camera.getCameraPosition().x, camera.getCameraPosition().y, camera.getCameraPosition().z);
+
+	textureManager.bindArray(brickSlot);
+	meshList[0]->usePositionQuantisation(instancedShader.getPositionScaleLocation(), instancedShader.getPositionOffsetLocation());
+	meshList[0]->renderInstanced(pyramidInstances, pyramidInstances.getCount());
+}
+
+int main(int argc, char** argv)
 {
 	mainWindow = Window();
 	mainWindow.initialise();
 
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+	{
+		Benchmarks::runAll();
+		return 0;
+	}
+
+	// Fills the texture cache ahead of time so the first run doesn't pay for compression.
+	if (argc > 1 && strcmp(argv[1], "--compress") == 0)
+	{
+		for (int i = 2; i < argc; i++)
+		{
+			Ktx2Image image;
+			bool fromCache = false;
+			if (!TextureCompressor::loadOrCompress(argv[i], Texture::textureCacheDirectory, Texture::getMipFilter(), Texture::getMipsInLinearLight(),
+				image, fromCache))
+			{
+				printf("ERROR::main failed to compress %s\n", argv[i]);
+				continue;
+			}
+			printf("%s: %s, %zu KB%s\n", argv[i], TextureCompressor::getName(image.vkFormat), image.getByteSize() / 1024,
+				fromCache ? " (already cached)" : "");
+		}
+		return 0;
+	}
+
+	// Writes cooked textures beside their sources, which then load without decoding the source.
+	if (argc > 1 && strcmp(argv[1], "--cook") == 0)
+	{
+		for (int i = 2; i < argc; i++)
+		{
+			Ktx2Image image;
+			if (!TextureCompressor::cook(argv[i], Texture::textureCacheDirectory, Texture::getMipFilter(), Texture::getMipsInLinearLight(), image))
+			{
+				printf("ERROR::main failed to cook %s\n", argv[i]);
+				continue;
+			}
+			printf("%s: %s as %s, %zu KB\n", argv[i], TextureCompressor::getCookedLocation(argv[i]).c_str(),
+				TextureCompressor::getName(image.vkFormat), image.getByteSize() / 1024);
+		}
+		return 0;
+	}
+
+	drawList.init(1024);
+	drawList.setTextureManager(&textureManager);
+	uploadThread.start(mainWindow.getWindow());
+
 	createObjects();
 	createShaders();
+	createTextures();
+	createPyramidField();
+
+	if (argc > 1)
+	{
+		importModel(argv[1]);
+	}
+
+	geometryArena->printStats();
+	Mesh::printIndexStats();
 
 	camera = Camera(glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f), -90.f, 0.f, 5.f, 0.1f);
 	
-	brickTexture = Texture((char*)"Textures/brick.png");
-	brickTexture.loadTexture();
+	// Streamed levels stage through pixel buffers rather than the upload thread's context.
+	pixelBufferPool.init(textureUploadBytesPerFrame, pixelBufferCount);
+	Texture::setPixelBufferPool(&pixelBufferPool);
+	textureStreamer.init(textureBudgetBytes, textureUploadBytesPerFrame);
 
-	dirtTexture = Texture((char*)"Textures/dirt.png");
-	dirtTexture.loadTexture();
+	// Only bindless draws sample these; the rest read textureManager's copy of the same chains.
+	if (bindlessEnabled)
+	{
+		brickTexture = Texture((char*)"Textures/brick.png");
+		textureStreamer.addTexture(&brickTexture);
+
+		dirtTexture = Texture((char*)"Textures/dirt.png");
+		textureStreamer.addTexture(&dirtTexture);
+	}
 	
 	mainLight = Light(1.f, 1.f, 1.f, 1.0f, 
 					2.f, -1.f, 2.f, 1.f);
@@ -152,17 +444,15 @@ int main()
 
 
 	GLuint uniformProjection = 0;
-	GLuint uniformModel = 0;
 	GLuint uniformView = 0;
 	GLuint uniformAmbientIntensity = 0;
 	GLuint uniformAmbientColour = 0;
 	GLuint uniformDiffuseIntensity = 0;
 	GLuint uniformDirection = 0;
 	GLuint uniformEyePosition = 0;
-	GLuint uniformSpecularIntensity = 0;
-	GLuint uniformShininess = 0;
 
 	glm::mat4 projection = glm::perspective(45.0f, mainWindow.getBufferWidth() / mainWindow.getBufferHeight(), 0.1f, 100.f);
+	GLfloat lodProjectionScale = projection[1][1] * mainWindow.getBufferHeight() * 0.5f;
 
 	while (!mainWindow.getShouldClose())
 	{
@@ -171,6 +461,7 @@ int main()
 		lastTime = now;
 
 		glfwPollEvents();
+		uploadThread.publishCompleted();
 
 		camera.keyControl(mainWindow.getKeys(), deltaTime);
 		camera.mouseControl(mainWindow.getXChange(), mainWindow.getYChange());
@@ -203,46 +494,74 @@ int main()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		shaderList[0].useShader();
-		uniformModel = shaderList[0].getModelLocation();
-		uniformProjection = shaderList[0].getProjectionLocation();
-		uniformView = shaderList[0].getViewLocation();
-		uniformAmbientColour = shaderList[0].getAmbientColourLocation();
-		uniformAmbientIntensity = shaderList[0].getAmbientIntensityLocation();
-		uniformDiffuseIntensity = shaderList[0].getDiffuseIntensityLocation();
-		uniformDirection = shaderList[0].getDirectionLocation();
-		uniformEyePosition = shaderList[0].getEyePositionLocation();
-		uniformSpecularIntensity = shaderList[0].getSpecularIntensityLocation();
-		uniformShininess = shaderList[0].getShininessLocation();
+		// DrawList takes the indirect path whenever it is supported, so the shader has to follow it.
+		Shader* activeShader = bindlessEnabled ? bindlessShader : drawList.isIndirectSupported() ? indirectShader : standardShader;
+
+		activeShader->useShader();
+		uniformProjection = activeShader->getProjectionLocation();
+		uniformView = activeShader->getViewLocation();
+		uniformAmbientColour = activeShader->getAmbientColourLocation();
+		uniformAmbientIntensity = activeShader->getAmbientIntensityLocation();
+		uniformDiffuseIntensity = activeShader->getDiffuseIntensityLocation();
+		uniformDirection = activeShader->getDirectionLocation();
+		uniformEyePosition = activeShader->getEyePositionLocation();
 		
 		mainLight.useLight(uniformAmbientIntensity, uniformAmbientColour, uniformDiffuseIntensity, uniformDirection);
 
+		glm::mat4 view = camera.calculateViewMatrix();
 		glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(projection));
-		glUniformMatrix4fv(uniformView, 1, GL_FALSE, glm::value_ptr(camera.calculateViewMatrix()));
+		glUniformMatrix4fv(uniformView, 1, GL_FALSE, glm::value_ptr(view));
 		glUniform3f(uniformEyePosition, camera.getCameraPosition().x, camera.getCameraPosition().y, camera.getCameraPosition().z);
+
+		drawList.begin(projection * view, camera.getCameraPosition());
+
 		glm::mat4 model(1.f);
 		
 		model = glm::translate(model, glm::vec3(0.f, 1.f, -5.f));
 		model = glm::rotate(model, currAngle * toRadians, glm::vec3(0.f, 2.5f, 0.f));
 		model = glm::scale(model, glm::vec3(0.4f, 1.f, 0.4f));
-		glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-		brickTexture.useTexture();
-		shinyMaterial.useMaterial(uniformSpecularIntensity, uniformShininess);
-		meshList[0]->renderMesh();
+		addSceneDraw(meshList[0].get(), model, &brickTexture, brickSlot, &shinyMaterial, lodProjectionScale);
 
 		model = glm::mat4(1.f);
 		model = glm::translate(model, glm::vec3(0.f, -1.f, -5.f));
 		model = glm::rotate(model, currAngle * toRadians, glm::vec3(0.f, 2.5f, 0.f));
 		model = glm::scale(model, glm::vec3(0.4f, 1.f, 0.4f));
-		glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-		dirtTexture.useTexture();
-		dullMaterial.useMaterial(uniformSpecularIntensity, uniformShininess);
-		meshList[1]->renderMesh();
+		addSceneDraw(meshList[1].get(), model, &dirtTexture, dirtSlot, &dullMaterial, lodProjectionScale);
+
+		for (size_t i = 2; i < meshList.size(); i++)
+		{
+			model = glm::mat4(1.f);
+			model = glm::translate(model, glm::vec3(0.f, 0.f, -10.f));
+			meshList[i]->selectLod(model, camera.getCameraPosition(), lodProjectionScale);
+			addSceneDraw(meshList[i].get(), model, &brickTexture, brickSlot, &dullMaterial, lodProjectionScale);
+		}
+
+		drawList.submit(activeShader);
+
+		updatePyramidField(now);
+		renderPyramidField(projection, view);
+
+		textureStreamer.update();
 
 		glUseProgram(0);
 
 		mainWindow.swapBuffers();
 	}
 
+	if (drawList.isIndirectSupported())
+	{
+		drawList.getStreamBuffer().printStats("DrawList");
+	}
+
+	// Keep publishing while an import finishes, so it never blocks on a full upload queue.
+	while (importJob.valid() && importJob.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+	{
+		uploadThread.publishCompleted();
+	}
+	textureStreamer.printStats();
+	pixelBufferPool.printStats();
+	uploadThread.printStats();
+	uploadThread.stop();
+
 	return 0;
 }
\ No newline at end of file